@@ -1,21 +1,31 @@
 #include "kalahai.h"
+#include "kalahai_arena.h"
+#include "kalahai_record.h"
+#include "kalahai_table.h"
+#include "kalahai_trace.h"
+#include "kalahai_solver.h"
+#include "kalahai_sow.h"
+#include "kalahai_tree.h"
+#include "kalahai_log.h"
+#include "kalahai_sched.h"
+#include "kalahai_pattern.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KAI_EVALUATE_SSE2
+#endif
 
 
 int kai_open_connection(struct kai_connection_t* connection, const char* ip, const char* port)
 {
 	int result;
-	WSADATA wsa_data;
 	struct addrinfo* address_info;
 	struct addrinfo hints;
 	struct addrinfo* current_address;
 	
-	// Initialize WinSock.
-	result = WSAStartup(WINSOCK_VERSION, &wsa_data);
-	if (result != 0)
-	{
-		fprintf(stderr, "WSAStartup failed: %d\n", result);
+	// Initialize the socket layer.
+	if (kai_platform_startup() != 0)
 		return 1;
-	}
 
 	// Retrieve the possible addresses we can connect to.
 	memset(&hints, 0, sizeof(hints));
@@ -27,43 +37,46 @@ int kai_open_connection(struct kai_connection_t* connection, const char* ip, con
 	if (result != 0)
 	{
 		fprintf(stderr, "getaddrinfo failed: %d\n", result);
-		WSACleanup();
+		kai_platform_cleanup();
 		return 1;
 	}
 
 	// Attempt to connect to all retrieved addresses until we find one that we are accepted on.
 	current_address = address_info;
-	connection->socket = INVALID_SOCKET;
-	while (connection->socket == INVALID_SOCKET && current_address != NULL)
+	connection->socket = KAI_INVALID_SOCKET;
+	while (connection->socket == KAI_INVALID_SOCKET && current_address != NULL)
 	{
 		connection->socket = socket(current_address->ai_family, current_address->ai_socktype, current_address->ai_protocol);
-		if (connection->socket != INVALID_SOCKET)
+		if (connection->socket != KAI_INVALID_SOCKET)
 		{
 			result = connect(connection->socket, current_address->ai_addr, (int) current_address->ai_addrlen);
-			if (result == SOCKET_ERROR)
+			if (result == KAI_SOCKET_ERROR)
 			{
-				closesocket(connection->socket);
-				connection->socket = INVALID_SOCKET;
+				kai_socket_close(connection->socket);
+				connection->socket = KAI_INVALID_SOCKET;
 				fprintf(stderr, "Failed to connect to address %s:%s\n", ip, port);
 			}
 		}
 		else
 		{
-			fprintf(stderr, "Failed to connect socket: %ld\n", WSAGetLastError());
+			fprintf(stderr, "Failed to connect socket: %d\n", kai_socket_last_error());
 		}
 
 		current_address = current_address->ai_next;
 	}
 
-	if (connection->socket == INVALID_SOCKET)
+	if (connection->socket == KAI_INVALID_SOCKET)
 	{
 		freeaddrinfo(address_info);
-		WSACleanup();
+		kai_platform_cleanup();
 		return 1;
 	}
 
 	// Start receiving at the start.
 	connection->receive_ptr = connection->receive_buffer;
+	connection->command_count = 0;
+	connection->trace = NULL;
+	connection->log = NULL;
 
 	return 0;
 }
@@ -72,23 +85,116 @@ int kai_shutdown_connection(struct kai_connection_t* connection)
 {
 	int result;
 
-	result = shutdown(connection->socket, SD_BOTH);
-	if (result == SOCKET_ERROR)
+	result = shutdown(connection->socket, KAI_SHUTDOWN_BOTH);
+	if (result == KAI_SOCKET_ERROR)
 	{
-		fprintf(stderr, "Failed to gracefully shut down socket: %d\n", WSAGetLastError());
-		closesocket(connection->socket);
-		WSACleanup();
+		fprintf(stderr, "Failed to gracefully shut down socket: %d\n", kai_socket_last_error());
+		kai_socket_close(connection->socket);
+		kai_platform_cleanup();
 		return 1;
 	}
 
-	closesocket(connection->socket);
-	WSACleanup();
+	kai_socket_close(connection->socket);
+	kai_platform_cleanup();
 
 	return 0;
 }
 
-int kai_run(struct kai_connection_t* connection)
+/**
+	Parse a board received on a connection, tracing the time it takes.
+*/
+static void kai_run_parse_board_state(struct kai_connection_t* connection, struct kai_board_state_t* board_state, const char* command)
+{
+	struct kai_timer_t span;
+
+	kai_timer_start(&span);
+	kai_parse_board_state(board_state, command);
+	kai_trace_record(connection->trace, KAI_TRACE_PARSE, kai_timer_get_time(&span));
+}
+
+int kai_run(struct kai_connection_t* connection, const struct kai_run_options_t* options)
 {
+	int result;
+	struct kai_run_options_t no_options;
+	struct kai_search_worker_t worker;
+	struct kai_solver_t solver;
+	void* solver_memory;
+	struct kai_table_t table;
+	struct kai_arena_t arena;
+	size_t arena_size;
+	void* table_memory;
+
+	if (options == NULL)
+	{
+		memset(&no_options, 0, sizeof(no_options));
+		options = &no_options;
+	}
+
+	// Search on a separate thread, so the connection can be serviced while searching.
+	if (kai_search_worker_start(&worker) != 0)
+	{
+		fprintf(stderr, "Failed to start the search thread.\n");
+		return 1;
+	}
+
+	worker.table = options->table;
+	worker.count_events = options->count_events;
+	worker.node_limit = options->node_limit;
+	worker.tree = options->tree;
+
+	// The connection and the search thread log into rings of their own.
+	if (options->log != NULL)
+	{
+		connection->log = kai_log_ring_create(options->log);
+		worker.log = kai_log_ring_create(options->log);
+	}
+
+	if (options->sched != NULL)
+	{
+		kai_sched_log(options->sched, connection->log);
+		worker.cpu = kai_sched_cpu(options->sched, 0);
+	}
+
+	// The tables below are faulted in up front in an arena, so the first searches do not take their page faults.
+	arena_size = KAI_SOLVER_DEFAULT_SIZE + 64;
+	if (worker.table == NULL)
+		arena_size += KAI_RUN_TABLE_SIZE + 64;
+	if (kai_arena_create(&arena, arena_size, kai_cpu_count()) == 0)
+	{
+		// Keep the results of every search for the next turn, in a private table unless we were given one.
+		if (worker.table == NULL)
+		{
+			table_memory = kai_arena_allocate(&arena, KAI_RUN_TABLE_SIZE, 64);
+			if (table_memory != NULL && kai_table_create(&table, table_memory, KAI_RUN_TABLE_SIZE) == 0)
+				worker.table = &table;
+		}
+
+		// Decided games are solved rather than searched. Without the memory for the solver, they are searched as well.
+		solver_memory = kai_arena_allocate(&arena, KAI_SOLVER_DEFAULT_SIZE, 64);
+		if (solver_memory != NULL && kai_solver_create(&solver, solver_memory, KAI_SOLVER_DEFAULT_SIZE) == 0)
+			worker.solver = &solver;
+	}
+
+	connection->trace = options->trace;
+	if (options->parameters != NULL)
+		worker.parameters = *options->parameters;
+	if (options->track)
+		result = kai_run_game_tracked(connection, &worker, options);
+	else
+		result = kai_run_game(connection, &worker, options);
+	kai_search_worker_shutdown(&worker);
+	kai_arena_destroy(&arena);
+
+	KAI_LOG_VALUES(connection->log, KAI_LOG_INFO, "Sent %lld commands.\n", connection->command_count, 0, 0);
+
+	return result;
+}
+
+int kai_run_game(struct kai_connection_t* connection, struct kai_search_worker_t* worker, const struct kai_run_options_t* options)
+{
+	// The record file to append the game to, if any.
+	struct kai_record_writer_t* record = options->record;
+
 	// Storing the relevant state of the game.
 	struct kai_game_state_t state;
 
@@ -98,8 +204,8 @@ int kai_run(struct kai_connection_t* connection)
 	// Temporary variable for receiving integers (this is necessary since MSVC does not support store to char in sscanf).
 	int t;
 
-	// The move our AI elected to make.
-	int move = -1;
+	// Measures the time since the board we are searching was received.
+	struct kai_timer_t received;
 
 	// A buffer for holding messages we send/receive.
 	char command_buffer[KAI_COMMAND_MAX_SIZE];
@@ -110,27 +216,11 @@ int kai_run(struct kai_connection_t* connection)
 	if (kai_receive_command(connection, command_buffer) != 0) return 1;
 	sscanf(command_buffer, "%*s %d", &t);
 	
-	state.player_id = (kai_player_id_t) t;
-	if (state.player_id == 1)
-	{
-		state.player_first_ambo = KAI_SOUTH_START;
-		state.player_end_ambo = KAI_SOUTH_END;
-		state.player_house_ambo = KAI_SOUTH_HOUSE;
-		state.opponent_first_ambo = KAI_NORTH_START;
-		state.opponent_end_ambo = KAI_NORTH_END;
-		state.opponent_house_ambo = KAI_NORTH_HOUSE;
-	}
-	else
-	{
-		state.player_first_ambo = KAI_NORTH_START;
-		state.player_end_ambo = KAI_NORTH_END;
-		state.player_house_ambo = KAI_NORTH_HOUSE;
-		state.opponent_first_ambo = KAI_SOUTH_START;
-		state.opponent_end_ambo = KAI_SOUTH_END;
-		state.opponent_house_ambo = KAI_SOUTH_HOUSE;
-	}
+	kai_game_state_init(&state, (kai_player_id_t) t);
+	if (record != NULL)
+		kai_record_writer_begin_game(record, state.player_id);
 
-	fprintf(stdout, "Player ID: %d. First Ambo: %d\n", (int) state.player_id, (int) state.player_first_ambo);
+	KAI_LOG_VALUES(connection->log, KAI_LOG_INFO, "Player ID: %lld. First Ambo: %lld\n", state.player_id, state.player_first_ambo, 0);
 
 	while (1)
 	{
@@ -145,14 +235,24 @@ int kai_run(struct kai_connection_t* connection)
 			if (winner != -1)
 			{
 				// Print the winner and break out from the game loop.
-				fprintf(stdout, "Winner: %d. ", (int) winner);
-				
 				if (winner == 0)
-					fprintf(stdout, "Even game.\n");
+					KAI_LOG_VALUES(connection->log, KAI_LOG_INFO, "Winner: %lld. Even game.\n", winner, 0, 0);
 				else if (winner == state.player_id)
-					fprintf(stdout, "We won.\n");
+					KAI_LOG_VALUES(connection->log, KAI_LOG_INFO, "Winner: %lld. We won.\n", winner, 0, 0);
 				else
-					fprintf(stdout, "We lost.\n");
+					KAI_LOG_VALUES(connection->log, KAI_LOG_INFO, "Winner: %lld. We lost.\n", winner, 0, 0);
+
+				if (options->table != NULL)
+				{
+					KAI_LOG_VALUES(connection->log, KAI_LOG_INFO, "Table: %lld probes, %lld hits, %lld misses.\n", kai_atomic_load(&options->table->probes),
+						kai_atomic_load(&options->table->hits), kai_atomic_load(&options->table->probes) - kai_atomic_load(&options->table->hits));
+				}
+
+				if (connection->trace != NULL)
+					kai_trace_print(connection->trace, stdout);
+
+				if (record != NULL && kai_record_writer_end_game(record, (kai_player_id_t) winner) != 0)
+					return 1;
 
 				break;
 			}
@@ -172,60 +272,239 @@ int kai_run(struct kai_connection_t* connection)
 				sprintf(command_buffer, "%s\n", KAI_COMMAND_BOARD);
 				if (kai_send_command(connection, command_buffer) != 0) return 1;
 				if (kai_receive_command(connection, command_buffer) != 0) return 1;
-				kai_parse_board_state(&state.board_state, command_buffer);
-				fprintf(stdout, "Board State: %s\n", command_buffer);
+				kai_timer_start(&received);
+				kai_run_parse_board_state(connection, &state.board_state, command_buffer);
+				KAI_LOG_BOARD(connection->log, KAI_LOG_INFO, "Board State: %s\n", &state.board_state);
 				
 				// Do not make a move if the game is over in this state.
 				if (kai_is_game_over(&state.board_state))
 					continue;
 
 				// Make our move here!
-				move = kai_minimax_make_move(&state);
-				if (move == -1) 
-				{
-					fprintf(stderr, "Failed to find a valid move.");
+				if (kai_run_turn(connection, worker, &state, &received, record, NULL) != 0)
 					return 1;
-				}
+			}
+		}
+	}
 
-				fprintf(stdout, "Making move: %d (Seeds in ambo %d)\n", move, (int) state.board_state.seeds[move - 1 + state.player_first_ambo]);
+	return 0;
+}
 
-				sprintf(command_buffer, "%s %d %d\n", KAI_COMMAND_MOVE, move, (int) state.player_id);
-				if (kai_send_command(connection, command_buffer) != 0) return 1;
-				if (kai_receive_command(connection, command_buffer) != 0) return 1;
+int kai_run_turn(struct kai_connection_t* connection, struct kai_search_worker_t* worker, struct kai_game_state_t* game_state, const struct kai_timer_t* received, struct kai_record_writer_t* record, int* selected_move)
+{
+	// The move our AI elected to make.
+	int move = -1;
 
-				if (strcmp(command_buffer, KAI_ERROR_GAME_NOT_FULL) == 0) 
-				{ 
-					fprintf(stdout, "Cannot move. Game not full"); 
-					return 1; 
-				}
+	// The time left until we have to reply with a move.
+	double time_left;
 
-				if (strcmp(command_buffer, KAI_ERROR_INVALID_PARAMS) == 0)
-				{
-					fprintf(stdout, "Cannot move. Invalid params");
-					return 1;
-				}
+	// The search that chose our last move.
+	struct kai_search_info_t search_info;
 
-				if (strcmp(command_buffer, KAI_ERROR_INVALID_MOVE) == 0) 
-				{
-					fprintf(stdout, "Cannot move. Invalid move.");
-					return 1;						
-				}
+	// Measures the search.
+	struct kai_timer_t span;
 
-				if (strcmp(command_buffer, KAI_ERROR_WRONG_PLAYER) == 0) 
-				{
-					fprintf(stdout, "Cannot move. Wrong player.");
+	// A buffer for holding messages we send/receive.
+	char command_buffer[KAI_COMMAND_MAX_SIZE];
+
+	// The search runs on the worker thread until it finishes or the time limit, counted from when the board arrived,
+	// is up. Then we take the best move found so far. A search limited by nodes is always waited for.
+	kai_trace_poll(connection->trace, stdout);
+	kai_timer_start(&span);
+	kai_search_worker_post(worker, game_state);
+	time_left = KAI_MINIMAX_TIME_LIMIT - kai_timer_get_time(received);
+	if (worker->node_limit > 0)
+		time_left = KAI_WAIT_INFINITE;
+	else if (time_left < 0.0)
+		time_left = 0.0;
+	if (kai_search_worker_wait(worker, time_left))
+		move = (int) kai_atomic_load(&worker->search.best_move);
+	else
+		move = kai_search_worker_stop(worker);
+	kai_trace_record(connection->trace, KAI_TRACE_SEARCH, kai_timer_get_time(&span));
+
+	if (move == -1) 
+	{
+		fprintf(stderr, "Failed to find a valid move.");
+		return 1;
+	}
+
+	KAI_LOG_VALUES(connection->log, KAI_LOG_INFO, "Making move: %lld (Seeds in ambo %lld)\n", move, game_state->board_state.seeds[move - 1 + game_state->player_first_ambo], 0);
+
+	sprintf(command_buffer, "%s %d %d\n", KAI_COMMAND_MOVE, move, (int) game_state->player_id);
+	if (kai_send_command(connection, command_buffer) != 0) return 1;
+	kai_trace_record(connection->trace, KAI_TRACE_TURN, kai_timer_get_time(received));
+
+	// Let a stopped search unwind while the reply is on its way.
+	kai_search_worker_wait(worker, KAI_WAIT_INFINITE);
+
+	if (record != NULL)
+	{
+		search_info = worker->search.result;
+		search_info.nodes = worker->search.node_count;
+		kai_record_writer_add_ply(record, &game_state->board_state, move, &search_info);
+	}
+	if (kai_receive_command(connection, command_buffer) != 0) return 1;
+
+	if (strcmp(command_buffer, KAI_ERROR_GAME_NOT_FULL) == 0) 
+	{ 
+		KAI_LOG_TEXT(connection->log, KAI_LOG_ERROR, "Cannot move. Game not full");
+		return 1; 
+	}
+
+	if (strcmp(command_buffer, KAI_ERROR_INVALID_PARAMS) == 0)
+	{
+		KAI_LOG_TEXT(connection->log, KAI_LOG_ERROR, "Cannot move. Invalid params");
+		return 1;
+	}
+
+	if (strcmp(command_buffer, KAI_ERROR_INVALID_MOVE) == 0) 
+	{
+		KAI_LOG_TEXT(connection->log, KAI_LOG_ERROR, "Cannot move. Invalid move.");
+		return 1;						
+	}
+
+	if (strcmp(command_buffer, KAI_ERROR_WRONG_PLAYER) == 0) 
+	{
+		KAI_LOG_TEXT(connection->log, KAI_LOG_ERROR, "Cannot move. Wrong player.");
+		return 1;
+	}
+
+	if (strcmp(command_buffer, KAI_ERROR_AMBO_EMPTY) == 0) 
+	{
+		KAI_LOG_TEXT(connection->log, KAI_LOG_ERROR, "Cannot move. Ambo empty.");
+		return 1;
+	}
+
+	kai_run_parse_board_state(connection, &game_state->board_state, command_buffer);
+
+	if (selected_move != NULL)
+		*selected_move = move;
+
+	return 0;
+}
+
+int kai_run_game_tracked(struct kai_connection_t* connection, struct kai_search_worker_t* worker, const struct kai_run_options_t* options)
+{
+	// The record file to append the game to, if any.
+	struct kai_record_writer_t* record = options->record;
+
+	// Storing the relevant state of the game.
+	struct kai_game_state_t state;
+
+	// The board we expect the server to reply with after our move.
+	struct kai_board_state_t expected;
+
+	// The move our AI made.
+	int move;
+
+	// Temporary variable for receiving integers (this is necessary since MSVC does not support store to char in sscanf).
+	int t;
+
+	// The time to wait before asking the server again while waiting for the opponent.
+	double backoff = KAI_TRACK_BACKOFF_MIN;
+
+	// Measures the time since the board we are searching was received.
+	struct kai_timer_t received;
+
+	// A buffer for holding messages we send/receive.
+	char command_buffer[KAI_COMMAND_MAX_SIZE];
+
+	// Send the greetings message and retrieve our player ID.
+	sprintf(command_buffer, "%s\n", KAI_COMMAND_HELLO);
+	if (kai_send_command(connection, command_buffer) != 0) return 1;
+	if (kai_receive_command(connection, command_buffer) != 0) return 1;
+	sscanf(command_buffer, "%*s %d", &t);
+
+	kai_game_state_init(&state, (kai_player_id_t) t);
+	if (record != NULL)
+		kai_record_writer_begin_game(record, state.player_id);
+
+	KAI_LOG_VALUES(connection->log, KAI_LOG_INFO, "Player ID: %lld. First Ambo: %lld\n", state.player_id, state.player_first_ambo, 0);
+
+	// Wait for the opponent to join.
+	while (1)
+	{
+		sprintf(command_buffer, "%s\n", KAI_COMMAND_NEXT_PLAYER);
+		if (kai_send_command(connection, command_buffer) != 0) return 1;
+		if (kai_receive_command(connection, command_buffer) != 0) return 1;
+		if (strcmp(command_buffer, KAI_ERROR_GAME_NOT_FULL) != 0)
+			break;
+
+		kai_sleep(backoff);
+		backoff = backoff * 2.0 < KAI_TRACK_BACKOFF_MAX ? backoff * 2.0 : KAI_TRACK_BACKOFF_MAX;
+	}
+
+	sprintf(command_buffer, "%s\n", KAI_COMMAND_BOARD);
+	if (kai_send_command(connection, command_buffer) != 0) return 1;
+	if (kai_receive_command(connection, command_buffer) != 0) return 1;
+	kai_timer_start(&received);
+	kai_run_parse_board_state(connection, &state.board_state, command_buffer);
+
+	while (1)
+	{
+		// Only ask for the winner once the board says the game is decided.
+		if (kai_is_game_over(&state.board_state) ||
+			state.board_state.seeds[KAI_SOUTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD ||
+			state.board_state.seeds[KAI_NORTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD)
+		{
+			sprintf(command_buffer, "%s\n", KAI_COMMAND_WINNER);
+			if (kai_send_command(connection, command_buffer) != 0) return 1;
+			if (kai_receive_command(connection, command_buffer) != 0) return 1;
+			sscanf(command_buffer, "%d", &t);
+			if (t != -1)
+			{
+				if (t == 0)
+					KAI_LOG_VALUES(connection->log, KAI_LOG_INFO, "Winner: %lld. Even game.\n", t, 0, 0);
+				else if (t == state.player_id)
+					KAI_LOG_VALUES(connection->log, KAI_LOG_INFO, "Winner: %lld. We won.\n", t, 0, 0);
+				else
+					KAI_LOG_VALUES(connection->log, KAI_LOG_INFO, "Winner: %lld. We lost.\n", t, 0, 0);
+
+				if (connection->trace != NULL)
+					kai_trace_print(connection->trace, stdout);
+
+				if (record != NULL && kai_record_writer_end_game(record, (kai_player_id_t) t) != 0)
 					return 1;
-				}
 
-				if (strcmp(command_buffer, KAI_ERROR_AMBO_EMPTY) == 0) 
+				if (options->table != NULL)
 				{
-					fprintf(stdout, "Cannot move. Ambo empty.");
-					return 1;
+					KAI_LOG_VALUES(connection->log, KAI_LOG_INFO, "Table: %lld probes, %lld hits, %lld misses.\n", kai_atomic_load(&options->table->probes),
+						kai_atomic_load(&options->table->hits), kai_atomic_load(&options->table->probes) - kai_atomic_load(&options->table->hits));
 				}
 
-				kai_parse_board_state(&state.board_state, command_buffer);
+				break;
 			}
 		}
+
+		if (state.board_state.player == state.player_id && !kai_is_game_over(&state.board_state))
+		{
+			KAI_LOG_BOARD(connection->log, KAI_LOG_INFO, "Board State: %s\n", &state.board_state);
+
+			memcpy(&expected, &state.board_state, sizeof(expected));
+			if (kai_run_turn(connection, worker, &state, &received, record, &move) != 0)
+				return 1;
+			kai_timer_start(&received);
+			backoff = KAI_TRACK_BACKOFF_MIN;
+
+			// The reply is the board after our move, so an extra turn needs no more requests. Check that the server
+			// agrees with our own rules, and carry on from its board if it does not.
+			kai_play_move(&expected, (kai_ambo_index_t) (move - 1 + state.player_first_ambo));
+			if (memcmp(&expected.seeds, &state.board_state.seeds, sizeof(expected.seeds)) != 0 || expected.player != state.board_state.player)
+				fprintf(stderr, "The board from the server differs from the board we expected after our move.\n");
+
+			continue;
+		}
+
+		// The opponent is to move. Wait a little longer every time the board has not changed.
+		kai_sleep(backoff);
+		backoff = backoff * 2.0 < KAI_TRACK_BACKOFF_MAX ? backoff * 2.0 : KAI_TRACK_BACKOFF_MAX;
+
+		sprintf(command_buffer, "%s\n", KAI_COMMAND_BOARD);
+		if (kai_send_command(connection, command_buffer) != 0) return 1;
+		if (kai_receive_command(connection, command_buffer) != 0) return 1;
+		kai_timer_start(&received);
+		kai_run_parse_board_state(connection, &state.board_state, command_buffer);
 	}
 
 	return 0;
@@ -234,14 +513,19 @@ int kai_run(struct kai_connection_t* connection)
 int kai_send_command(struct kai_connection_t* connection, const char* command)
 {
 	int result;
+	struct kai_timer_t span;
 
+	connection->command_count++;
+	kai_timer_start(&span);
 	result = send(connection->socket, command, strlen(command), 0);
-	if (result == SOCKET_ERROR)
+	if (result == KAI_SOCKET_ERROR)
 	{
 		fprintf(stderr, "Failed to send command: %s", command);
 		return 1;
 	}
 
+	kai_trace_record(connection->trace, KAI_TRACE_SEND, kai_timer_get_time(&span));
+
 	return 0;
 }
 
@@ -255,7 +539,11 @@ int kai_receive_command(struct kai_connection_t* connection, char* command)
 	
 	// The size of the received command (excluding the null-terminator).
 	size_t received_command_size;
-	
+
+	// Measures the wait for the command.
+	struct kai_timer_t span;
+
+	kai_timer_start(&span);
 	while (1)
 	{
 		remaining_receive_size = KAI_RECEIVE_BUFFER_SIZE - (connection->receive_ptr - connection->receive_buffer);
@@ -263,13 +551,13 @@ int kai_receive_command(struct kai_connection_t* connection, char* command)
 
 		if (result == 0)
 		{
-			fprintf(stdout, "Connection lost");
+			KAI_LOG_TEXT(connection->log, KAI_LOG_ERROR, "Connection lost");
 			return 1;
 		}
 
 		if (result < 0)
 		{
-			fprintf(stderr, "recv failed: %d", WSAGetLastError());
+			fprintf(stderr, "recv failed: %d", kai_socket_last_error());
 			return 1;
 		}
 
@@ -291,6 +579,7 @@ int kai_receive_command(struct kai_connection_t* connection, char* command)
 				memcpy(connection->receive_buffer, c + 1, connection->receive_ptr - (c + 1));
 				connection->receive_ptr -= (c + 1) - connection->receive_buffer;
 
+				kai_trace_record(connection->trace, KAI_TRACE_RECEIVE, kai_timer_get_time(&span));
 				return 0;
 			}
 		}
@@ -353,6 +642,38 @@ int kai_parse_board_state(struct kai_board_state_t* board_state, const char* boa
 	return 0;
 }
 
+void kai_format_board_state(const struct kai_board_state_t* board_state, char* board_string)
+{
+	const kai_ambo_t* seeds = board_state->seeds;
+
+	sprintf(board_string, "%d;%d;%d;%d;%d;%d;%d;%d;%d;%d;%d;%d;%d;%d;%d",
+		seeds[13], seeds[0], seeds[1], seeds[2], seeds[3], seeds[4], seeds[5],
+		seeds[6], seeds[7], seeds[8], seeds[9], seeds[10], seeds[11], seeds[12], (int) board_state->player);
+}
+
+void kai_game_state_init(struct kai_game_state_t* state, kai_player_id_t player_id)
+{
+	state->player_id = player_id;
+	if (player_id == 1)
+	{
+		state->player_first_ambo = KAI_SOUTH_START;
+		state->player_end_ambo = KAI_SOUTH_END;
+		state->player_house_ambo = KAI_SOUTH_HOUSE;
+		state->opponent_first_ambo = KAI_NORTH_START;
+		state->opponent_end_ambo = KAI_NORTH_END;
+		state->opponent_house_ambo = KAI_NORTH_HOUSE;
+	}
+	else
+	{
+		state->player_first_ambo = KAI_NORTH_START;
+		state->player_end_ambo = KAI_NORTH_END;
+		state->player_house_ambo = KAI_NORTH_HOUSE;
+		state->opponent_first_ambo = KAI_SOUTH_START;
+		state->opponent_end_ambo = KAI_SOUTH_END;
+		state->opponent_house_ambo = KAI_SOUTH_HOUSE;
+	}
+}
+
 int kai_is_game_over(const struct kai_board_state_t* board_state)
 {
 	return board_state->seeds[KAI_SOUTH_HOUSE] + board_state->seeds[KAI_NORTH_HOUSE] == KAI_SEED_TOTAL;
@@ -371,163 +692,902 @@ int kai_random_make_move(struct kai_game_state_t* state)
 }
 
 int kai_minimax_make_move(struct kai_game_state_t* state)
+{
+	int selected_move;
+	struct kai_deadline_t deadline;
+	struct kai_search_t search;
+
+	kai_search_init(&search);
+	search.callback = kai_search_print_iteration;
+
+	// Do an iterative deepening search until we reach the time limit.
+	if (kai_deadline_start(&deadline, &search.stop, KAI_MINIMAX_TIME_LIMIT) != 0)
+	{
+		fprintf(stderr, "Failed to start the search timer.\n");
+		return -1;
+	}
+
+	selected_move = kai_minimax_search(state, &search);
+	kai_deadline_stop(&deadline);
+
+	return selected_move;
+}
+
+/**
+	Try to solve the root of a search with the solver of the search, once a house is close to deciding the game.
+	A solved root is reported as a completed iteration, with the depth of the proof and a score of KAI_EVALUATION_MAX
+	(taking the fastest win) or KAI_EVALUATION_MIN (taking the slowest loss).
+
+	Returns the move to make, or -1 if the root was not solved.
+*/
+static int kai_minimax_solve(struct kai_game_state_t* state, struct kai_search_t* search)
+{
+	int outcome;
+	int distance;
+	int move;
+	int c;
+	long long node_limit;
+	kai_player_id_t attacker = state->player_id;
+	struct kai_board_state_t board_state;
+	struct kai_search_line_t* line = &search->lines[0];
+
+	if (search->solver == NULL || state->board_state.player != state->player_id ||
+		(state->board_state.seeds[KAI_SOUTH_HOUSE] < KAI_SOLVER_TRIGGER_SEEDS && state->board_state.seeds[KAI_NORTH_HOUSE] < KAI_SOLVER_TRIGGER_SEEDS))
+		return -1;
+
+	// Under a node limit, the solver gets at most half of it, so that a failed solve leaves the search enough nodes
+	// to complete an iteration.
+	node_limit = search->solver->node_limit;
+	if (search->node_limit > 0 && search->node_limit / 2 < node_limit)
+		search->solver->node_limit = search->node_limit / 2;
+	if (search->solver->node_limit <= 0)
+	{
+		search->solver->node_limit = node_limit;
+		return -1;
+	}
+
+	outcome = kai_solver_solve(search->solver, &state->board_state, attacker, &search->stop);
+	search->node_count += search->solver->node_count;
+	if (search->node_limit > 0)
+		search->solver->node_limit -= search->solver->node_count;
+
+	// If we cannot win, find out if the opponent can. A draw is left to the search.
+	if (outcome == KAI_SOLVER_NO_WIN && search->solver->node_limit > 0)
+	{
+		attacker = state->player_id == 1 ? 2 : 1;
+		outcome = kai_solver_solve(search->solver, &state->board_state, attacker, &search->stop);
+		search->node_count += search->solver->node_count;
+	}
+	search->solver->node_limit = node_limit;
+
+	if (outcome != KAI_SOLVER_WIN || kai_solver_lookup(search->solver, &state->board_state, attacker, &distance, &move) != KAI_SOLVER_WIN || move == 0)
+		return -1;
+
+	// The principal variation follows the solved moves from the root.
+	memcpy(&board_state, &state->board_state, sizeof(board_state));
+	line->pv_length = 0;
+	while (line->pv_length < KAI_MINIMAX_MAX_PLY && kai_solver_lookup(search->solver, &board_state, attacker, NULL, &move) == KAI_SOLVER_WIN && move != 0)
+	{
+		line->pv[line->pv_length++] = (kai_ambo_index_t) move;
+		kai_play_move(&board_state, (kai_ambo_index_t) ((board_state.player == 1 ? KAI_SOUTH_START : KAI_NORTH_START) + move - 1));
+	}
+
+	line->move = line->pv[0];
+	line->score = attacker == state->player_id ? KAI_EVALUATION_MAX : KAI_EVALUATION_MIN;
+	search->line_count = 1;
+
+	search->result.depth = distance;
+	search->result.completed = 1;
+	search->result.nodes = search->node_count;
+	search->result.time = kai_timer_get_time(&search->timer);
+	search->result.best_move = line->move;
+	search->result.score = line->score;
+	search->result.lines = search->lines;
+	search->result.line_count = 1;
+	for (c = 0; c < KAI_COUNTER_COUNT; ++c)
+		search->result.counters[c] = -1;
+
+	kai_atomic_store(&search->best_move, line->move);
+	if (search->callback != NULL)
+		search->callback(&search->result, search->user_data);
+
+	return line->move;
+}
+
+// The root player of kai_minimax_negamax(), whose boards always have player 1 to move. Its board state is not used.
+static const struct kai_game_state_t kai_minimax_side =
+{
+	.player_id = 1,
+	.player_first_ambo = KAI_SOUTH_START,
+	.player_end_ambo = KAI_SOUTH_END,
+	.player_house_ambo = KAI_SOUTH_HOUSE,
+	.opponent_first_ambo = KAI_NORTH_START,
+	.opponent_end_ambo = KAI_NORTH_END,
+	.opponent_house_ambo = KAI_NORTH_HOUSE,
+	.board_state = { { 0 }, 0 }
+};
+
+/**
+	Turn a board with player 2 to move so that player 2 plays the south side as player 1. Moves (1 - 6) stay the same.
+*/
+static void kai_minimax_rotate(struct kai_board_state_t* board_state)
+{
+	kai_ambo_t side[KAI_AMBO_COUNT + 1];
+
+	memcpy(side, board_state->seeds, sizeof(side));
+	memcpy(board_state->seeds, board_state->seeds + KAI_NORTH_START, sizeof(side));
+	memcpy(board_state->seeds + KAI_NORTH_START, side, sizeof(side));
+	board_state->player = 1;
+}
+
+/**
+	Lengthen a principal variation from the root of a search with the moves the table keeps for its positions, up to
+	length plies. A variation stops at the first table cutoff, which is where the rest of it is found.
+*/
+static void kai_minimax_extend_pv(struct kai_game_state_t* state, struct kai_search_t* search, struct kai_search_line_t* line, int length)
+{
+	int ply;
+	uint64_t key[2];
+	kai_ambo_index_t first_ambo;
+	struct kai_table_value_t entry;
+	struct kai_board_state_t board_state;
+	struct kai_board_state_t side_state;
+
+	memcpy(&board_state, &state->board_state, sizeof(board_state));
+	for (ply = 0; ply < length && ply < KAI_MINIMAX_MAX_PLY; ++ply)
+	{
+		if (kai_is_game_over(&board_state) ||
+			board_state.seeds[KAI_SOUTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD ||
+			board_state.seeds[KAI_NORTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD)
+			break;
+
+		first_ambo = board_state.player == 1 ? KAI_SOUTH_START : KAI_NORTH_START;
+		if (ply >= line->pv_length)
+		{
+			// The table is keyed on the board seen from the side to move, as kai_minimax_negamax() sees it.
+			memcpy(&side_state, &board_state, sizeof(board_state));
+			if (side_state.player == 2)
+				kai_minimax_rotate(&side_state);
+			kai_table_key(&side_state, (kai_player_id_t) (board_state.player == state->player_id ? 1 : 2), key);
+			if (!kai_table_probe(search->table, key, &entry) || entry.move == 0 || board_state.seeds[first_ambo + entry.move - 1] == 0)
+				break;
+
+			line->pv[line->pv_length++] = (kai_ambo_index_t) entry.move;
+		}
+
+		kai_play_move(&board_state, (kai_ambo_index_t) (first_ambo + line->pv[ply] - 1));
+	}
+}
+
+/**
+	Look for the root of a search on the principal variation kept by the previous search (in search->reuse).
+	predicted_move receives the move the variation continues with, or -1 if the root is not on it. If the previous
+	search went deep enough below the root (see kai_search_t::reuse), the rest of the variation is reported as a
+	completed iteration in the result of the search.
+
+	Returns the depth the previous search went below the root.
+*/
+static int kai_minimax_reuse(struct kai_game_state_t* state, struct kai_search_t* search, int* predicted_move)
+{
+	int ply;
+	int depth;
+	int c;
+	const struct kai_search_reuse_t* reuse = search->reuse;
+	struct kai_board_state_t board_state;
+	struct kai_search_line_t* line = &search->lines[0];
+
+	*predicted_move = -1;
+	if (!reuse->valid || reuse->board_state.player != state->board_state.player)
+		return 0;
+
+	// Follow the variation until it reaches the root, if it does.
+	memcpy(&board_state, &reuse->board_state, sizeof(board_state));
+	for (ply = 0; ply < reuse->line.pv_length; ++ply)
+	{
+		if (board_state.player == state->board_state.player &&
+			memcmp(board_state.seeds, state->board_state.seeds, sizeof(board_state.seeds)) == 0)
+			break;
+
+		kai_play_move(&board_state, (kai_ambo_index_t) ((board_state.player == 1 ? KAI_SOUTH_START : KAI_NORTH_START) + reuse->line.pv[ply] - 1));
+	}
+
+	if (ply == reuse->line.pv_length)
+		return 0;
+
+	depth = reuse->depth - ply;
+	*predicted_move = reuse->line.pv[ply];
+	if (depth < (search->depth_limit > 0 ? search->depth_limit : KAI_MINIMAX_INSTANT_DEPTH))
+		return depth;
+
+	line->move = reuse->line.pv[ply];
+	line->score = reuse->score;
+	line->pv_length = reuse->line.pv_length - ply;
+	memcpy(line->pv, reuse->line.pv + ply, line->pv_length * sizeof(line->pv[0]));
+	search->line_count = 1;
+
+	search->result.depth = depth;
+	search->result.completed = 1;
+	search->result.nodes = 0;
+	search->result.time = kai_timer_get_time(&search->timer);
+	search->result.best_move = line->move;
+	search->result.score = line->score;
+	search->result.lines = search->lines;
+	search->result.line_count = 1;
+	for (c = 0; c < KAI_COUNTER_COUNT; ++c)
+		search->result.counters[c] = -1;
+
+	if (search->callback != NULL)
+		search->callback(&search->result, search->user_data);
+
+	return depth;
+}
+
+int kai_minimax_search(struct kai_game_state_t* state, struct kai_search_t* search)
 {
 	int previous_node_count = -1;
-	int node_count_total = 0;
 	int selected_move = -1;
 	int i = 0;
 	int depth = 0;
-	int depth_progression[] = { KAI_MINIMAX_START_DEPTH, 2 };
+	int depth_progression[2];
 	int depth_progression_count = sizeof(depth_progression) / sizeof(int);
-	struct kai_timer_t timer;
+	int terminal;
+	int line_count;
+	kai_evaluation_t value;
+	struct kai_search_info_t info;
+	struct kai_search_line_t lines[KAI_AMBO_COUNT];
 	struct kai_minimax_node_t root;
+	struct kai_counters_t counters;
+	long long counters_start[KAI_COUNTER_COUNT];
+	int counting;
+	int c;
+	int done = 0;
+	int predicted_move = -1;
+	int reused_depth;
 	
+	depth_progression[0] = search->parameters.start_depth;
+	depth_progression[1] = search->parameters.depth_step;
+
 	memcpy(&root.state, &state->board_state, sizeof(state->board_state));
-	
-	// Do an iterative deepening search until we reach the time limit.
-	kai_timer_start(&timer);
-	do
+	terminal = kai_is_game_over(&root.state) ||
+		root.state.seeds[KAI_SOUTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD ||
+		root.state.seeds[KAI_NORTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD;
+	kai_timer_start(&search->timer);
+	search->node_count = 0;
+	search->node_budget = search->node_limit > 0 ? search->node_limit : LLONG_MAX;
+	search->aborted = 0;
+	search->table_probes = 0;
+	search->table_hits = 0;
+	search->result.depth = 0;
+	search->result.completed = 0;
+	search->result.nodes = 0;
+	search->result.time = 0.0;
+	search->result.best_move = -1;
+	search->result.score = 0;
+	search->result.lines = search->lines;
+	search->result.line_count = 0;
+	search->line_count = 0;
+	for (c = 0; c < KAI_COUNTER_COUNT; ++c)
+		search->result.counters[c] = -1;
+
+	// The counters follow the thread that opens them, so they are opened by every search.
+	counting = search->count_events && kai_counters_open(&counters) == 0;
+	if (counting)
+		kai_counters_read(&counters, counters_start);
+
+	// Until the first iteration completes, fall back on the first non-empty ambo.
+	kai_atomic_store(&search->best_move, kai_random_make_move(state));
+
+	if (search->tree != NULL)
+		kai_tree_writer_add(search->tree, KAI_TREE_EVENT_SEARCH, 0, 0, 0, kai_tree_board_hash(&state->board_state));
+
+	// A decided game is solved outright instead of searched until the time is up.
+	if (!terminal)
+	{
+		selected_move = kai_minimax_solve(state, search);
+		done = selected_move != -1;
+	}
+
+	// If the previous search already looked at this position, carry on from there.
+	if (!terminal && !done && search->reuse != NULL)
+	{
+		reused_depth = kai_minimax_reuse(state, search, &predicted_move);
+		if (predicted_move != -1)
+		{
+			kai_atomic_store(&search->best_move, predicted_move);
+			done = search->result.completed;
+			if (done)
+				selected_move = predicted_move;
+			else if (reused_depth > depth_progression[0])
+				depth = reused_depth - depth_progression[0];
+		}
+	}
+
+	while (!done)
 	{
 		depth += (i < depth_progression_count) ? depth_progression[i] : 1;
+		if (search->depth_limit > 0 && depth > search->depth_limit)
+			depth = search->depth_limit;
 
 		root.alpha = KAI_EVALUATION_MIN;
 		root.beta = KAI_EVALUATION_MAX;
 		root.node_count = 0;
-		kai_minimax_expand_node(state, &root, NULL, depth, &timer);
+		search->iteration_depth = depth;
+		if (search->tree != NULL)
+			kai_tree_writer_add(search->tree, KAI_TREE_EVENT_ITERATION, 0, 0, depth, 0);
+
+		if (search->multi_pv > 1 && !terminal && root.state.player == state->player_id)
+		{
+			line_count = kai_minimax_expand_root(state, &root, depth, search, lines);
+			value = line_count > 0 ? lines[0].score : root.alpha;
+		}
+		else
+		{
+			value = kai_minimax_expand_node(state, &root, NULL, depth, search);
+
+			// The single line is the principal variation of the root.
+			line_count = root.selected_move != -1 ? 1 : 0;
+			lines[0].move = root.selected_move;
+			lines[0].score = value;
+			lines[0].pv_length = search->pv_length[0];
+			memcpy(lines[0].pv, search->pv[0], search->pv_length[0] * sizeof(kai_ambo_index_t));
+		}
 
 		++i;
-		node_count_total += root.node_count;
-		if (root.time <= KAI_MINIMAX_TIME_LIMIT)
+		info.depth = depth;
+		info.completed = !search->aborted;
+		info.nodes = search->node_count;
+		info.time = kai_timer_get_time(&search->timer);
+		for (c = 0; c < KAI_COUNTER_COUNT; ++c)
+			info.counters[c] = -1;
+		if (counting)
+		{
+			kai_counters_read(&counters, info.counters);
+			for (c = 0; c < KAI_COUNTER_COUNT; ++c)
+				info.counters[c] = info.counters[c] >= 0 && counters_start[c] >= 0 ? info.counters[c] - counters_start[c] : -1;
+		}
+
+		if (info.completed)
 		{
 			selected_move = root.selected_move;
-			fprintf(stdout, "Searched %d nodes total to depth %d in %f seconds. Selected move %d.\n", node_count_total, depth, root.time, selected_move);
+			if (selected_move != -1)
+				kai_atomic_store(&search->best_move, selected_move);
+
+			memcpy(search->lines, lines, line_count * sizeof(lines[0]));
+			search->line_count = line_count;
+
+			info.best_move = selected_move;
+			info.score = value;
+			info.lines = search->lines;
+			info.line_count = search->line_count;
+			search->result = info;
 		}
 		else
 		{
-			fprintf(stdout, "Searched %d nodes total attempting depth %d in %f seconds. Out of time. Selected move %d.\n", node_count_total, depth, root.time, selected_move);
+			info.best_move = selected_move;
+			info.score = search->result.score;
+			info.lines = search->lines;
+			info.line_count = search->line_count;
 		}
 
+		if (search->tree != NULL)
+			kai_tree_writer_add(search->tree, KAI_TREE_EVENT_END, info.completed, info.completed && root.selected_move > 0 ? root.selected_move : 0, depth, info.completed ? value : 0);
+
+		if (search->callback != NULL)
+			search->callback(&info, search->user_data);
+
 		if (selected_move == -1)
 			break;
 		
 		if (root.node_count == previous_node_count)
 			break;
 			
-		if (root.time >= KAI_MINIMAX_TIME_LIMIT)
+		if (search->aborted)
+			break;
+
+		if (search->depth_limit > 0 && depth >= search->depth_limit)
 			break;
 
 		previous_node_count = root.node_count;
-	} while (1);
+	}
+
+	if (counting)
+		kai_counters_close(&counters);
+
+	if (search->table != NULL)
+	{
+		kai_atomic_add(&search->table->probes, (long) search->table_probes);
+		kai_atomic_add(&search->table->hits, (long) search->table_hits);
+	}
+
+	if (search->reuse != NULL)
+	{
+		search->reuse->valid = search->result.completed && search->line_count > 0;
+		memcpy(&search->reuse->board_state, &state->board_state, sizeof(state->board_state));
+		search->reuse->depth = search->result.depth;
+		search->reuse->score = search->result.score;
+		memcpy(&search->reuse->line, &search->lines[0], sizeof(search->lines[0]));
+		if (search->table != NULL)
+			kai_minimax_extend_pv(state, search, &search->reuse->line, search->result.depth);
+	}
 
 	// Check if we did not find a move.
 	if (selected_move == -1)
 	{
-		kai_ambo_index_t ambo;
+		// If we did not find a move, this is due to all moves being equal. Take the predicted move, or just select
+		// the first ambo, if any.
+		return predicted_move != -1 ? predicted_move : kai_random_make_move(state);
+	}
 
-		// If we did not find a move, this is due to all moves being equal. Just select the first ambo, if any.
-		for (ambo = state->player_first_ambo; ambo <= state->player_end_ambo; ++ambo)
+	return selected_move;
+}
+
+void kai_search_init(struct kai_search_t* search)
+{
+	search->stop = 0;
+	kai_search_reset(search);
+}
+
+void kai_search_reset(struct kai_search_t* search)
+{
+	int i;
+
+	kai_parameters_init(&search->parameters);
+	search->depth_limit = 0;
+	search->node_limit = 0;
+	search->multi_pv = 1;
+	search->callback = NULL;
+	search->user_data = NULL;
+	search->best_move = -1;
+	search->node_count = 0;
+	search->node_budget = 0;
+	search->aborted = 0;
+	search->table = NULL;
+	search->table_probes = 0;
+	search->table_hits = 0;
+	search->count_events = 0;
+	search->solver = NULL;
+	search->reuse = NULL;
+	search->tree = NULL;
+	search->iteration_depth = 0;
+	search->line_count = 0;
+	memset(&search->result, 0, sizeof(search->result));
+	search->result.best_move = -1;
+	search->result.lines = search->lines;
+	for (i = 0; i < KAI_COUNTER_COUNT; ++i)
+		search->result.counters[i] = -1;
+}
+
+void kai_parameters_init(struct kai_parameters_t* parameters)
+{
+	parameters->house_seed_weight = KAI_MINIMAX_EVALUATION_HOUSE_SEED_WEIGHT;
+	parameters->extra_turn_term = KAI_MINIMAX_EVALUATION_EXTRA_TURN_TERM;
+	parameters->start_depth = KAI_MINIMAX_START_DEPTH;
+	parameters->depth_step = KAI_MINIMAX_DEPTH_STEP;
+	parameters->patterns = NULL;
+}
+
+void kai_search_print_iteration(const struct kai_search_info_t* info, void* user_data)
+{
+	(void) user_data;
+	kai_search_write_iteration(info, stdout);
+}
+
+void kai_search_write_iteration(const struct kai_search_info_t* info, FILE* file)
+{
+	if (info->completed)
+		fprintf(file, "Searched %lld nodes total to depth %d in %f seconds. Selected move %d.\n", info->nodes, info->depth, info->time, info->best_move);
+	else
+		fprintf(file, "Searched %lld nodes total attempting depth %d in %f seconds. Out of time. Selected move %d.\n", info->nodes, info->depth, info->time, info->best_move);
+
+	kai_search_print_counters(info, file);
+}
+
+void kai_search_print_counters(const struct kai_search_info_t* info, FILE* file)
+{
+	int c;
+	int printed = 0;
+	double nodes = info->nodes > 0 ? (double) info->nodes : 1.0;
+	static const char* names[KAI_COUNTER_COUNT] = { "cycles", "instructions", "branch misses", "L1D misses", "LLC misses" };
+
+	for (c = 0; c < KAI_COUNTER_COUNT; ++c)
+	{
+		if (info->counters[c] < 0)
+			continue;
+
+		fprintf(file, "%s%.2f %s", printed ? ", " : "Per node: ", info->counters[c] / nodes, names[c]);
+		printed = 1;
+	}
+
+	if (!printed)
+		return;
+
+	if (info->counters[KAI_COUNTER_CYCLES] > 0 && info->counters[KAI_COUNTER_INSTRUCTIONS] >= 0)
+		fprintf(file, ". IPC %.2f", (double) info->counters[KAI_COUNTER_INSTRUCTIONS] / info->counters[KAI_COUNTER_CYCLES]);
+
+	fprintf(file, ".\n");
+}
+
+/**
+	Evaluate a node of kai_minimax_negamax() for the side to move. The extra turn term only counts for the root player.
+*/
+static kai_evaluation_t kai_minimax_side_evaluation(struct kai_search_t* search, const struct kai_minimax_node_t* node, int us, int extra_turn)
+{
+	return kai_minimax_node_evaluation(&kai_minimax_side, &search->parameters, &node->state, us && extra_turn ? &node->state : NULL);
+}
+
+/**
+	Search a node with one ply left. Its children are leaves, so they are made and evaluated together by
+	kai_minimax_evaluate_batch(). They are then taken in the order of kai_minimax_negamax(), so the same children
+	are counted and cut off. best_move receives the move for the table.
+*/
+static kai_evaluation_t kai_minimax_expand_frontier(struct kai_search_t* search, struct kai_minimax_node_t* node, unsigned int ply, int table_move, int us, int* best_move)
+{
+	int i;
+	int move;
+	int count = 0;
+	int moves[KAI_AMBO_COUNT];
+	kai_evaluation_t values[KAI_AMBO_COUNT];
+	struct kai_board_state_t children[KAI_AMBO_COUNT];
+
+	// The best move found by an earlier search goes first, then the rest in order.
+	for (i = 0; i <= KAI_AMBO_COUNT; ++i)
+	{
+		if (i == 0 ? table_move == 0 : i == table_move)
+			continue;
+
+		move = i == 0 ? table_move : i;
+		if (node->state.seeds[move - 1] != 0)
+			moves[count++] = move;
+	}
+
+	// A leaf has no principal variation of its own.
+	if (ply + 1 < KAI_MINIMAX_MAX_PLY)
+		search->pv_length[ply + 1] = ply + 1;
+
+	for (i = 0; i < count; ++i)
+	{
+		// The first move cuts the node off about half of the time, so it is scored alone. If it does not, most nodes
+		// go through all of their moves, and the rest are scored together. The children are left unrotated, so they
+		// are scored for the side to move here.
+		if (i <= 1)
 		{
-			if (state->board_state.seeds[ambo] != 0)
-				return ambo - state->player_first_ambo + 1;
+			for (move = i; move < (i == 0 ? 1 : count); ++move)
+			{
+				memcpy(&children[move], &node->state, sizeof(node->state));
+				kai_sow_move(&children[move], (kai_ambo_index_t) (moves[move] - 1));
+			}
+
+			kai_minimax_evaluate_batch(&kai_minimax_side, &search->parameters, &children[i], move - i, us ? &node->state : NULL, &values[i]);
 		}
 
-		return -1;
+		if (search->tree != NULL)
+			kai_tree_writer_add(search->tree, KAI_TREE_EVENT_NODE, ply + 1, moves[i], 0, 0);
+
+		node->node_count++;
+		if (++search->node_count > search->node_budget || kai_atomic_load(&search->stop))
+		{
+			search->aborted = 1;
+			break;
+		}
+
+		if (values[i] > node->alpha)
+			*best_move = moves[i];
+
+		if (values[i] >= node->alpha)
+		{
+			node->alpha = values[i];
+			node->selected_move = moves[i];
+			kai_minimax_update_pv(search, ply, (kai_ambo_index_t) moves[i]);
+
+			if (node->beta <= node->alpha)
+			{
+				if (search->tree != NULL)
+					kai_tree_writer_add(search->tree, KAI_TREE_EVENT_CUTOFF, ply, moves[i], 1, us ? values[i] : -values[i]);
+				break;
+			}
+		}
 	}
 
-	return selected_move;
+	return node->alpha;
 }
 
-kai_evaluation_t kai_minimax_expand_node(struct kai_game_state_t* state, struct kai_minimax_node_t* node, const struct kai_board_state_t* previous_board_state, unsigned int depth, const struct kai_timer_t* timer)
+/**
+	Search a node whose board is rotated so that the side to move is player 1 (see kai_minimax_rotate()), with the
+	window and the score taken for the side to move. us is 1 if the side to move is the root player, and extra_turn
+	is 1 if it also made the move into the node.
+*/
+static kai_evaluation_t kai_minimax_negamax(struct kai_search_t* search, struct kai_minimax_node_t* node, unsigned int depth, int us, int extra_turn)
 {
 	kai_evaluation_t value;
-	kai_ambo_index_t ambo;
+	kai_evaluation_t alpha = node->alpha;
+	kai_evaluation_t beta = node->beta;
+	unsigned int ply = search->iteration_depth - depth;
+	int table_move = 0;
+	int best_move = 0;
+	int move;
+	int i;
+	uint64_t key[2];
+	struct kai_table_value_t entry;
 	struct kai_minimax_node_t child;
 
 	node->selected_move = -1;
 	node->node_count++;
-	node->time = kai_timer_get_time(timer);
+
+	if (ply < KAI_MINIMAX_MAX_PLY)
+		search->pv_length[ply] = ply;
 
 	// Check terminal conditions.
-	if (node->time >= KAI_MINIMAX_TIME_LIMIT)
-		return kai_minimax_node_evaluation(state, &node->state, previous_board_state);
-	if (depth == 0)
-		return kai_minimax_node_evaluation(state, &node->state, previous_board_state);
-	if (kai_is_game_over(&node->state))
-		return kai_minimax_node_evaluation(state, &node->state, previous_board_state);
-	if (node->state.seeds[KAI_SOUTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD)
-		return kai_minimax_node_evaluation(state, &node->state, previous_board_state);
-	if (node->state.seeds[KAI_NORTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD)
-		return kai_minimax_node_evaluation(state, &node->state, previous_board_state);
-
-	if (node->state.player == state->player_id)
-	{
-		// Maximize.
-		for (ambo = state->player_first_ambo; ambo <= state->player_end_ambo; ++ambo)
+	if (++search->node_count > search->node_budget || kai_atomic_load(&search->stop))
+	{
+		search->aborted = 1;
+		return kai_minimax_side_evaluation(search, node, us, extra_turn);
+	}
+	if (depth == 0 || kai_is_game_over(&node->state) ||
+		node->state.seeds[KAI_SOUTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD ||
+		node->state.seeds[KAI_NORTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD)
+		return kai_minimax_side_evaluation(search, node, us, extra_turn);
+
+	// Only interior nodes go through the table. The value of a leaf depends on the previous board as well. The board
+	// is always seen from the side to move, so the key tells apart only whether it is the root player.
+	if (search->table != NULL)
+	{
+		kai_table_key(&node->state, (kai_player_id_t) (us ? 1 : 2), key);
+		++search->table_probes;
+		if (kai_table_probe(search->table, key, &entry))
 		{
-			if (node->state.seeds[ambo] != 0)
+			++search->table_hits;
+			table_move = entry.move;
+
+			// The root is always searched, since it needs a move and a principal variation.
+			if (ply > 0 && entry.depth >= depth &&
+				(entry.bound == KAI_TABLE_BOUND_EXACT ||
+				(entry.bound == KAI_TABLE_BOUND_LOWER && entry.score >= beta) ||
+				(entry.bound == KAI_TABLE_BOUND_UPPER && entry.score <= alpha)))
 			{
-				memcpy(&child.state, &node->state, sizeof(node->state));
-				child.alpha = node->alpha;
-				child.beta = node->beta;
-				child.node_count = 0;
-				child.selected_move = -1;
-
-				kai_play_move(&child.state, ambo);
-				value = kai_minimax_expand_node(state, &child, &node->state, depth - 1, timer);
-
-				node->time = child.time;
-				node->node_count += child.node_count;
+				if (search->tree != NULL)
+					kai_tree_writer_add(search->tree, KAI_TREE_EVENT_TABLE, ply, table_move, depth, us ? entry.score : -entry.score);
 
-				if (value >= node->alpha)
+				if (table_move != 0)
 				{
-					node->alpha = value;
-					node->selected_move = ambo - state->player_first_ambo + 1;
-
-					// No need to search further, the minimizing player already has a better branch to explore.
-					if (node->beta <= node->alpha)
-						break;
+					node->selected_move = table_move;
+					if (ply < KAI_MINIMAX_MAX_PLY)
+					{
+						search->pv[ply][ply] = (kai_ambo_index_t) table_move;
+						search->pv_length[ply] = ply + 1;
+					}
 				}
+
+				return entry.score < alpha ? alpha : (entry.score > beta ? beta : entry.score);
 			}
 		}
+	}
 
-		return node->alpha;
+	if (depth == 1)
+	{
+		// The children are leaves, evaluated together.
+		value = kai_minimax_expand_frontier(search, node, ply, table_move, us, &best_move);
 	}
 	else
 	{
-		// Minimize.
-		for (ambo = state->opponent_first_ambo; ambo <= state->opponent_end_ambo; ++ambo)
+		for (i = 0; i <= KAI_AMBO_COUNT; ++i)
 		{
-			if (node->state.seeds[ambo] != 0)
+			// The best move found by an earlier search goes first, then the rest in order.
+			if (i == 0 ? table_move == 0 : i == table_move)
+				continue;
+
+			move = i == 0 ? table_move : i;
+			if (node->state.seeds[move - 1] == 0)
+				continue;
+
+			memcpy(&child.state, &node->state, sizeof(node->state));
+			child.node_count = 0;
+			child.selected_move = -1;
+
+			kai_sow_move(&child.state, (kai_ambo_index_t) (move - 1));
+			if (search->tree != NULL)
+				kai_tree_writer_add(search->tree, KAI_TREE_EVENT_NODE, ply + 1, move, depth - 1, 0);
+
+			// After an extra turn the same side moves again, otherwise the child is turned to the opponent.
+			if (child.state.player == 1)
 			{
-				memcpy(&child.state, &node->state, sizeof(node->state));
 				child.alpha = node->alpha;
 				child.beta = node->beta;
-				child.node_count = 0;
-				child.selected_move = -1;
+				value = kai_minimax_negamax(search, &child, depth - 1, us, 1);
+			}
+			else
+			{
+				kai_minimax_rotate(&child.state);
+				child.alpha = (kai_evaluation_t) -node->beta;
+				child.beta = (kai_evaluation_t) -node->alpha;
+				value = (kai_evaluation_t) -kai_minimax_negamax(search, &child, depth - 1, !us, 0);
+			}
 
-				kai_play_move(&child.state, ambo);
-				value = kai_minimax_expand_node(state, &child, &node->state, depth - 1, timer);
+			node->node_count += child.node_count;
 
-				node->time = child.time;
-				node->node_count += child.node_count;
+			// The iteration will be thrown away, so there is no need to expand the remaining children.
+			if (search->aborted)
+				break;
 
-				if (value <= node->beta)
-				{
-					node->beta = value;
-					node->selected_move = ambo - state->opponent_first_ambo + 1;
+			// Ties also move the selected move, so the table keeps the move that actually raised the score.
+			if (value > node->alpha)
+				best_move = move;
+
+			if (value >= node->alpha)
+			{
+				node->alpha = value;
+				node->selected_move = move;
+				kai_minimax_update_pv(search, ply, (kai_ambo_index_t) move);
 
-					// No need to search further, the maximizing player already has a better branch to explore.
-					if (node->beta <= node->alpha)
-						break;
+				// No need to search further, the opponent already has a better branch to explore.
+				if (node->beta <= node->alpha)
+				{
+					if (search->tree != NULL)
+						kai_tree_writer_add(search->tree, KAI_TREE_EVENT_CUTOFF, ply, move, depth, us ? value : -value);
+					break;
 				}
 			}
 		}
 
-		return node->beta;
+		value = node->alpha;
 	}
+
+	// A score at a bound of the window only tells us on which side of the bound the true value lies.
+	if (search->table != NULL && !search->aborted)
+	{
+		entry.score = value;
+		entry.depth = (unsigned char) (depth < 255 ? depth : 255);
+		entry.bound = value <= alpha ? KAI_TABLE_BOUND_UPPER : (value >= beta ? KAI_TABLE_BOUND_LOWER : KAI_TABLE_BOUND_EXACT);
+		entry.move = (unsigned char) best_move;
+		kai_table_store(search->table, key, &entry);
+	}
+
+	return value;
+}
+
+kai_evaluation_t kai_minimax_expand_node(struct kai_game_state_t* state, struct kai_minimax_node_t* node, const struct kai_board_state_t* previous_board_state, unsigned int depth, struct kai_search_t* search)
+{
+	kai_evaluation_t value;
+	int us = node->state.player == state->player_id;
+	int extra_turn = previous_board_state != NULL && previous_board_state->player == node->state.player;
+	struct kai_minimax_node_t side;
+
+	memcpy(&side.state, &node->state, sizeof(node->state));
+	if (side.state.player == 2)
+		kai_minimax_rotate(&side.state);
+	side.alpha = us ? node->alpha : (kai_evaluation_t) -node->beta;
+	side.beta = us ? node->beta : (kai_evaluation_t) -node->alpha;
+	side.node_count = 0;
+
+	value = kai_minimax_negamax(search, &side, depth, us, extra_turn);
+
+	node->node_count += side.node_count;
+	node->selected_move = side.selected_move;
+	node->alpha = us ? side.alpha : (kai_evaluation_t) -side.beta;
+	node->beta = us ? side.beta : (kai_evaluation_t) -side.alpha;
+
+	return us ? value : (kai_evaluation_t) -value;
 }
 
-kai_evaluation_t kai_minimax_node_evaluation(const struct kai_game_state_t* state, const struct kai_board_state_t* board_state, const struct kai_board_state_t* previous_board_state)
+int kai_minimax_expand_root(struct kai_game_state_t* state, struct kai_minimax_node_t* node, unsigned int depth, struct kai_search_t* search, struct kai_search_line_t* lines)
+{
+	kai_evaluation_t value;
+	kai_ambo_index_t ambo;
+	kai_ambo_index_t order[KAI_AMBO_COUNT];
+	int order_count = 0;
+	int line_count = 0;
+	int multi_pv = search->multi_pv;
+	int i;
+	int j;
+	struct kai_minimax_node_t child;
+
+	if (multi_pv > KAI_AMBO_COUNT)
+		multi_pv = KAI_AMBO_COUNT;
+
+	node->selected_move = -1;
+	node->node_count++;
+	search->node_count++;
+	search->pv_length[0] = 0;
+
+	// Search the best moves of the previous iteration first, so the window narrows as early as possible.
+	for (i = 0; i < search->line_count; ++i)
+		order[order_count++] = (kai_ambo_index_t) (search->lines[i].move - 1 + state->player_first_ambo);
+
+	for (ambo = state->player_first_ambo; ambo <= state->player_end_ambo; ++ambo)
+	{
+		if (node->state.seeds[ambo] == 0)
+			continue;
+
+		for (j = 0; j < order_count && order[j] != ambo; ++j);
+		if (j == order_count)
+			order[order_count++] = ambo;
+	}
+
+	for (i = 0; i < order_count; ++i)
+	{
+		ambo = order[i];
+
+		// Until we have multi_pv lines every move gets an exact score. After that, a move only needs an exact score
+		// if it beats the worst line, so anything at or below that score is allowed to fail low.
+		memcpy(&child.state, &node->state, sizeof(node->state));
+		if (line_count < multi_pv || lines[multi_pv - 1].score == KAI_EVALUATION_MIN)
+			child.alpha = KAI_EVALUATION_MIN;
+		else
+			child.alpha = lines[multi_pv - 1].score - 1;
+		child.beta = KAI_EVALUATION_MAX;
+		child.node_count = 0;
+		child.selected_move = -1;
+
+		kai_sow_move(&child.state, ambo);
+		if (search->tree != NULL)
+			kai_tree_writer_add(search->tree, KAI_TREE_EVENT_NODE, 1, ambo - state->player_first_ambo + 1, depth - 1, 0);
+		value = kai_minimax_expand_node(state, &child, &node->state, depth - 1, search);
+
+		node->node_count += child.node_count;
+
+		if (search->aborted)
+			break;
+
+		if (line_count == multi_pv && value <= lines[multi_pv - 1].score)
+			continue;
+
+		// Insert the move in order, dropping the worst line if we already have multi_pv of them.
+		if (line_count < multi_pv)
+			++line_count;
+
+		for (j = line_count - 1; j > 0 && lines[j - 1].score < value; --j)
+			memcpy(&lines[j], &lines[j - 1], sizeof(lines[j]));
+
+		lines[j].move = ambo - state->player_first_ambo + 1;
+		lines[j].score = value;
+		lines[j].pv[0] = (kai_ambo_index_t) lines[j].move;
+		lines[j].pv_length = 1;
+		for (; lines[j].pv_length < search->pv_length[1] && lines[j].pv_length < KAI_MINIMAX_MAX_PLY; ++lines[j].pv_length)
+			lines[j].pv[lines[j].pv_length] = search->pv[1][lines[j].pv_length];
+	}
+
+	if (line_count > 0)
+	{
+		node->alpha = lines[0].score;
+		node->selected_move = lines[0].move;
+	}
+
+	return line_count;
+}
+
+void kai_minimax_update_pv(struct kai_search_t* search, unsigned int ply, kai_ambo_index_t move)
+{
+	int i;
+
+	if (ply >= KAI_MINIMAX_MAX_PLY)
+		return;
+
+	search->pv[ply][ply] = move;
+	search->pv_length[ply] = ply + 1;
+	if (ply + 1 < KAI_MINIMAX_MAX_PLY)
+	{
+		for (i = ply + 1; i < search->pv_length[ply + 1]; ++i)
+			search->pv[ply][i] = search->pv[ply + 1][i];
+
+		if (search->pv_length[ply + 1] > search->pv_length[ply])
+			search->pv_length[ply] = search->pv_length[ply + 1];
+	}
+}
+
+/**
+	The value of the two sides of a board to state->player_id, from the pattern tables.
+*/
+static int kai_minimax_pattern_value(const struct kai_patterns_t* patterns, const struct kai_game_state_t* state, const struct kai_board_state_t* board_state)
+{
+	unsigned int own = KAI_PATTERN_INDEX(&board_state->seeds[state->player_first_ambo]);
+	unsigned int opponent = KAI_PATTERN_INDEX(&board_state->seeds[state->opponent_first_ambo]);
+
+	if (board_state->player == state->player_id)
+		return KAI_PATTERN_UNIT * (patterns->entries[own].to_move - patterns->entries[opponent].waiting);
+
+	return KAI_PATTERN_UNIT * (patterns->entries[own].waiting - patterns->entries[opponent].to_move);
+}
+
+kai_evaluation_t kai_minimax_node_evaluation(const struct kai_game_state_t* state, const struct kai_parameters_t* parameters, const struct kai_board_state_t* board_state, const struct kai_board_state_t* previous_board_state)
 {
 	kai_evaluation_t evaluation = 0;
 	kai_ambo_index_t ambo;
@@ -540,7 +1600,7 @@ kai_evaluation_t kai_minimax_node_evaluation(const struct kai_game_state_t* stat
 		return KAI_EVALUATION_MIN;
 
 	// More seeds in our house is better. More seeds in the opponent's house is worse.
-	evaluation += (board_state->seeds[state->player_house_ambo] - board_state->seeds[state->opponent_house_ambo]) * KAI_MINIMAX_EVALUATION_HOUSE_SEED_WEIGHT;
+	evaluation += (board_state->seeds[state->player_house_ambo] - board_state->seeds[state->opponent_house_ambo]) * parameters->house_seed_weight;
 	
 	// More seeds on our side is better. More seeds on the opponent side is worse.
 	for (ambo = state->player_first_ambo; ambo <= state->player_end_ambo; ++ambo)
@@ -548,15 +1608,75 @@ kai_evaluation_t kai_minimax_node_evaluation(const struct kai_game_state_t* stat
 		evaluation += board_state->seeds[ambo] - board_state->seeds[KAI_NORTH_END - ambo];
 	}
 
+	// The structure of both sides.
+	if (parameters->patterns != NULL)
+	{
+		evaluation += kai_minimax_pattern_value(parameters->patterns, state, board_state);
+	}
+
 	// Having an extra turn is great.
 	if (previous_board_state != NULL && board_state->player == state->player_id && previous_board_state->player == state->player_id)
 	{
-		evaluation += KAI_MINIMAX_EVALUATION_EXTRA_TURN_TERM;
+		evaluation += parameters->extra_turn_term;
 	}
 
 	return evaluation;
 }
 
+void kai_minimax_evaluate_batch(const struct kai_game_state_t* state, const struct kai_parameters_t* parameters, const struct kai_board_state_t* board_states, int count, const struct kai_board_state_t* previous_board_state, kai_evaluation_t* evaluations)
+{
+	int i;
+	int sum;
+	int extra_turn;
+	const struct kai_board_state_t* board_state;
+#ifdef KAI_EVALUATE_SSE2
+	// The weight of every pit for player 1 (the seeds of player 2 count against): the ambos, then the house.
+	int sign = state->player_id == 1 ? 1 : -1;
+	short weight = (short) (sign * parameters->house_seed_weight);
+	unsigned char seeds[16] = { 0 };
+	__m128i zero = _mm_setzero_si128();
+	__m128i low_weights = _mm_setr_epi16((short) sign, (short) sign, (short) sign, (short) sign, (short) sign, (short) sign, weight, (short) -sign);
+	__m128i high_weights = _mm_setr_epi16((short) -sign, (short) -sign, (short) -sign, (short) -sign, (short) -sign, (short) -weight, 0, 0);
+	__m128i pits;
+	__m128i sums;
+#else
+	kai_ambo_index_t ambo;
+#endif
+
+	// An extra turn is only possible if we were to move.
+	extra_turn = previous_board_state != NULL && previous_board_state->player == state->player_id;
+
+	for (i = 0; i < count; ++i)
+	{
+		board_state = &board_states[i];
+
+#ifdef KAI_EVALUATE_SSE2
+		// Widen the seeds to 16 bits, multiply by the weights and add up the pairs, then the four sums.
+		memcpy(seeds, board_state->seeds, sizeof(board_state->seeds));
+		pits = _mm_loadu_si128((const __m128i*) seeds);
+		sums = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(pits, zero), low_weights), _mm_madd_epi16(_mm_unpackhi_epi8(pits, zero), high_weights));
+		sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(1, 0, 3, 2)));
+		sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(2, 3, 0, 1)));
+		sum = _mm_cvtsi128_si32(sums);
+#else
+		sum = (board_state->seeds[state->player_house_ambo] - board_state->seeds[state->opponent_house_ambo]) * parameters->house_seed_weight;
+		for (ambo = state->player_first_ambo; ambo <= state->player_end_ambo; ++ambo)
+			sum += board_state->seeds[ambo] - board_state->seeds[KAI_NORTH_END - ambo];
+#endif
+
+		sum += extra_turn && board_state->player == state->player_id ? parameters->extra_turn_term : 0;
+		if (parameters->patterns != NULL)
+			sum += kai_minimax_pattern_value(parameters->patterns, state, board_state);
+		evaluations[i] = (kai_evaluation_t) sum;
+
+		// A house with more than half the seeds decides the game.
+		if (board_state->seeds[state->opponent_house_ambo] >= KAI_SEED_WIN_THRESHOLD)
+			evaluations[i] = KAI_EVALUATION_MIN;
+		if (board_state->seeds[state->player_house_ambo] >= KAI_SEED_WIN_THRESHOLD)
+			evaluations[i] = KAI_EVALUATION_MAX;
+	}
+}
+
 void kai_play_move(struct kai_board_state_t* state, kai_ambo_index_t ambo)
 {
 	kai_ambo_index_t index = ambo;
@@ -660,16 +1780,139 @@ void kai_play_move(struct kai_board_state_t* state, kai_ambo_index_t ambo)
 	}
 }
 
-void kai_timer_start(struct kai_timer_t* timer)
+int kai_deadline_start(struct kai_deadline_t* deadline, kai_atomic_t* flag, double limit)
+{
+	deadline->flag = flag;
+	deadline->limit = limit;
+	kai_event_init(&deadline->cancel);
+
+	if (kai_thread_create(&deadline->thread, kai_deadline_thread, deadline) != 0)
+	{
+		kai_event_destroy(&deadline->cancel);
+		return 1;
+	}
+
+	return 0;
+}
+
+void kai_deadline_stop(struct kai_deadline_t* deadline)
+{
+	kai_event_set(&deadline->cancel);
+	kai_thread_join(&deadline->thread);
+	kai_event_destroy(&deadline->cancel);
+}
+
+void kai_deadline_thread(void* argument)
+{
+	struct kai_deadline_t* deadline = (struct kai_deadline_t*) argument;
+
+	// Sleep until the limit has passed, unless we are cancelled before that.
+	if (kai_event_wait(&deadline->cancel, deadline->limit) == 0)
+		kai_atomic_store(deadline->flag, 1);
+}
+
+int kai_search_worker_start(struct kai_search_worker_t* worker)
+{
+	worker->quit = 0;
+	worker->busy = 0;
+	worker->table = NULL;
+	kai_parameters_init(&worker->parameters);
+	worker->count_events = 0;
+	worker->solver = NULL;
+	worker->reuse.valid = 0;
+	worker->node_limit = 0;
+	worker->tree = NULL;
+	worker->log = NULL;
+	worker->cpu = -1;
+	kai_search_init(&worker->search);
+	kai_event_init(&worker->start);
+	kai_event_init(&worker->done);
+
+	if (kai_thread_create(&worker->thread, kai_search_worker_thread, worker) != 0)
+	{
+		kai_event_destroy(&worker->start);
+		kai_event_destroy(&worker->done);
+		return 1;
+	}
+
+	return 0;
+}
+
+void kai_search_worker_shutdown(struct kai_search_worker_t* worker)
+{
+	kai_search_worker_stop(worker);
+	kai_search_worker_wait(worker, KAI_WAIT_INFINITE);
+
+	kai_atomic_store(&worker->quit, 1);
+	kai_event_set(&worker->start);
+	kai_thread_join(&worker->thread);
+
+	kai_event_destroy(&worker->start);
+	kai_event_destroy(&worker->done);
+}
+
+void kai_search_worker_post(struct kai_search_worker_t* worker, const struct kai_game_state_t* state)
+{
+	// The worker thread is idle, so it is safe to write its input without locking.
+	memcpy(&worker->state, state, sizeof(*state));
+	kai_search_init(&worker->search);
+	worker->search.callback = kai_search_log_iteration;
+	worker->search.user_data = worker->log;
+	worker->search.table = worker->table;
+	worker->search.parameters = worker->parameters;
+	worker->search.count_events = worker->count_events;
+	worker->search.solver = worker->solver;
+	worker->search.reuse = &worker->reuse;
+	worker->search.node_limit = worker->node_limit;
+	worker->search.tree = worker->tree;
+	worker->search.best_move = kai_random_make_move(&worker->state);
+	worker->busy = 1;
+
+	kai_event_set(&worker->start);
+}
+
+int kai_search_worker_wait(struct kai_search_worker_t* worker, double timeout)
+{
+	if (!worker->busy)
+		return 1;
+
+	if (kai_event_wait(&worker->done, timeout) == 0)
+		return 0;
+
+	worker->busy = 0;
+	return 1;
+}
+
+int kai_search_worker_stop(struct kai_search_worker_t* worker)
 {
-	QueryPerformanceFrequency(&timer->frequency);
-	QueryPerformanceCounter(&timer->start);
+	kai_atomic_store(&worker->search.stop, 1);
+
+	return (int) kai_atomic_load(&worker->search.best_move);
 }
 
-double kai_timer_get_time(const struct kai_timer_t* timer)
+void kai_search_worker_thread(void* argument)
 {
-	LARGE_INTEGER now;
-	QueryPerformanceCounter(&now);
+	struct kai_search_worker_t* worker = (struct kai_search_worker_t*) argument;
+	int move;
+	int pinned_cpu = -1;
 
-	return (now.QuadPart - timer->start.QuadPart) / (double)timer->frequency.QuadPart;
+	while (1)
+	{
+		kai_event_wait(&worker->start, KAI_WAIT_INFINITE);
+		if (kai_atomic_load(&worker->quit))
+			break;
+
+		// The processor is set while the worker is idle, so it is only seen here.
+		if (worker->cpu != pinned_cpu && worker->cpu >= 0)
+		{
+			if (kai_thread_pin(worker->cpu) != 0)
+				KAI_LOG_VALUES(worker->log, KAI_LOG_ERROR, "Failed to pin the search thread to processor %lld.\n", worker->cpu, 0, 0);
+			pinned_cpu = worker->cpu;
+		}
+
+		move = kai_minimax_search(&worker->state, &worker->search);
+		kai_atomic_store(&worker->search.best_move, move);
+
+		kai_event_set(&worker->done);
+	}
 }
\ No newline at end of file
@@ -1,11 +1,11 @@
-#define WIN32_LEAN_AND_MEAN
-#define _CRT_SECURE_NO_WARNINGS
+#ifndef KALAHAI_H
+#define KALAHAI_H
 
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include "kalahai_platform.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 
 
 /**
@@ -75,13 +75,32 @@
 #define KAI_DEFAULT_PORT "10101"
 #define KAI_DEFAULT_SERVER_ADDRESS "127.0.0.1"
 
-// Define minimax constants
+// Define minimax constants. All but the time limit are the defaults of kai_parameters_t.
 #define KAI_MINIMAX_TIME_LIMIT 4.9
 #define KAI_MINIMAX_START_DEPTH 8
+#define KAI_MINIMAX_DEPTH_STEP 2
 #define KAI_MINIMAX_EVALUATION_HOUSE_SEED_WEIGHT 4
 #define KAI_MINIMAX_EVALUATION_EXTRA_TURN_TERM 50
 
-#define KAI_EVALUATION_MIN SHRT_MIN
+// A search that starts on the principal variation of the previous one replies at once if the previous search went at
+// least this deep below it (see kai_search_t::reuse).
+#define KAI_MINIMAX_INSTANT_DEPTH 16
+
+// The size of the private transposition table kai_run() searches with when it is not given one.
+#define KAI_RUN_TABLE_SIZE (32 * 1024 * 1024)
+
+// The shortest and longest wait between asking the server for the board while waiting for the opponent (see kai_run_game_tracked()).
+#define KAI_TRACK_BACKOFF_MIN 0.001
+#define KAI_TRACK_BACKOFF_MAX 0.05
+
+// The maximum length of a principal variation. Nodes deeper than this are searched, but not recorded in the variation.
+#define KAI_MINIMAX_MAX_PLY 64
+
+// The number of ambos on each side, and so the maximum number of moves in a position.
+#define KAI_AMBO_COUNT 6
+
+// The scores are symmetric, so that a score of one side is negated into the score of the other.
+#define KAI_EVALUATION_MIN (-KAI_EVALUATION_MAX)
 #define KAI_EVALUATION_MAX SHRT_MAX
 
 
@@ -91,6 +110,25 @@
 	STRUCTURES & TYPEDEFS
 */
 
+// Declared in kalahai_record.h.
+struct kai_record_writer_t;
+
+// Declared in kalahai_table.h.
+struct kai_table_t;
+
+// Declared in kalahai_tree.h.
+struct kai_tree_writer_t;
+
+// Declared in kalahai_log.h.
+struct kai_log_t;
+struct kai_log_ring_t;
+
+// Declared in kalahai_sched.h.
+struct kai_sched_t;
+
+// Declared in kalahai_pattern.h.
+struct kai_patterns_t;
+
 typedef signed char kai_player_id_t;
 
 /**
@@ -109,12 +147,20 @@ typedef unsigned char kai_ambo_t;
 typedef unsigned char kai_ambo_index_t;
 
 /**
-	Manages one timer instance.
+	Raises a flag when a time limit has passed. A timer thread sleeps until the limit
+	and then sets the flag, so the search only has to poll a flag instead of reading the clock.
 */
-struct kai_timer_t
+struct kai_deadline_t
 {
-	LARGE_INTEGER frequency;
-	LARGE_INTEGER start;
+	// The flag to set to 1 once the time limit has passed.
+	kai_atomic_t* flag;
+
+	// The time limit in seconds, measured from kai_deadline_start().
+	double limit;
+
+	// The timer thread and the event used to wake it up early.
+	struct kai_thread_t thread;
+	struct kai_event_t cancel;
 };
 
 /**
@@ -123,13 +169,22 @@ struct kai_timer_t
 struct kai_connection_t
 {
 	// The socket connection to the server.
-	SOCKET socket;
+	kai_socket_t socket;
 
 	// The buffer for receiving data from the server.
 	char receive_buffer[KAI_RECEIVE_BUFFER_SIZE];
 
 	// The point in the receive buffer where we should put new incoming data.
 	char* receive_ptr;
+
+	// The number of commands sent.
+	long command_count;
+
+	// Receiving, parsing, searching and sending are traced into this, if it is not NULL.
+	struct kai_trace_t* trace;
+
+	// The game is logged into this ring. NULL logs to stdout directly.
+	struct kai_log_ring_t* log;
 };
 
 /**
@@ -203,9 +258,261 @@ struct kai_minimax_node_t
 	// * if the children of this node has not been evaluated (due to reaching maximum depth), or 
 	// * if every child will lead to the other player winning so it does not matter which move we make.
 	int selected_move;
+};
+
+/**
+	One root move with its score and principal variation.
+*/
+struct kai_search_line_t
+{
+	// The root move (1 - 6).
+	int move;
+
+	// The exact evaluation of the root move.
+	kai_evaluation_t score;
+
+	// The expected continuation, starting with the root move. Every move is an ambo (1 - 6) of the player to move at that point.
+	kai_ambo_index_t pv[KAI_MINIMAX_MAX_PLY];
+	int pv_length;
+};
 
-	// The time it has taken so far to evaluate this node. Used to check against the time limit.
+/**
+	Progress information about one iteration of the iterative deepening search.
+*/
+struct kai_search_info_t
+{
+	// The depth of the iteration.
+	int depth;
+
+	// 1 if the iteration searched the whole tree, 0 if it was cut short by a stop or the node limit.
+	int completed;
+
+	// The number of nodes searched in total, including earlier iterations.
+	long long nodes;
+
+	// The time since the search started in seconds.
 	double time;
+
+	// The move selected by the deepest completed iteration (1 - 6), or -1 if no move was selected.
+	int best_move;
+
+	// The evaluation of the root position by the deepest completed iteration.
+	kai_evaluation_t score;
+
+	// The root moves of the deepest completed iteration, best first, with exact scores.
+	// Holds the best move only, unless more are asked for through kai_search_t::multi_pv.
+	const struct kai_search_line_t* lines;
+	int line_count;
+
+	// The KAI_COUNTER_* hardware events counted since the search started, or -1 for events that were not counted.
+	// Only counted when asked for through kai_search_t::count_events.
+	long long counters[KAI_COUNTER_COUNT];
+};
+
+/**
+	What a search leaves for the next one: the principal variation of its deepest completed iteration.
+*/
+struct kai_search_reuse_t
+{
+	// 1 if the rest is set.
+	int valid;
+
+	// The root of the search, the depth it was searched to, and its score and principal variation.
+	struct kai_board_state_t board_state;
+	int depth;
+	kai_evaluation_t score;
+	struct kai_search_line_t line;
+};
+
+/**
+	Called by the search after every iteration (whether or not it completed).
+*/
+typedef void (*kai_search_callback_t)(const struct kai_search_info_t* info, void* user_data);
+
+/**
+	The tunable constants of the search and the evaluation. Initialize with kai_parameters_init().
+	Searches with different parameters should not share a transposition table.
+*/
+struct kai_parameters_t
+{
+	// The evaluation of every seed in a house (ours positive, the opponent's negative).
+	int house_seed_weight;
+
+	// The evaluation of having an extra turn.
+	int extra_turn_term;
+
+	// The depth of the first iteration, and how much deeper the second iteration goes. Later iterations add one ply.
+	int start_depth;
+	int depth_step;
+
+	// The pattern tables added to the evaluation (see kalahai_pattern.h), or NULL to evaluate without them. They are
+	// not a tunable parameter, and are not read from or written to parameter files.
+	const struct kai_patterns_t* patterns;
+};
+
+/**
+	The state of one search. Initialize with kai_search_init(). The limits and callback are set by the caller,
+	the remaining fields are written by the searching thread.
+*/
+struct kai_search_t
+{
+	// The evaluation and iteration constants to search with.
+	struct kai_parameters_t parameters;
+
+	// The maximum depth to search to, or 0 for no limit.
+	int depth_limit;
+
+	// The maximum number of nodes to search, or 0 for no limit.
+	long long node_limit;
+
+	// The number of root moves to find exact scores and principal variations for (1 - KAI_AMBO_COUNT).
+	// The root moves are searched in one tree, where only moves that can enter the best multi_pv get an exact score.
+	int multi_pv;
+
+	// Called after every iteration, with user_data as argument. May be NULL.
+	kai_search_callback_t callback;
+	void* user_data;
+
+	// Set to 1 to stop the search. Polled on every node.
+	kai_atomic_t stop;
+
+	// The move from the deepest completed iteration (1 - 6). Before the first iteration
+	// has completed, this is the first non-empty ambo, so it is always safe to play.
+	kai_atomic_t best_move;
+
+	// The number of nodes searched so far, and the node count at which the search stops.
+	long long node_count;
+	long long node_budget;
+
+	// Set to 1 when the current iteration has been cut short.
+	int aborted;
+
+	// The transposition table to share results through, or NULL for none. Several searches may use the same table.
+	struct kai_table_t* table;
+
+	// Table lookups, and lookups that found their position, in this search. Added to the table's counters when it ends.
+	long long table_probes;
+	long long table_hits;
+
+	// Set to 1 to count hardware events on the searching thread for every iteration (see kai_counters_open()).
+	int count_events;
+
+	// Solves the root first when a house is close to deciding the game, or NULL to always search (see kalahai_solver.h).
+	struct kai_solver_t* solver;
+
+	// Carries the principal variation from one search to the next, or NULL. When the root is on the principal variation
+	// of the previous search, the search starts at the depth that was left below it, playing the predicted move if
+	// nothing deeper completes. If the depth left is at least the depth limit (or KAI_MINIMAX_INSTANT_DEPTH without
+	// one), the rest of the line is the result, without searching.
+	struct kai_search_reuse_t* reuse;
+
+	// Records every iteration, node and cutoff of the search, or NULL.
+	struct kai_tree_writer_t* tree;
+
+	// The depth of the current iteration. The ply of a node is iteration_depth minus its remaining depth.
+	unsigned int iteration_depth;
+
+	// Triangular table of principal variations. pv[ply] holds the best line found from the current node at ply,
+	// from index ply up to pv_length[ply].
+	kai_ambo_index_t pv[KAI_MINIMAX_MAX_PLY][KAI_MINIMAX_MAX_PLY];
+	int pv_length[KAI_MINIMAX_MAX_PLY];
+
+	// The root moves of the deepest completed iteration, best first.
+	struct kai_search_line_t lines[KAI_AMBO_COUNT];
+	int line_count;
+
+	// The deepest completed iteration.
+	struct kai_search_info_t result;
+
+	// Measures the time since the search started.
+	struct kai_timer_t timer;
+};
+
+/**
+	Runs searches on a separate thread, so the thread doing network I/O is never blocked by the search.
+*/
+struct kai_search_worker_t
+{
+	// The worker thread.
+	struct kai_thread_t thread;
+
+	// Signaled when a search has been posted (or the worker should quit), and when a search has finished.
+	struct kai_event_t start;
+	struct kai_event_t done;
+
+	// Set to 1 to make the worker thread exit.
+	kai_atomic_t quit;
+
+	// 1 from kai_search_worker_post() until the finished search has been collected by kai_search_worker_wait().
+	int busy;
+
+	// The position being searched, and the state of the running search.
+	struct kai_game_state_t state;
+	struct kai_search_t search;
+
+	// The transposition table given to every posted search, or NULL for none.
+	struct kai_table_t* table;
+
+	// The parameters of every posted search.
+	struct kai_parameters_t parameters;
+
+	// Set to 1 to count hardware events in every posted search.
+	int count_events;
+
+	// The solver given to every posted search, or NULL for none.
+	struct kai_solver_t* solver;
+
+	// Passes the principal variation from every posted search to the next.
+	struct kai_search_reuse_t reuse;
+
+	// The node limit of every posted search (0 for none), and the tree file they are recorded to, or NULL.
+	long long node_limit;
+	struct kai_tree_writer_t* tree;
+
+	// The iterations of every posted search are logged into this ring. NULL logs to stdout directly.
+	struct kai_log_ring_t* log;
+
+	// The processor the worker thread pins itself to before its next search, or -1 to leave it unpinned.
+	int cpu;
+};
+
+/**
+	Optional features of kai_run(). Members that are NULL are turned off.
+*/
+struct kai_run_options_t
+{
+	// The game is appended to this record file when it ends.
+	struct kai_record_writer_t* record;
+
+	// Searches share results through this table. The hit rate is printed when the game ends.
+	struct kai_table_t* table;
+
+	// The parameters to search with, instead of the defaults.
+	const struct kai_parameters_t* parameters;
+
+	// Set to 1 to play with kai_run_game_tracked() instead of kai_run_game().
+	int track;
+
+	// Set to 1 to count hardware events in every search. The counts per node are printed after every iteration.
+	int count_events;
+
+	// The turns are traced into this, if it is not NULL. The histograms are printed when the game ends, and at the
+	// start of the next turn after print_requested is set.
+	struct kai_trace_t* trace;
+
+	// Set to limit every search to this many nodes instead of KAI_MINIMAX_TIME_LIMIT, so searches are repeatable.
+	long long node_limit;
+
+	// Every search is recorded into this tree file, if it is not NULL (see kalahai_tree.h).
+	struct kai_tree_writer_t* tree;
+
+	// The game and the searches are logged through this log, if it is not NULL, so neither the connection nor the
+	// search thread waits for the output. Otherwise they print to stdout (see kalahai_log.h).
+	struct kai_log_t* log;
+
+	// The search thread is pinned to the processor of slot 0 of this, if it is not NULL. The placement is logged at
+	// the start of the game (see kalahai_sched.h).
+	const struct kai_sched_t* sched;
 };
 
 
@@ -214,21 +521,48 @@ struct kai_minimax_node_t
 */
 
 /**
-	Initialize WinSock. Open the socket and attempt to connect to the given ip and port.
+	Initialize the socket layer. Open the socket and attempt to connect to the given ip and port.
 */
 int kai_open_connection(struct kai_connection_t* connection, const char* ip, const char* port);
 
 /**
-	Close the socket and cleanup after WinSock.
+	Close the socket and clean up the socket layer.
 */
 int kai_shutdown_connection(struct kai_connection_t* connection);
 
 /**
-	Run the game and communicate with the server.
+	Run the game and communicate with the server. options may be NULL if no optional features are used.
 
 	Returns 0 on success, 1 on failure.
 */
-int kai_run(struct kai_connection_t* connection);
+int kai_run(struct kai_connection_t* connection, const struct kai_run_options_t* options);
+
+/**
+	The game loop of kai_run(). Searches are run on the given worker.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_run_game(struct kai_connection_t* connection, struct kai_search_worker_t* worker, const struct kai_run_options_t* options);
+
+/**
+	A game loop for kai_run() that keeps track of the game itself instead of polling the server for the winner, the
+	player to move and the board in a tight loop. The reply to our move is the next board, so the server is only asked
+	for the board while the opponent is to move, with a wait between requests that doubles from KAI_TRACK_BACKOFF_MIN
+	up to KAI_TRACK_BACKOFF_MAX. The winner is only asked for once the board shows a decided game. Every reply to our
+	moves is checked against kai_play_move().
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_run_game_tracked(struct kai_connection_t* connection, struct kai_search_worker_t* worker, const struct kai_run_options_t* options);
+
+/**
+	Play one turn of a game loop: search the board of game_state (received at the time measured by received), send
+	the move, and read the board after the move into game_state. The move is added to record if it is not NULL,
+	and stored in selected_move if it is not NULL.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_run_turn(struct kai_connection_t* connection, struct kai_search_worker_t* worker, struct kai_game_state_t* game_state, const struct kai_timer_t* received, struct kai_record_writer_t* record, int* selected_move);
 
 /**
 	Send a fully formatted command to the server.
@@ -258,6 +592,18 @@ int kai_parse_int(const char* number_string, int char_count);
 */
 int kai_parse_board_state(struct kai_board_state_t* board_state, const char* board_string);
 
+/**
+	Format a board state the way kai_parse_board_state() reads it (without a newline).
+
+	board_string must be at least KAI_COMMAND_MAX_SIZE bytes.
+*/
+void kai_format_board_state(const struct kai_board_state_t* board_state, char* board_string);
+
+/**
+	Set up the game state for the given player ID (1 for south, 2 for north). The board state is left untouched.
+*/
+void kai_game_state_init(struct kai_game_state_t* state, kai_player_id_t player_id);
+
 /**
 	Returns 1 if all the seeds are in the houses. 0 otherwise. This should always be the case after a player has
 	run out of seeds.
@@ -272,22 +618,83 @@ int kai_is_game_over(const struct kai_board_state_t* board_state);
 int kai_random_make_move(struct kai_game_state_t* state);
 
 /**
-	Make a move using the minimax algorithm without any pruning.
+	Make a move using the minimax algorithm with alpha-beta pruning, searching until KAI_MINIMAX_TIME_LIMIT.
 */
 int kai_minimax_make_move(struct kai_game_state_t* state);
 
 /**
-	Expand the given node without doing any pruning.
+	Run an iterative deepening search on the current board of state until search->stop is raised, a limit
+	is reached or the search cannot go any deeper. search->best_move and search->result are updated after
+	every completed iteration. The search has no side effects other than calling search->callback.
+
+	Returns the ambo to make a move from (indexed 1 to 6). Returns -1 if there is no valid move.
+*/
+int kai_minimax_search(struct kai_game_state_t* state, struct kai_search_t* search);
+
+/**
+	Set up a search with the default parameters and without limits or callback.
+*/
+void kai_search_init(struct kai_search_t* search);
+
+/**
+	Like kai_search_init(), but leaves the stop flag as it is, so that a stop asked for before the search starts is
+	not lost. The owner of the search clears the flag when the search ends.
+*/
+void kai_search_reset(struct kai_search_t* search);
+
+/**
+	Set parameters to the defaults (the KAI_MINIMAX_* constants).
+*/
+void kai_parameters_init(struct kai_parameters_t* parameters);
+
+/**
+	Search callback printing the progress of every iteration to stdout.
+*/
+void kai_search_print_iteration(const struct kai_search_info_t* info, void* user_data);
+
+/**
+	Write the progress of an iteration to a file, as kai_search_print_iteration() prints it.
+*/
+void kai_search_write_iteration(const struct kai_search_info_t* info, FILE* file);
+
+/**
+	Print the hardware events counted by a search per node (and instructions per cycle), if any were counted.
+*/
+void kai_search_print_counters(const struct kai_search_info_t* info, FILE* file);
+
+/**
+	Expand the given node with alpha-beta pruning, from the perspective of state->player_id.
+
+	The node is searched as a negamax over boards rotated so that the side to move plays the south side, which lets
+	both players share the table entries and move loop of a position. The window of the node and the returned value
+	are still those of state->player_id. The parameter node will have its selected_move and node_count fields set.
+*/
+kai_evaluation_t kai_minimax_expand_node(struct kai_game_state_t* state, struct kai_minimax_node_t* node, const struct kai_board_state_t* previous_board_state, unsigned int depth, struct kai_search_t* search);
+
+/**
+	Expand the root node, searching every root move with a window that gives an exact score to any move that can
+	enter the search->multi_pv best. lines receives these moves, best first. The best moves of the previous
+	iteration (search->lines) are searched first. The root player must be state->player_id.
+
+	Returns the number of lines found. The root node will have its selected_move and node_count fields set.
+*/
+int kai_minimax_expand_root(struct kai_game_state_t* state, struct kai_minimax_node_t* node, unsigned int depth, struct kai_search_t* search, struct kai_search_line_t* lines);
 
-	This will return the evaluation value propagated from the child nodes of this state.
-	The parameter node will have its selected_move and node_count fields set.
+/**
+	Record move as the best move of the node at ply, followed by the principal variation of the child at ply + 1.
 */
-kai_evaluation_t kai_minimax_expand_node(struct kai_game_state_t* state, struct kai_minimax_node_t* node, const struct kai_board_state_t* previous_board_state, unsigned int depth, const struct kai_timer_t* timer);
+void kai_minimax_update_pv(struct kai_search_t* search, unsigned int ply, kai_ambo_index_t move);
 
 /**
 	Calculate the evaluation (heuristic) value for a given board state (from the perspective of the player).
 */
-kai_evaluation_t kai_minimax_node_evaluation(const struct kai_game_state_t* state, const struct kai_board_state_t* board_state, const struct kai_board_state_t* previous_board_state);
+kai_evaluation_t kai_minimax_node_evaluation(const struct kai_game_state_t* state, const struct kai_parameters_t* parameters, const struct kai_board_state_t* board_state, const struct kai_board_state_t* previous_board_state);
+
+/**
+	Evaluate count board states that all follow previous_board_state, like kai_minimax_node_evaluation(). The house and
+	side terms are one weighted sum per board, taken with SSE2 where it is available.
+*/
+void kai_minimax_evaluate_batch(const struct kai_game_state_t* state, const struct kai_parameters_t* parameters, const struct kai_board_state_t* board_states, int count, const struct kai_board_state_t* previous_board_state, kai_evaluation_t* evaluations);
 
 /**
 	Given a board state, play a move.
@@ -295,11 +702,58 @@ kai_evaluation_t kai_minimax_node_evaluation(const struct kai_game_state_t* stat
 void kai_play_move(struct kai_board_state_t* state, kai_ambo_index_t ambo);
 
 /**
-	Start measuring time and store that state in the timer structure.
+	Start the timer thread of the deadline. flag is set to 1 once limit seconds have passed.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_deadline_start(struct kai_deadline_t* deadline, kai_atomic_t* flag, double limit);
+
+/**
+	Stop the timer thread of the deadline (whether or not it has expired) and release its resources.
 */
-void kai_timer_start(struct kai_timer_t* timer);
+void kai_deadline_stop(struct kai_deadline_t* deadline);
 
 /**
-	Calculate the time since kai_start_timer was called with the timer parameter.
+	Timer thread entry point. Raises the flag of the deadline passed as argument when the time is up.
 */
-double kai_timer_get_time(const struct kai_timer_t* timer);
\ No newline at end of file
+void kai_deadline_thread(void* argument);
+
+/**
+	Start the worker thread.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_search_worker_start(struct kai_search_worker_t* worker);
+
+/**
+	Stop any running search, wait for the worker thread to exit and release its resources.
+*/
+void kai_search_worker_shutdown(struct kai_search_worker_t* worker);
+
+/**
+	Start searching the given game state on the worker thread. The search runs until it is stopped
+	by kai_search_worker_stop() or cannot go any deeper. The worker must not be busy.
+*/
+void kai_search_worker_post(struct kai_search_worker_t* worker, const struct kai_game_state_t* state);
+
+/**
+	Wait up to timeout seconds (KAI_WAIT_INFINITE to wait forever) for the posted search to finish.
+
+	Returns 1 if the search has finished (or none was posted), 0 on timeout.
+*/
+int kai_search_worker_wait(struct kai_search_worker_t* worker, double timeout);
+
+/**
+	Ask the running search to stop and return the best move found so far without waiting for the worker.
+	kai_search_worker_wait() must still be called before the next search is posted.
+
+	Returns the ambo to make a move from (indexed 1 to 6). Returns -1 if there is no valid move.
+*/
+int kai_search_worker_stop(struct kai_search_worker_t* worker);
+
+/**
+	Worker thread entry point. Runs posted searches until the worker is shut down.
+*/
+void kai_search_worker_thread(void* argument);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "kalahai_arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+int kai_arena_create(struct kai_arena_t* arena, size_t size, int thread_count)
+{
+	int i;
+	size_t slice_size;
+	struct kai_arena_fault_job_t* jobs;
+
+	arena->used = 0;
+	arena->memory = (unsigned char*) kai_memory_map(size, &arena->size);
+	if (arena->memory == NULL)
+		return 1;
+
+	if (thread_count < 1)
+		thread_count = 1;
+
+	jobs = (struct kai_arena_fault_job_t*) malloc(thread_count * sizeof(*jobs));
+	if (jobs == NULL)
+	{
+		kai_memory_unmap(arena->memory, arena->size);
+		arena->memory = NULL;
+		return 1;
+	}
+
+	// Touch every page, split in page aligned slices between the threads, so that the page faults are taken
+	// now and in parallel instead of one by one when the search first hits them.
+	slice_size = (arena->size / thread_count + 4095) & ~(size_t) 4095;
+	for (i = 0; i < thread_count; ++i)
+	{
+		jobs[i].memory = arena->memory + i * slice_size;
+		jobs[i].size = 0;
+		if ((size_t) i * slice_size < arena->size)
+			jobs[i].size = arena->size - i * slice_size < slice_size ? arena->size - i * slice_size : slice_size;
+
+		jobs[i].started = i > 0 && kai_thread_create(&jobs[i].thread, kai_arena_fault_thread, &jobs[i]) == 0;
+	}
+
+	// The calling thread takes the first slice, and any slice whose thread could not be started.
+	for (i = 0; i < thread_count; ++i)
+	{
+		if (!jobs[i].started)
+			kai_arena_fault_thread(&jobs[i]);
+	}
+
+	for (i = 0; i < thread_count; ++i)
+	{
+		if (jobs[i].started)
+			kai_thread_join(&jobs[i].thread);
+	}
+
+	free(jobs);
+
+	arena->page_size = kai_memory_page_size(arena->memory);
+
+	return 0;
+}
+
+void kai_arena_destroy(struct kai_arena_t* arena)
+{
+	if (arena->memory != NULL)
+		kai_memory_unmap(arena->memory, arena->size);
+
+	arena->memory = NULL;
+	arena->size = 0;
+	arena->used = 0;
+}
+
+void* kai_arena_allocate(struct kai_arena_t* arena, size_t size, size_t alignment)
+{
+	uintptr_t address;
+
+	if (arena->memory == NULL)
+		return NULL;
+
+	address = ((uintptr_t) (arena->memory + arena->used) + alignment - 1) & ~(uintptr_t) (alignment - 1);
+	if (address + size > (uintptr_t) (arena->memory + arena->size))
+		return NULL;
+
+	arena->used = (size_t) (address + size - (uintptr_t) arena->memory);
+
+	return (void*) address;
+}
+
+void kai_arena_fault_thread(void* argument)
+{
+	struct kai_arena_fault_job_t* job = (struct kai_arena_fault_job_t*) argument;
+
+	memset(job->memory, 0, job->size);
+}
@@ -0,0 +1,73 @@
+#ifndef KALAHAI_ARENA_H
+#define KALAHAI_ARENA_H
+
+#include "kalahai_platform.h"
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	A block of long-lived memory for search tables (hash tables, history tables, caches and such).
+	The memory is mapped with huge pages when possible and faulted in up front, so the search never has
+	to allocate memory or take a page fault. Tables are carved out of the arena with kai_arena_allocate()
+	and live until the arena is destroyed.
+*/
+struct kai_arena_t
+{
+	// The memory of the arena, and its size.
+	unsigned char* memory;
+	size_t size;
+
+	// The number of bytes handed out so far.
+	size_t used;
+
+	// The size of the pages backing the memory, as reported by the operating system.
+	size_t page_size;
+};
+
+/**
+	One slice of the arena, zeroed by one thread of kai_arena_create().
+*/
+struct kai_arena_fault_job_t
+{
+	unsigned char* memory;
+	size_t size;
+
+	// The thread zeroing the slice, if one could be started.
+	struct kai_thread_t thread;
+	int started;
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Map at least size bytes for the arena, then fault in and zero the memory using thread_count threads
+	(1 to do it on the calling thread only). arena->page_size receives the page size actually obtained.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_arena_create(struct kai_arena_t* arena, size_t size, int thread_count);
+
+/**
+	Unmap the memory of the arena. Every table allocated from it becomes invalid.
+*/
+void kai_arena_destroy(struct kai_arena_t* arena);
+
+/**
+	Hand out size bytes of zeroed memory from the arena, aligned to alignment bytes (a power of two).
+
+	Returns NULL if the arena does not have enough memory left.
+*/
+void* kai_arena_allocate(struct kai_arena_t* arena, size_t size, size_t alignment);
+
+/**
+	Thread entry point for kai_arena_create(). Zeroes the slice of the kai_arena_fault_job_t passed as argument.
+*/
+void kai_arena_fault_thread(void* argument);
+
+#endif
@@ -0,0 +1,274 @@
+#include "kalahai_engine.h"
+#include "kalahai_arena.h"
+#include "kalahai_table.h"
+#include "kalahai_solver.h"
+
+
+/**
+	The engine handle. Kept out of the header, so its layout can change without breaking users of the library.
+*/
+struct kai_engine_t
+{
+	// The position to search, seen from the player to move.
+	struct kai_game_state_t state;
+
+	// The state of the current (or last) search.
+	struct kai_search_t search;
+
+	// The number of root moves to search with exact scores.
+	int multi_pv;
+
+	// The parameters to search with.
+	struct kai_parameters_t parameters;
+
+	// 1 if searches count hardware events.
+	int count_events;
+
+	// 1 if searches build on the principal variation of the previous one, which is kept in reuse.
+	int reuse_tree;
+	struct kai_search_reuse_t reuse;
+
+	// The tree file searches are recorded to, or NULL.
+	struct kai_tree_writer_t* tree;
+
+	// The long-lived memory that search tables are allocated from.
+	struct kai_arena_t arena;
+
+	// The transposition table, either in the arena or in shared memory. Not in use if it has no buckets.
+	struct kai_table_t table;
+
+	// The solver for decided positions, in the arena. Not in use if it has no buckets.
+	struct kai_solver_t solver;
+
+	// The blocks of the arena given to the table and the solver, or NULL, and their sizes. A table or solver created
+	// again gets the same block, so that the arena does not run dry.
+	void* table_memory;
+	size_t table_memory_size;
+	void* solver_memory;
+	size_t solver_memory_size;
+};
+
+
+/**
+	Return a zeroed block of size bytes from the arena of an engine for *memory, the block of a table or a solver.
+	Once that has a block, it is reused for every size that fits in it.
+
+	Returns NULL if there is not enough reserved memory left, or the size does not fit in the block.
+*/
+static void* kai_engine_block(struct kai_engine_t* engine, void** memory, size_t* memory_size, size_t size)
+{
+	if (*memory != NULL)
+	{
+		if (size > *memory_size)
+			return NULL;
+
+		memset(*memory, 0, size);
+		return *memory;
+	}
+
+	*memory = kai_arena_allocate(&engine->arena, size, 64);
+	*memory_size = *memory != NULL ? size : 0;
+
+	return *memory;
+}
+
+
+struct kai_engine_t* kai_engine_create()
+{
+	struct kai_engine_t* engine;
+
+	engine = (struct kai_engine_t*) malloc(sizeof(*engine));
+	if (engine == NULL)
+		return NULL;
+
+	kai_search_init(&engine->search);
+	engine->multi_pv = 1;
+	kai_parameters_init(&engine->parameters);
+	engine->count_events = 0;
+	engine->reuse_tree = 0;
+	engine->reuse.valid = 0;
+	engine->tree = NULL;
+	engine->arena.memory = NULL;
+	engine->arena.size = 0;
+	engine->arena.used = 0;
+	engine->arena.page_size = 0;
+	engine->table.buckets = NULL;
+	engine->table.bucket_count = 0;
+	engine->table.shared = 0;
+	engine->solver.buckets = NULL;
+	engine->table_memory = NULL;
+	engine->table_memory_size = 0;
+	engine->solver_memory = NULL;
+	engine->solver_memory_size = 0;
+	kai_engine_set_position_string(engine, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+
+	return engine;
+}
+
+void kai_engine_destroy(struct kai_engine_t* engine)
+{
+	kai_table_detach(&engine->table);
+	kai_arena_destroy(&engine->arena);
+	free(engine);
+}
+
+int kai_engine_reserve_memory(struct kai_engine_t* engine, size_t size)
+{
+	// A table in the arena goes away with it.
+	if (!engine->table.shared)
+		kai_table_detach(&engine->table);
+	engine->solver.buckets = NULL;
+	engine->table_memory = NULL;
+	engine->table_memory_size = 0;
+	engine->solver_memory = NULL;
+	engine->solver_memory_size = 0;
+
+	kai_arena_destroy(&engine->arena);
+
+	return kai_arena_create(&engine->arena, size, kai_cpu_count());
+}
+
+size_t kai_engine_memory_page_size(const struct kai_engine_t* engine)
+{
+	return engine->arena.memory != NULL ? engine->arena.page_size : 0;
+}
+
+int kai_engine_create_table(struct kai_engine_t* engine, size_t size)
+{
+	void* memory;
+
+	kai_table_detach(&engine->table);
+
+	memory = kai_engine_block(engine, &engine->table_memory, &engine->table_memory_size, size);
+	if (memory == NULL)
+		return 1;
+
+	return kai_table_create(&engine->table, memory, size);
+}
+
+int kai_engine_create_solver(struct kai_engine_t* engine, size_t size)
+{
+	void* memory;
+
+	engine->solver.buckets = NULL;
+
+	memory = kai_engine_block(engine, &engine->solver_memory, &engine->solver_memory_size, size);
+	if (memory == NULL)
+		return 1;
+
+	if (kai_solver_create(&engine->solver, memory, size) != 0)
+	{
+		engine->solver.buckets = NULL;
+		return 1;
+	}
+
+	return 0;
+}
+
+int kai_engine_attach_shared_table(struct kai_engine_t* engine, const char* name, size_t size)
+{
+	kai_table_detach(&engine->table);
+
+	return kai_table_attach(&engine->table, name, size);
+}
+
+void kai_engine_table_counts(const struct kai_engine_t* engine, long long* probes, long long* hits)
+{
+	*probes = engine->table.buckets != NULL ? (long long) kai_atomic_load(&engine->table.probes) : 0;
+	*hits = engine->table.buckets != NULL ? (long long) kai_atomic_load(&engine->table.hits) : 0;
+}
+
+void kai_engine_set_position(struct kai_engine_t* engine, const struct kai_board_state_t* board_state)
+{
+	memcpy(&engine->state.board_state, board_state, sizeof(*board_state));
+	kai_game_state_init(&engine->state, board_state->player);
+}
+
+void kai_engine_set_position_string(struct kai_engine_t* engine, const char* board_string)
+{
+	struct kai_board_state_t board_state;
+
+	kai_parse_board_state(&board_state, board_string);
+	kai_engine_set_position(engine, &board_state);
+}
+
+void kai_engine_set_multi_pv(struct kai_engine_t* engine, int multi_pv)
+{
+	if (multi_pv < 1)
+		multi_pv = 1;
+	if (multi_pv > KAI_AMBO_COUNT)
+		multi_pv = KAI_AMBO_COUNT;
+
+	engine->multi_pv = multi_pv;
+}
+
+void kai_engine_set_parameters(struct kai_engine_t* engine, const struct kai_parameters_t* parameters)
+{
+	engine->parameters = *parameters;
+}
+
+void kai_engine_count_events(struct kai_engine_t* engine, int enabled)
+{
+	engine->count_events = enabled;
+}
+
+void kai_engine_reuse_tree(struct kai_engine_t* engine, int enabled)
+{
+	engine->reuse_tree = enabled;
+	engine->reuse.valid = 0;
+}
+
+void kai_engine_record_tree(struct kai_engine_t* engine, struct kai_tree_writer_t* tree)
+{
+	engine->tree = tree;
+}
+
+int kai_engine_search(struct kai_engine_t* engine, const struct kai_engine_limits_t* limits, const struct kai_engine_callbacks_t* callbacks, struct kai_search_info_t* result)
+{
+	int move;
+	struct kai_deadline_t deadline;
+
+	// A stop from before the search started stops it. The flag is cleared once the search is over instead.
+	kai_search_reset(&engine->search);
+	engine->search.depth_limit = limits->depth;
+	engine->search.node_limit = limits->nodes;
+	engine->search.parameters = engine->parameters;
+	engine->search.multi_pv = engine->multi_pv;
+	engine->search.count_events = engine->count_events;
+	engine->search.table = engine->table.buckets != NULL ? &engine->table : NULL;
+	engine->search.solver = engine->solver.buckets != NULL ? &engine->solver : NULL;
+	engine->search.reuse = engine->reuse_tree ? &engine->reuse : NULL;
+	engine->search.tree = engine->tree;
+	if (callbacks != NULL)
+	{
+		engine->search.callback = callbacks->iteration;
+		engine->search.user_data = callbacks->user_data;
+	}
+
+	if (limits->time > 0.0 && kai_deadline_start(&deadline, &engine->search.stop, limits->time) != 0)
+	{
+		kai_atomic_store(&engine->search.stop, 0);
+		return -1;
+	}
+
+	move = kai_minimax_search(&engine->state, &engine->search);
+
+	if (limits->time > 0.0)
+		kai_deadline_stop(&deadline);
+	kai_atomic_store(&engine->search.stop, 0);
+
+	if (result != NULL)
+	{
+		memcpy(result, &engine->search.result, sizeof(*result));
+		result->nodes = engine->search.node_count;
+		result->time = kai_timer_get_time(&engine->search.timer);
+		result->best_move = move;
+	}
+
+	return move;
+}
+
+void kai_engine_stop(struct kai_engine_t* engine)
+{
+	kai_atomic_store(&engine->search.stop, 1);
+}
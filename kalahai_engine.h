@@ -0,0 +1,165 @@
+#ifndef KALAHAI_ENGINE_H
+#define KALAHAI_ENGINE_H
+
+#include "kalahai.h"
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	An independent engine instance. Every engine owns all of its state, so several engines
+	can search concurrently on different threads. Create with kai_engine_create().
+*/
+struct kai_engine_t;
+
+/**
+	The limits of one search. A limit of 0 means no limit. A search without any limits runs until
+	kai_engine_stop() is called or the search cannot go any deeper.
+*/
+struct kai_engine_limits_t
+{
+	// The maximum depth to search to.
+	int depth;
+
+	// The maximum number of nodes to search.
+	long long nodes;
+
+	// The maximum time to search in seconds.
+	double time;
+};
+
+/**
+	Progress callbacks of one search. Every callback may be NULL. Callbacks are called on the thread running the search.
+*/
+struct kai_engine_callbacks_t
+{
+	// Called after every iteration of the iterative deepening search.
+	kai_search_callback_t iteration;
+
+	// Passed to every callback.
+	void* user_data;
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Create an engine. The engine starts out at the initial position with player 1 to move.
+
+	Returns NULL on failure.
+*/
+struct kai_engine_t* kai_engine_create();
+
+/**
+	Destroy an engine. The engine must not be searching.
+*/
+void kai_engine_destroy(struct kai_engine_t* engine);
+
+/**
+	Reserve size bytes of long-lived memory for the search tables of the engine. The memory is backed by huge pages
+	when possible and is faulted in and zeroed in parallel before this returns, so searches never allocate memory.
+	Any memory reserved earlier is released. Must not be called while searching.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_engine_reserve_memory(struct kai_engine_t* engine, size_t size);
+
+/**
+	Return the size of the pages backing the memory reserved by kai_engine_reserve_memory(), or 0 if none is reserved.
+*/
+size_t kai_engine_memory_page_size(const struct kai_engine_t* engine);
+
+/**
+	Give the engine a transposition table of size bytes, allocated from the memory reserved by kai_engine_reserve_memory().
+	Replaces any table the engine had. Later tables reuse the memory of the first one, so they may be no larger than it
+	until memory is reserved again. The table is lost when memory is reserved again.
+
+	Returns 0 on success, 1 if there is not enough reserved memory left or the table is larger than the first one.
+*/
+int kai_engine_create_table(struct kai_engine_t* engine, size_t size);
+
+/**
+	Give the engine a proof-number solver with a table of size bytes, allocated from the memory reserved by
+	kai_engine_reserve_memory(). Following searches first try to solve positions where a house is close to deciding
+	the game (see kalahai_solver.h). Later solvers reuse the memory of the first one, so they may be no larger than it
+	until memory is reserved again. The solver is lost when memory is reserved again.
+
+	Returns 0 on success, 1 if there is not enough reserved memory left or the solver is larger than the first one.
+*/
+int kai_engine_create_solver(struct kai_engine_t* engine, size_t size);
+
+/**
+	Attach the engine to the transposition table in shared memory with the given name, so it shares search results with
+	every engine (in any local process) attached to the same name. The first to attach creates the table with size bytes.
+	Replaces any table the engine had.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_engine_attach_shared_table(struct kai_engine_t* engine, const char* name, size_t size);
+
+/**
+	Return the number of table lookups made by this engine, and how many of them found their position.
+	Both are 0 if the engine has no table.
+*/
+void kai_engine_table_counts(const struct kai_engine_t* engine, long long* probes, long long* hits);
+
+/**
+	Set the position to search. The search is done from the perspective of the player to move.
+*/
+void kai_engine_set_position(struct kai_engine_t* engine, const struct kai_board_state_t* board_state);
+
+/**
+	Set the position to search from a board string in the format of KAI_COMMAND_BOARD.
+*/
+void kai_engine_set_position_string(struct kai_engine_t* engine, const char* board_string);
+
+/**
+	Set the number of root moves (1 - KAI_AMBO_COUNT) that following searches find exact scores and principal variations for.
+	They are reported, best first, in the lines of kai_search_info_t. Defaults to 1.
+*/
+void kai_engine_set_multi_pv(struct kai_engine_t* engine, int multi_pv);
+
+/**
+	Set the evaluation and search parameters of following searches. Engines start out with the defaults of kai_parameters_init().
+*/
+void kai_engine_set_parameters(struct kai_engine_t* engine, const struct kai_parameters_t* parameters);
+
+/**
+	Set whether following searches count hardware events (cycles, instructions, branch and cache misses) on the thread
+	running them. The counts are reported in the counters of kai_search_info_t, or as -1 where they are not available.
+*/
+void kai_engine_count_events(struct kai_engine_t* engine, int enabled);
+
+/**
+	Set whether following searches build on the principal variation of the search before them. A search of a position
+	on that variation starts at the depth that was already searched below it, and if that is at least the depth limit
+	(or KAI_MINIMAX_INSTANT_DEPTH without one), replies with the rest of the variation without searching.
+	Together with a transposition table, the results of the previous search are reused. Off by default.
+*/
+void kai_engine_reuse_tree(struct kai_engine_t* engine, int enabled);
+
+/**
+	Record every following search into a tree file (see kalahai_tree.h), or stop recording if tree is NULL. The writer
+	must stay open while the engine searches. Searches limited by depth or nodes record the same tree every time.
+*/
+void kai_engine_record_tree(struct kai_engine_t* engine, struct kai_tree_writer_t* tree);
+
+/**
+	Search the current position within the given limits. Blocks until the search is done.
+	callbacks and result may be NULL. If result is not NULL, it receives the deepest completed iteration.
+
+	Returns the ambo to make a move from (indexed 1 to 6), or -1 if there is no valid move or the search could not be started.
+*/
+int kai_engine_search(struct kai_engine_t* engine, const struct kai_engine_limits_t* limits, const struct kai_engine_callbacks_t* callbacks, struct kai_search_info_t* result);
+
+/**
+	Stop a running search. May be called from any thread. The search returns the best move found so far. Called
+	before a search starts, it stops that search as soon as it starts.
+*/
+void kai_engine_stop(struct kai_engine_t* engine);
+
+#endif
@@ -0,0 +1,261 @@
+#include "kalahai_log.h"
+
+
+/**
+	Format one record.
+*/
+static void kai_log_write_record(FILE* file, const struct kai_log_record_t* record)
+{
+	char board_string[KAI_COMMAND_MAX_SIZE];
+
+	if (record->type == KAI_LOG_RECORD_TEXT)
+		fputs(record->format, file);
+	else if (record->type == KAI_LOG_RECORD_VALUES)
+		fprintf(file, record->format, record->data.values[0], record->data.values[1], record->data.values[2]);
+	else if (record->type == KAI_LOG_RECORD_BOARD)
+	{
+		kai_format_board_state(&record->data.board_state, board_string);
+		fprintf(file, record->format, board_string);
+	}
+	else if (record->type == KAI_LOG_RECORD_ITERATION)
+		kai_search_write_iteration(&record->data.iteration, file);
+}
+
+/**
+	Find room for a record. Without a ring, the record is made in local and written at once by kai_log_commit().
+
+	Returns the record to fill in, or NULL if it is dropped.
+*/
+static struct kai_log_record_t* kai_log_begin(struct kai_log_ring_t* ring, int level, int type, struct kai_log_record_t* local)
+{
+	long head;
+	struct kai_log_record_t* record = local;
+
+	if (ring != NULL)
+	{
+		if (level > ring->log->level)
+			return NULL;
+
+		// Only this thread moves the head, the writer moves the tail.
+		head = ring->head;
+		if ((unsigned long) head - (unsigned long) kai_atomic_load(&ring->tail) >= KAI_LOG_RING_RECORDS)
+		{
+			kai_atomic_store(&ring->dropped, ring->dropped + 1);
+			return NULL;
+		}
+
+		record = &ring->records[head & (KAI_LOG_RING_RECORDS - 1)];
+		record->sequence = kai_atomic_add(&ring->log->sequence, 1);
+	}
+
+	record->type = type;
+	return record;
+}
+
+/**
+	Hand a record from kai_log_begin() to the writer, or write it if there is no ring.
+*/
+static void kai_log_commit(struct kai_log_ring_t* ring, const struct kai_log_record_t* record)
+{
+	if (ring == NULL)
+		kai_log_write_record(stdout, record);
+	else
+		kai_atomic_store(&ring->head, ring->head + 1);
+}
+
+/**
+	Write the records in the rings, in the order they were made, and flush the file once.
+*/
+static void kai_log_write(struct kai_log_t* log)
+{
+	int i;
+	int next;
+	int written = 0;
+	int ring_count = (int) kai_atomic_load(&log->ring_count);
+	long dropped = 0;
+	long heads[KAI_LOG_MAX_RINGS];
+	const struct kai_log_record_t* record;
+	const struct kai_log_record_t* next_record = NULL;
+
+	// Only the records added so far are written, so a busy thread cannot keep the writer from flushing.
+	for (i = 0; i < ring_count; ++i)
+		heads[i] = kai_atomic_load(&log->rings[i]->head);
+
+	while (1)
+	{
+		next = -1;
+		for (i = 0; i < ring_count; ++i)
+		{
+			if (log->rings[i]->tail == heads[i])
+				continue;
+
+			record = &log->rings[i]->records[log->rings[i]->tail & (KAI_LOG_RING_RECORDS - 1)];
+			if (next == -1 || record->sequence < next_record->sequence)
+			{
+				next = i;
+				next_record = record;
+			}
+		}
+
+		if (next == -1)
+			break;
+
+		kai_log_write_record(log->file, next_record);
+		kai_atomic_store(&log->rings[next]->tail, log->rings[next]->tail + 1);
+		written = 1;
+	}
+
+	for (i = 0; i < ring_count; ++i)
+		dropped += kai_atomic_load(&log->rings[i]->dropped);
+	if (dropped != log->reported_dropped)
+	{
+		fprintf(log->file, "Dropped %ld log records.\n", dropped - log->reported_dropped);
+		log->reported_dropped = dropped;
+		written = 1;
+	}
+
+	if (written)
+		fflush(log->file);
+}
+
+/**
+	The writer thread. Writes the records every KAI_LOG_WRITE_INTERVAL seconds, and once more when stopped.
+*/
+static void kai_log_thread(void* argument)
+{
+	struct kai_log_t* log = (struct kai_log_t*) argument;
+	int stopped = 0;
+
+	while (!stopped)
+	{
+		stopped = kai_event_wait(&log->stop, KAI_LOG_WRITE_INTERVAL);
+		kai_log_write(log);
+	}
+}
+
+int kai_log_start(struct kai_log_t* log, FILE* file, int level)
+{
+	log->file = file;
+	log->level = level;
+	log->ring_count = 0;
+	log->sequence = 0;
+	log->reported_dropped = 0;
+	kai_mutex_init(&log->ring_mutex);
+	kai_event_init(&log->stop);
+
+	if (kai_thread_create(&log->thread, kai_log_thread, log) != 0)
+	{
+		fprintf(stderr, "Failed to start the log thread.\n");
+		kai_event_destroy(&log->stop);
+		kai_mutex_destroy(&log->ring_mutex);
+		return 1;
+	}
+
+	return 0;
+}
+
+void kai_log_stop(struct kai_log_t* log)
+{
+	int i;
+
+	kai_event_set(&log->stop);
+	kai_thread_join(&log->thread);
+
+	for (i = 0; i < log->ring_count; ++i)
+		free(log->rings[i]);
+	log->ring_count = 0;
+
+	kai_event_destroy(&log->stop);
+	kai_mutex_destroy(&log->ring_mutex);
+}
+
+struct kai_log_ring_t* kai_log_ring_create(struct kai_log_t* log)
+{
+	struct kai_log_ring_t* ring;
+
+	ring = (struct kai_log_ring_t*) malloc(sizeof(*ring));
+	if (ring == NULL)
+		return NULL;
+
+	ring->log = log;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->dropped = 0;
+
+	// The writer only looks at the rings below ring_count, so the ring is stored before the count is raised.
+	kai_mutex_lock(&log->ring_mutex);
+	if (log->ring_count < KAI_LOG_MAX_RINGS)
+	{
+		log->rings[log->ring_count] = ring;
+		kai_atomic_store(&log->ring_count, log->ring_count + 1);
+	}
+	else
+	{
+		free(ring);
+		ring = NULL;
+	}
+	kai_mutex_unlock(&log->ring_mutex);
+
+	return ring;
+}
+
+void kai_log_text(struct kai_log_ring_t* ring, int level, const char* text)
+{
+	struct kai_log_record_t local;
+	struct kai_log_record_t* record = kai_log_begin(ring, level, KAI_LOG_RECORD_TEXT, &local);
+
+	if (record == NULL)
+		return;
+
+	record->format = text;
+	kai_log_commit(ring, record);
+}
+
+void kai_log_values(struct kai_log_ring_t* ring, int level, const char* format, long long first, long long second, long long third)
+{
+	struct kai_log_record_t local;
+	struct kai_log_record_t* record = kai_log_begin(ring, level, KAI_LOG_RECORD_VALUES, &local);
+
+	if (record == NULL)
+		return;
+
+	record->format = format;
+	record->data.values[0] = first;
+	record->data.values[1] = second;
+	record->data.values[2] = third;
+	kai_log_commit(ring, record);
+}
+
+void kai_log_board(struct kai_log_ring_t* ring, int level, const char* format, const struct kai_board_state_t* board_state)
+{
+	struct kai_log_record_t local;
+	struct kai_log_record_t* record = kai_log_begin(ring, level, KAI_LOG_RECORD_BOARD, &local);
+
+	if (record == NULL)
+		return;
+
+	record->format = format;
+	record->data.board_state = *board_state;
+	kai_log_commit(ring, record);
+}
+
+void kai_log_iteration(struct kai_log_ring_t* ring, int level, const struct kai_search_info_t* info)
+{
+	struct kai_log_record_t local;
+	struct kai_log_record_t* record = kai_log_begin(ring, level, KAI_LOG_RECORD_ITERATION, &local);
+
+	if (record == NULL)
+		return;
+
+	// The lines belong to the search, and change under the writer.
+	record->format = NULL;
+	record->data.iteration = *info;
+	record->data.iteration.lines = NULL;
+	record->data.iteration.line_count = 0;
+	kai_log_commit(ring, record);
+}
+
+void kai_search_log_iteration(const struct kai_search_info_t* info, void* user_data)
+{
+	KAI_LOG_ITERATION((struct kai_log_ring_t*) user_data, KAI_LOG_DEBUG, info);
+}
@@ -0,0 +1,181 @@
+#ifndef KALAHAI_LOG_H
+#define KALAHAI_LOG_H
+
+#include "kalahai.h"
+#include "kalahai_platform.h"
+
+
+/**
+	DEFINES
+*/
+
+/*
+	Logging.
+
+	Every thread that logs has a ring of its own (kai_log_ring_create()), which only that thread writes to. Log calls
+	copy their arguments into a binary record in the ring and return, and a writer thread takes the records from all
+	rings, formats them and writes them out in batches. A full ring drops the record rather than wait, so a thread
+	never blocks on the output. A NULL ring writes the record to stdout at once instead.
+*/
+
+// Log levels, from the most to the least important.
+#define KAI_LOG_ERROR 1
+#define KAI_LOG_INFO 2
+#define KAI_LOG_DEBUG 3
+
+// The most detailed level compiled in. Log calls through the KAI_LOG_* macros above it are removed at compile time.
+#ifndef KAI_LOG_MAX_LEVEL
+#define KAI_LOG_MAX_LEVEL KAI_LOG_DEBUG
+#endif
+
+#define KAI_LOG_ENABLED(level) ((level) <= KAI_LOG_MAX_LEVEL)
+
+// Record types. The fields of kai_log_record_t are described for every type there.
+#define KAI_LOG_RECORD_TEXT 1
+#define KAI_LOG_RECORD_VALUES 2
+#define KAI_LOG_RECORD_BOARD 3
+#define KAI_LOG_RECORD_ITERATION 4
+
+// The number of records in a ring (a power of two), and the number of rings of one log.
+#define KAI_LOG_RING_RECORDS 1024
+#define KAI_LOG_MAX_RINGS 16
+
+// The number of integers a KAI_LOG_RECORD_VALUES holds.
+#define KAI_LOG_VALUE_COUNT 3
+
+// The time in seconds the writer waits between taking the records out of the rings.
+#define KAI_LOG_WRITE_INTERVAL 0.01
+
+// Log calls that are compiled out above KAI_LOG_MAX_LEVEL.
+#define KAI_LOG_TEXT(ring, level, text) \
+	(KAI_LOG_ENABLED(level) ? kai_log_text((ring), (level), (text)) : (void) 0)
+#define KAI_LOG_VALUES(ring, level, format, first, second, third) \
+	(KAI_LOG_ENABLED(level) ? kai_log_values((ring), (level), (format), (first), (second), (third)) : (void) 0)
+#define KAI_LOG_BOARD(ring, level, format, board_state) \
+	(KAI_LOG_ENABLED(level) ? kai_log_board((ring), (level), (format), (board_state)) : (void) 0)
+#define KAI_LOG_ITERATION(ring, level, info) \
+	(KAI_LOG_ENABLED(level) ? kai_log_iteration((ring), (level), (info)) : (void) 0)
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	One log message, as it waits in a ring. The formats are string literals, only the pointers are kept.
+
+	KAI_LOG_RECORD_TEXT: text is written as it is.
+	KAI_LOG_RECORD_VALUES: format is written with the values, which it takes as %lld.
+	KAI_LOG_RECORD_BOARD: format is written with the board (as kai_format_board_state() writes it), which it takes as %s.
+	KAI_LOG_RECORD_ITERATION: iteration is written like kai_search_print_iteration() does. Its lines are not kept.
+*/
+struct kai_log_record_t
+{
+	int type;
+
+	// The order the record was made in, across all rings of the log.
+	long sequence;
+
+	const char* format;
+	union
+	{
+		long long values[KAI_LOG_VALUE_COUNT];
+		struct kai_board_state_t board_state;
+		struct kai_search_info_t iteration;
+	} data;
+};
+
+/**
+	The records of one thread, written by that thread and read by the writer.
+*/
+struct kai_log_ring_t
+{
+	// The log the ring belongs to.
+	struct kai_log_t* log;
+
+	// The number of records ever added and taken. Only the thread of the ring adds, and only the writer takes.
+	kai_atomic_t head;
+	kai_atomic_t tail;
+
+	// The number of records dropped because the ring was full.
+	kai_atomic_t dropped;
+
+	struct kai_log_record_t records[KAI_LOG_RING_RECORDS];
+};
+
+/**
+	A log and its writer thread. Start with kai_log_start().
+*/
+struct kai_log_t
+{
+	// The file the records are written to.
+	FILE* file;
+
+	// Records above this level are dropped at once.
+	int level;
+
+	// The rings of the log. Rings are only added while the log runs, never removed.
+	struct kai_log_ring_t* rings[KAI_LOG_MAX_RINGS];
+	kai_atomic_t ring_count;
+	struct kai_mutex_t ring_mutex;
+
+	// Numbers the records across all rings.
+	kai_atomic_t sequence;
+
+	// The records dropped so far, as last reported by the writer.
+	long reported_dropped;
+
+	struct kai_thread_t thread;
+	struct kai_event_t stop;
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Start the writer thread of a log, writing to the given file. Records above level are dropped.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_log_start(struct kai_log_t* log, FILE* file, int level);
+
+/**
+	Write the remaining records, stop the writer thread and free the rings. No thread may log to the rings any more.
+*/
+void kai_log_stop(struct kai_log_t* log);
+
+/**
+	Add a ring to the log, for the calling thread or a thread it is about to start.
+
+	Returns the ring, or NULL if there is no memory or room for it (logging to NULL writes to stdout directly).
+*/
+struct kai_log_ring_t* kai_log_ring_create(struct kai_log_t* log);
+
+/**
+	Log a text.
+*/
+void kai_log_text(struct kai_log_ring_t* ring, int level, const char* text);
+
+/**
+	Log up to KAI_LOG_VALUE_COUNT integers by a format taking them as %lld.
+*/
+void kai_log_values(struct kai_log_ring_t* ring, int level, const char* format, long long first, long long second, long long third);
+
+/**
+	Log a board by a format taking it as %s.
+*/
+void kai_log_board(struct kai_log_ring_t* ring, int level, const char* format, const struct kai_board_state_t* board_state);
+
+/**
+	Log an iteration of a search.
+*/
+void kai_log_iteration(struct kai_log_ring_t* ring, int level, const struct kai_search_info_t* info);
+
+/**
+	A kai_search_t::callback that logs every iteration at KAI_LOG_DEBUG to the ring passed as user_data.
+*/
+void kai_search_log_iteration(const struct kai_search_info_t* info, void* user_data);
+
+#endif
@@ -1,32 +1,245 @@
 #include "kalahai.h"
+#include "kalahai_record.h"
+#include "kalahai_table.h"
+#include "kalahai_parameters.h"
+#include "kalahai_trace.h"
+#include "kalahai_tree.h"
+#include "kalahai_log.h"
+#include "kalahai_sched.h"
+#include "kalahai_pattern.h"
+
+// The trace of --trace. It is global so that a signal can ask for it to be printed.
+static struct kai_trace_t trace;
+
+/**
+	Ask for the trace to be printed at the start of the next turn.
+*/
+static void kai_request_trace(int signal_number)
+{
+	(void) signal_number;
+	trace.print_requested = 1;
+}
 
 /**
     Program entry point.
+
+	Usage: kalahai [--record <file>] [--shared-table <name> <megabytes>] [--parameters <file>] [--track] [--trace] [--counters]
+		[--nodes <count>] [--tree <file>] [--log-level <level>] [--pin] [--no-smt]
+		[--patterns <file>]
+	--record appends the game to the given game record file.
+	--shared-table shares search results with every local kalahai process using the same table name. The first
+	process to attach creates the table with the given size.
+	--parameters searches with the parameters in the given parameter file (as written by kalahai_tune).
+	--track keeps track of the board locally and only polls the server (with backoff) while the opponent is to move.
+	--trace prints latency histograms of receiving, parsing, searching, sending and the whole turn when the game ends,
+	and (where SIGUSR1 exists) at the next turn after a SIGUSR1.
+	--counters prints cycles, instructions, branch misses and cache misses per node after every iteration (Linux only).
+	--nodes limits every search to the given number of nodes instead of the time limit, so the same game is searched
+	the same way on every machine.
+	--tree records every search into the given tree file, for kalahai_replay.
+	--log-level sets what is printed: 1 for errors, 2 for the game as well, 3 (the default) for every iteration as well.
+	The output is written by a thread of its own, so neither the connection nor the search waits for it.
+	--pin pins the search thread to a processor of the affinity mask of the process, and --no-smt keeps it to the first
+	processor of a physical core. The processors, the CPU quota and the placement are logged at the start.
+	--patterns adds the values of the pattern file (as written by kalahai_patterns) to the evaluation.
 */
 int main(int argc, char* argv[])
 {
-	// Open the connection.
+	int i;
+	int result;
+	const char* record_path = NULL;
+	const char* tree_path = NULL;
+	const char* table_name = NULL;
+	const char* patterns_path = NULL;
+	size_t table_megabytes = 0;
+	int log_level = KAI_LOG_DEBUG;
+	int pin = 0;
+	int avoid_smt = 0;
+	struct kai_log_t log;
+	struct kai_sched_t sched;
+	struct kai_table_t table;
+	struct kai_parameters_t parameters;
+	struct kai_patterns_t patterns;
+	struct kai_run_options_t options;
 	struct kai_connection_t connection;
-	if (kai_open_connection(&connection, "127.0.0.1", "10101") != 0)
+
+	memset(&options, 0, sizeof(options));
+
+	for (i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			record_path = argv[++i];
+
+		if (strcmp(argv[i], "--shared-table") == 0 && i + 2 < argc)
+		{
+			table_name = argv[++i];
+			table_megabytes = (size_t) atoi(argv[++i]);
+		}
+
+		if (strcmp(argv[i], "--track") == 0)
+			options.track = 1;
+
+		if (strcmp(argv[i], "--counters") == 0)
+			options.count_events = 1;
+
+		if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc)
+			options.node_limit = atoll(argv[++i]);
+
+		if (strcmp(argv[i], "--tree") == 0 && i + 1 < argc)
+			tree_path = argv[++i];
+
+		if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc)
+			log_level = atoi(argv[++i]);
+
+		if (strcmp(argv[i], "--pin") == 0)
+			pin = 1;
+
+		if (strcmp(argv[i], "--no-smt") == 0)
+			avoid_smt = 1;
+
+		if (strcmp(argv[i], "--patterns") == 0 && i + 1 < argc)
+			patterns_path = argv[++i];
+
+		if (strcmp(argv[i], "--trace") == 0)
+		{
+			kai_trace_init(&trace);
+			options.trace = &trace;
+#ifdef SIGUSR1
+			signal(SIGUSR1, kai_request_trace);
+#endif
+		}
+
+		if (strcmp(argv[i], "--parameters") == 0 && i + 1 < argc)
+		{
+			kai_parameters_init(&parameters);
+			if (kai_parameters_load(&parameters, argv[++i]) != 0)
+			{
+				kai_console_pause();
+				return 1;
+			}
+
+			options.parameters = &parameters;
+		}
+	}
+
+	// The writer holds a whole game, so keep it off the stack.
+	if (record_path != NULL)
+	{
+		options.record = (struct kai_record_writer_t*) malloc(sizeof(*options.record));
+		if (options.record == NULL || kai_record_writer_open(options.record, record_path) != 0)
+		{
+			free(options.record);
+			kai_console_pause();
+			return 1;
+		}
+	}
+
+	if (table_name != NULL)
+	{
+		if (kai_table_attach(&table, table_name, table_megabytes * 1024 * 1024) != 0)
+		{
+			if (options.record != NULL)
+			{
+				kai_record_writer_close(options.record);
+				free(options.record);
+			}
+			kai_console_pause();
+			return 1;
+		}
+
+		options.table = &table;
+	}
+
+	// The writer buffers a block of events, so keep it off the stack as well.
+	if (tree_path != NULL)
+	{
+		options.tree = (struct kai_tree_writer_t*) malloc(sizeof(*options.tree));
+		if (options.tree == NULL || kai_tree_writer_open(options.tree, tree_path) != 0)
+		{
+			free(options.tree);
+			if (options.table != NULL)
+				kai_table_detach(options.table);
+			if (options.record != NULL)
+			{
+				kai_record_writer_close(options.record);
+				free(options.record);
+			}
+			kai_console_pause();
+			return 1;
+		}
+	}
+
+	// The patterns go with the parameters, whether they came from a file or not.
+	if (patterns_path != NULL)
 	{
-		getchar();
-		return 1;
+		if (kai_patterns_load(&patterns, patterns_path) != 0)
+		{
+			if (options.tree != NULL)
+			{
+				kai_tree_writer_close(options.tree);
+				free(options.tree);
+			}
+			if (options.table != NULL)
+				kai_table_detach(options.table);
+			if (options.record != NULL)
+			{
+				kai_record_writer_close(options.record);
+				free(options.record);
+			}
+			kai_console_pause();
+			return 1;
+		}
+
+		if (options.parameters == NULL)
+		{
+			kai_parameters_init(&parameters);
+			options.parameters = &parameters;
+		}
+		parameters.patterns = &patterns;
 	}
 
+	kai_sched_init(&sched, pin, avoid_smt);
+	options.sched = &sched;
+
+	// Without the log thread, everything is printed directly.
+	if (kai_log_start(&log, stdout, log_level) == 0)
+		options.log = &log;
+
+	// Open the connection.
+	result = kai_open_connection(&connection, "127.0.0.1", "10101");
+
 	// Run through the game.
-	if (kai_run(&connection) != 0)
+	if (result == 0)
 	{
-		getchar();
-		return 1;
+		result = kai_run(&connection, &options);
+
+		// Shutdown the connection.
+		if (kai_shutdown_connection(&connection) != 0)
+			result = 1;
 	}
 
-	// Shutdown the connection.
-	if (kai_shutdown_connection(&connection) != 0)
+	if (options.log != NULL)
+		kai_log_stop(options.log);
+
+	if (options.table != NULL)
+		kai_table_detach(options.table);
+
+	if (options.tree != NULL)
 	{
-		getchar();
-		return 1;
+		if (kai_tree_writer_close(options.tree) != 0)
+			result = 1;
+		free(options.tree);
 	}
 
-	getchar();
-    return 0;
-}
\ No newline at end of file
+	if (options.record != NULL)
+	{
+		kai_record_writer_close(options.record);
+		free(options.record);
+	}
+
+	if (patterns_path != NULL)
+		kai_patterns_unload(&patterns);
+
+	kai_console_pause();
+    return result;
+}
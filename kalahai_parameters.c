@@ -0,0 +1,105 @@
+#include "kalahai_parameters.h"
+
+
+const struct kai_parameter_info_t kai_parameter_infos[KAI_PARAMETER_COUNT] =
+{
+	{ "house_seed_weight", "KAI_MINIMAX_EVALUATION_HOUSE_SEED_WEIGHT", offsetof(struct kai_parameters_t, house_seed_weight), 0, 32, 1.0 },
+	{ "extra_turn_term", "KAI_MINIMAX_EVALUATION_EXTRA_TURN_TERM", offsetof(struct kai_parameters_t, extra_turn_term), 0, 500, 8.0 },
+	{ "start_depth", "KAI_MINIMAX_START_DEPTH", offsetof(struct kai_parameters_t, start_depth), 1, 16, 1.0 },
+	{ "depth_step", "KAI_MINIMAX_DEPTH_STEP", offsetof(struct kai_parameters_t, depth_step), 1, 4, 0.5 }
+};
+
+
+int* kai_parameters_value(struct kai_parameters_t* parameters, const struct kai_parameter_info_t* info)
+{
+	return (int*) ((unsigned char*) parameters + info->offset);
+}
+
+int kai_parameters_load(struct kai_parameters_t* parameters, const char* path)
+{
+	FILE* file;
+	char line[256];
+	char name[128];
+	int value;
+	int line_number = 0;
+	int i;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Failed to open parameter file %s\n", path);
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		++line_number;
+		if (line[0] == '#' || sscanf(line, "%127s", name) != 1)
+			continue;
+
+		for (i = 0; i < KAI_PARAMETER_COUNT && strcmp(name, kai_parameter_infos[i].name) != 0; ++i);
+		if (i == KAI_PARAMETER_COUNT || sscanf(line, "%*s %d", &value) != 1 ||
+			value < kai_parameter_infos[i].minimum || value > kai_parameter_infos[i].maximum)
+		{
+			fprintf(stderr, "%s:%d: Invalid parameter: %s", path, line_number, line);
+			fclose(file);
+			return 1;
+		}
+
+		*kai_parameters_value(parameters, &kai_parameter_infos[i]) = value;
+	}
+
+	fclose(file);
+	return 0;
+}
+
+int kai_parameters_save(const struct kai_parameters_t* parameters, const char* path)
+{
+	FILE* file;
+	int i;
+	int result = 0;
+
+	file = fopen(path, "w");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Failed to open parameter file %s\n", path);
+		return 1;
+	}
+
+	for (i = 0; i < KAI_PARAMETER_COUNT; ++i)
+	{
+		if (fprintf(file, "%s %d\n", kai_parameter_infos[i].name, *kai_parameters_value((struct kai_parameters_t*) parameters, &kai_parameter_infos[i])) < 0)
+			result = 1;
+	}
+
+	if (fclose(file) != 0)
+		result = 1;
+
+	return result;
+}
+
+int kai_parameters_save_header(const struct kai_parameters_t* parameters, const char* path)
+{
+	FILE* file;
+	int i;
+	int result = 0;
+
+	file = fopen(path, "w");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Failed to open header file %s\n", path);
+		return 1;
+	}
+
+	fprintf(file, "// Tuned parameters, written by kalahai_tune. Replace the defines in kalahai.h with these.\n");
+	for (i = 0; i < KAI_PARAMETER_COUNT; ++i)
+	{
+		if (fprintf(file, "#define %s %d\n", kai_parameter_infos[i].define, *kai_parameters_value((struct kai_parameters_t*) parameters, &kai_parameter_infos[i])) < 0)
+			result = 1;
+	}
+
+	if (fclose(file) != 0)
+		result = 1;
+
+	return result;
+}
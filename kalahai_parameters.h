@@ -0,0 +1,82 @@
+#ifndef KALAHAI_PARAMETERS_H
+#define KALAHAI_PARAMETERS_H
+
+#include "kalahai.h"
+#include <stddef.h>
+
+
+/**
+	DEFINES
+*/
+
+/*
+	Parameter files.
+
+	A parameter file is a text file with one "name value" pair per line, where name is one of the names in
+	kai_parameter_infos and value is an integer. Lines starting with # are comments. Parameters that are not
+	listed keep the value they had before the file was loaded.
+*/
+
+// The number of fields in kai_parameters_t.
+#define KAI_PARAMETER_COUNT 4
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	Describes one field of kai_parameters_t.
+*/
+struct kai_parameter_info_t
+{
+	// The name in parameter files, and the name of the define holding the default.
+	const char* name;
+	const char* define;
+
+	// The offset of the field in kai_parameters_t.
+	size_t offset;
+
+	// The range of sensible values.
+	int minimum;
+	int maximum;
+
+	// How far to move the parameter when probing for a better value while tuning.
+	double step;
+};
+
+// Every field of kai_parameters_t.
+extern const struct kai_parameter_info_t kai_parameter_infos[KAI_PARAMETER_COUNT];
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Return the field of parameters described by info.
+*/
+int* kai_parameters_value(struct kai_parameters_t* parameters, const struct kai_parameter_info_t* info);
+
+/**
+	Read a parameter file into parameters.
+
+	Returns 0 on success, 1 if the file cannot be read or has an unknown parameter or a value out of range.
+*/
+int kai_parameters_load(struct kai_parameters_t* parameters, const char* path);
+
+/**
+	Write parameters to a parameter file.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_parameters_save(const struct kai_parameters_t* parameters, const char* path);
+
+/**
+	Write parameters as a C header of defines, with the names used in kalahai.h.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_parameters_save_header(const struct kai_parameters_t* parameters, const char* path);
+
+#endif
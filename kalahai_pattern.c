@@ -0,0 +1,84 @@
+#include "kalahai_pattern.h"
+
+// The on-disk layout depends on these sizes.
+typedef char kai_pattern_header_size_check[sizeof(struct kai_pattern_file_header_t) == 16 ? 1 : -1];
+typedef char kai_pattern_entry_size_check[sizeof(struct kai_pattern_entry_t) == 2 ? 1 : -1];
+
+
+int kai_patterns_load(struct kai_patterns_t* patterns, const char* path)
+{
+	size_t i;
+	volatile unsigned char touched = 0;
+	const struct kai_pattern_file_header_t* header;
+
+	if (kai_file_map(&patterns->mapping, path) != 0)
+	{
+		fprintf(stderr, "Failed to map pattern file %s\n", path);
+		return 1;
+	}
+
+	header = (const struct kai_pattern_file_header_t*) patterns->mapping.data;
+	if (patterns->mapping.size != sizeof(*header) + KAI_PATTERN_COUNT * sizeof(struct kai_pattern_entry_t) ||
+		memcmp(header->magic, KAI_PATTERN_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != KAI_PATTERN_VERSION ||
+		header->seed_cap != KAI_PATTERN_SEED_CAP ||
+		header->unit != KAI_PATTERN_UNIT)
+	{
+		fprintf(stderr, "%s is not a version %d pattern file\n", path, KAI_PATTERN_VERSION);
+		kai_file_unmap(&patterns->mapping);
+		return 1;
+	}
+
+	patterns->entries = (const struct kai_pattern_entry_t*) (header + 1);
+
+	// The lookups are random, so fault in every page now rather than during a search.
+	for (i = 0; i < patterns->mapping.size; i += 4096)
+		touched += ((const unsigned char*) patterns->mapping.data)[i];
+
+	return 0;
+}
+
+void kai_patterns_unload(struct kai_patterns_t* patterns)
+{
+	kai_file_unmap(&patterns->mapping);
+	patterns->entries = NULL;
+}
+
+int kai_patterns_save(const struct kai_pattern_entry_t* entries, const char* path)
+{
+	FILE* file;
+	int result = 0;
+	struct kai_pattern_file_header_t header;
+
+	file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Failed to open pattern file %s\n", path);
+		return 1;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, KAI_PATTERN_MAGIC, sizeof(header.magic));
+	header.version = KAI_PATTERN_VERSION;
+	header.seed_cap = KAI_PATTERN_SEED_CAP;
+	header.unit = KAI_PATTERN_UNIT;
+	if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+		fwrite(entries, sizeof(struct kai_pattern_entry_t), KAI_PATTERN_COUNT, file) != KAI_PATTERN_COUNT)
+		result = 1;
+
+	if (fclose(file) != 0)
+		result = 1;
+
+	if (result != 0)
+		fprintf(stderr, "Failed to write pattern file %s\n", path);
+
+	return result;
+}
+
+void kai_pattern_ambos(unsigned int index, kai_ambo_t* ambos)
+{
+	int i;
+
+	for (i = 0; i < KAI_AMBO_COUNT; ++i)
+		ambos[i] = (kai_ambo_t) ((index >> (i * KAI_PATTERN_BITS)) & ((1 << KAI_PATTERN_BITS) - 1));
+}
@@ -0,0 +1,116 @@
+#ifndef KALAHAI_PATTERN_H
+#define KALAHAI_PATTERN_H
+
+#include "kalahai.h"
+#include "kalahai_platform.h"
+#include <stdint.h>
+
+
+/**
+	DEFINES
+*/
+
+/*
+	Pattern files.
+
+	A pattern file holds the values of the six ambos of one side, with every ambo capped at KAI_PATTERN_SEED_CAP
+	seeds, to the player of the side: one for when the player is to move, and one for when the opponent is. With
+	parameters->patterns set, the evaluation adds the value of our side and subtracts the value of the opponent's
+	side, which is two table lookups per leaf.
+
+	The file starts with a kai_pattern_file_header_t, followed by KAI_PATTERN_COUNT kai_pattern_entry_t, indexed by
+	KAI_PATTERN_INDEX(). The header is in the byte order of the machine that built the file. Values are bytes in
+	units of KAI_PATTERN_UNIT, and both values of a side are next to each other, so that the whole table (512 KB)
+	stays in the L2 cache and a side costs one cache line whichever player is to move. Pattern files are built by
+	kalahai_patterns, which fits them to the outcomes of self-play games.
+*/
+
+// The magic bytes at the start of a pattern file.
+#define KAI_PATTERN_MAGIC "KAIPAT"
+
+// The version of the format.
+#define KAI_PATTERN_VERSION 1
+
+// Ambos with more seeds than this count as this many. A cap of 7 keeps every ambo that can reach the house with its
+// last seed apart, as well as the empty ambos that set up captures.
+#define KAI_PATTERN_SEED_CAP 7
+
+// The bits of every ambo in an index, and the number of patterns.
+#define KAI_PATTERN_BITS 3
+#define KAI_PATTERN_COUNT (1 << (KAI_PATTERN_BITS * KAI_AMBO_COUNT))
+
+// The evaluation points of a unit of a pattern value (one seed in a house with the default parameters).
+#define KAI_PATTERN_UNIT 4
+
+// The index of the six ambos of a side, from the first ambo (furthest from the house) to the last.
+#define KAI_PATTERN_SEEDS(seeds) ((seeds) < KAI_PATTERN_SEED_CAP ? (unsigned int) (seeds) : (unsigned int) KAI_PATTERN_SEED_CAP)
+#define KAI_PATTERN_INDEX(ambos) \
+	(KAI_PATTERN_SEEDS((ambos)[0]) | KAI_PATTERN_SEEDS((ambos)[1]) << KAI_PATTERN_BITS | \
+	KAI_PATTERN_SEEDS((ambos)[2]) << (2 * KAI_PATTERN_BITS) | KAI_PATTERN_SEEDS((ambos)[3]) << (3 * KAI_PATTERN_BITS) | \
+	KAI_PATTERN_SEEDS((ambos)[4]) << (4 * KAI_PATTERN_BITS) | KAI_PATTERN_SEEDS((ambos)[5]) << (5 * KAI_PATTERN_BITS))
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	The start of a pattern file.
+*/
+struct kai_pattern_file_header_t
+{
+	char magic[6];
+	uint16_t version;
+	uint16_t seed_cap;
+	uint16_t unit;
+	uint8_t reserved[4];
+};
+
+/**
+	The values of a side to its player, with the player to move and with the opponent to move.
+*/
+struct kai_pattern_entry_t
+{
+	int8_t to_move;
+	int8_t waiting;
+};
+
+/**
+	The pattern tables of a pattern file, mapped into memory.
+*/
+struct kai_patterns_t
+{
+	struct kai_file_mapping_t mapping;
+	const struct kai_pattern_entry_t* entries;
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Map a pattern file, and read it through once so that the evaluation does not wait for the disk.
+
+	Returns 0 on success, 1 if the file cannot be mapped or is not a pattern file.
+*/
+int kai_patterns_load(struct kai_patterns_t* patterns, const char* path);
+
+/**
+	Unmap a pattern file mapped by kai_patterns_load().
+*/
+void kai_patterns_unload(struct kai_patterns_t* patterns);
+
+/**
+	Write a pattern file of KAI_PATTERN_COUNT entries.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_patterns_save(const struct kai_pattern_entry_t* entries, const char* path);
+
+/**
+	Fill in the six ambos of the pattern at index (the inverse of KAI_PATTERN_INDEX()).
+*/
+void kai_pattern_ambos(unsigned int index, kai_ambo_t* ambos);
+
+#endif
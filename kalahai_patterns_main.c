@@ -0,0 +1,348 @@
+#include "kalahai_engine.h"
+#include "kalahai_pattern.h"
+#include "kalahai_parameters.h"
+#include <math.h>
+
+// Every game starts with this many random moves, and after that one move in KAI_PATTERNS_RANDOM_RATE is random, so
+// that the games do not repeat.
+#define KAI_PATTERNS_RANDOM_PLIES 6
+#define KAI_PATTERNS_RANDOM_RATE 10
+
+// Games longer than this are cut off, and scored as they stand.
+#define KAI_PATTERNS_MAX_PLIES 400
+
+/**
+	A position of a self-play game: the patterns of the side to move and of the opponent, the evaluation of the
+	position without patterns and what it should have been, both for the side to move.
+*/
+struct kai_patterns_sample_t
+{
+	uint32_t own;
+	uint32_t opponent;
+	int16_t evaluation;
+	int16_t target;
+};
+
+/**
+	The self-play games of a build, shared by all threads.
+*/
+struct kai_patterns_build_t
+{
+	// The parameters the games are played and evaluated with, and the node limit of every move.
+	const struct kai_parameters_t* parameters;
+	long long nodes;
+
+	// The number of games, the index of the next game to play, and the seed of the random moves.
+	long game_count;
+	kai_atomic_t next_game;
+	unsigned long long seed;
+
+	// KAI_PATTERNS_MAX_PLIES samples for every game, and the number of them used.
+	struct kai_patterns_sample_t* samples;
+	int* sample_counts;
+};
+
+/**
+	One thread of a build.
+*/
+struct kai_patterns_thread_t
+{
+	struct kai_patterns_build_t* build;
+	struct kai_thread_t thread;
+	int started;
+};
+
+
+/**
+	Return the next number of a xorshift sequence.
+*/
+static unsigned long long kai_patterns_random(unsigned long long* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+
+	return *state;
+}
+
+/**
+	Play one game against itself, and record every position after the random opening. Every position is scored with
+	the final seed difference of the game, for its side to move, in house seeds.
+*/
+static void kai_patterns_play_game(struct kai_engine_t* engine, struct kai_patterns_build_t* build, long game)
+{
+	int i;
+	int ply;
+	int move;
+	int seeds;
+	int margin;
+	int count = 0;
+	unsigned long long random_state = (build->seed + (unsigned long long) game) * 0x9E3779B97F4A7C15ULL + 1;
+	kai_ambo_index_t first_ambo;
+	struct kai_board_state_t board_state;
+	struct kai_game_state_t state;
+	struct kai_engine_limits_t limits;
+	struct kai_search_info_t info;
+	struct kai_patterns_sample_t* samples = &build->samples[game * KAI_PATTERNS_MAX_PLIES];
+	kai_player_id_t players[KAI_PATTERNS_MAX_PLIES];
+
+	limits.depth = 0;
+	limits.nodes = build->nodes;
+	limits.time = 0.0;
+	kai_parse_board_state(&board_state, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+
+	for (ply = 0; ply < KAI_PATTERNS_MAX_PLIES; ++ply)
+	{
+		if (kai_is_game_over(&board_state) ||
+			board_state.seeds[KAI_SOUTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD ||
+			board_state.seeds[KAI_NORTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD)
+			break;
+
+		first_ambo = board_state.player == 1 ? KAI_SOUTH_START : KAI_NORTH_START;
+		for (i = 0, seeds = 0; i < KAI_AMBO_COUNT; ++i)
+			seeds += board_state.seeds[first_ambo + i];
+		if (seeds == 0)
+			break;
+
+		if (ply >= KAI_PATTERNS_RANDOM_PLIES)
+		{
+			kai_game_state_init(&state, board_state.player);
+			samples[count].own = KAI_PATTERN_INDEX(&board_state.seeds[state.player_first_ambo]);
+			samples[count].opponent = KAI_PATTERN_INDEX(&board_state.seeds[state.opponent_first_ambo]);
+			samples[count].evaluation = kai_minimax_node_evaluation(&state, build->parameters, &board_state, NULL);
+			players[count] = board_state.player;
+			++count;
+		}
+
+		if (ply < KAI_PATTERNS_RANDOM_PLIES || kai_patterns_random(&random_state) % KAI_PATTERNS_RANDOM_RATE == 0)
+		{
+			do
+				move = (int) (kai_patterns_random(&random_state) % KAI_AMBO_COUNT) + 1;
+			while (board_state.seeds[first_ambo + move - 1] == 0);
+		}
+		else
+		{
+			kai_engine_set_position(engine, &board_state);
+			move = kai_engine_search(engine, &limits, NULL, &info);
+		}
+
+		kai_play_move(&board_state, (kai_ambo_index_t) (first_ambo + move - 1));
+	}
+
+	// The seeds left on a side count for its player.
+	margin = board_state.seeds[KAI_SOUTH_HOUSE] - board_state.seeds[KAI_NORTH_HOUSE];
+	for (i = 0; i < KAI_AMBO_COUNT; ++i)
+		margin += board_state.seeds[KAI_SOUTH_START + i] - board_state.seeds[KAI_NORTH_START + i];
+
+	for (i = 0; i < count; ++i)
+		samples[i].target = (int16_t) (build->parameters->house_seed_weight * (players[i] == 1 ? margin : -margin));
+
+	build->sample_counts[game] = count;
+}
+
+/**
+	Thread entry point. Plays games of the kai_patterns_build_t of the kai_patterns_thread_t passed as argument until
+	none are left.
+*/
+static void kai_patterns_thread(void* argument)
+{
+	struct kai_patterns_thread_t* thread = (struct kai_patterns_thread_t*) argument;
+	struct kai_patterns_build_t* build = thread->build;
+	struct kai_engine_t* engine;
+	long game;
+
+	engine = kai_engine_create();
+	if (engine == NULL)
+		return;
+
+	kai_engine_set_parameters(engine, build->parameters);
+	while ((game = kai_atomic_add(&build->next_game, 1) - 1) < build->game_count)
+		kai_patterns_play_game(engine, build, game);
+
+	kai_engine_destroy(engine);
+}
+
+/**
+	Fit the tables to the samples of the games, by stochastic gradient descent on the squared error of the evaluation
+	with the patterns against the targets. Every step pulls the two values it moves towards 0 by decay, so that rare
+	patterns stay small.
+
+	Returns the root mean square error of the last epoch.
+*/
+static double kai_patterns_fit(const struct kai_patterns_build_t* build, int epochs, double rate, double decay, double* to_move, double* waiting)
+{
+	int epoch;
+	int i;
+	long game;
+	long count = 0;
+	double error;
+	double squared_error = 0.0;
+	const struct kai_patterns_sample_t* sample;
+
+	for (epoch = 0; epoch < epochs; ++epoch)
+	{
+		count = 0;
+		squared_error = 0.0;
+		for (game = 0; game < build->game_count; ++game)
+		{
+			for (i = 0; i < build->sample_counts[game]; ++i)
+			{
+				sample = &build->samples[game * KAI_PATTERNS_MAX_PLIES + i];
+				error = sample->target - (sample->evaluation + to_move[sample->own] - waiting[sample->opponent]);
+				to_move[sample->own] += rate * (error - decay * to_move[sample->own]);
+				waiting[sample->opponent] -= rate * (error + decay * waiting[sample->opponent]);
+
+				squared_error += error * error;
+				++count;
+			}
+		}
+	}
+
+	return count > 0 ? sqrt(squared_error / count) : 0.0;
+}
+
+/**
+	Round a fitted value, in evaluation points, to the nearest pattern value.
+*/
+static int8_t kai_patterns_round(double value)
+{
+	value = floor(value / KAI_PATTERN_UNIT + 0.5);
+	if (value > INT8_MAX)
+		return INT8_MAX;
+	if (value < -INT8_MAX)
+		return -INT8_MAX;
+
+	return (int8_t) value;
+}
+
+/**
+	Program entry point.
+
+	Usage: kalahai_patterns <pattern file> [--games <n>] [--nodes <n>] [--epochs <n>] [--rate <r>] [--decay <d>]
+	                        [--seed <n>] [--threads <n>] [--parameters <file>]
+
+	Builds a pattern file (see kalahai_pattern.h) for 'kalahai --patterns' from self-play. The engine plays the given
+	number of games against itself (3000 unless given) with a node limit on every move (3000 unless given), and every
+	position is scored with the final seed difference of its game. The pattern tables are then fitted so that the
+	evaluation with them comes closer to those scores. The games are played on as many threads as the process may run
+	at once, unless --threads is given. The same arguments build the same file.
+*/
+int main(int argc, char* argv[])
+{
+	int i;
+	int started = 0;
+	int epochs = 6;
+	int thread_count = kai_cpu_count();
+	double rate = 0.01;
+	double decay = 0.05;
+	double error;
+	long samples = 0;
+	const char* path = NULL;
+	double* to_move;
+	double* waiting;
+	struct kai_pattern_entry_t* entries;
+	struct kai_timer_t timer;
+	struct kai_parameters_t parameters;
+	struct kai_patterns_build_t build;
+	struct kai_patterns_thread_t* threads;
+	int result;
+
+	kai_parameters_init(&parameters);
+	build.parameters = &parameters;
+	build.nodes = 3000;
+	build.game_count = 3000;
+	build.next_game = 0;
+	build.seed = 1;
+
+	for (i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+			build.game_count = atol(argv[++i]);
+		else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc)
+			build.nodes = atoll(argv[++i]);
+		else if (strcmp(argv[i], "--epochs") == 0 && i + 1 < argc)
+			epochs = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+			rate = atof(argv[++i]);
+		else if (strcmp(argv[i], "--decay") == 0 && i + 1 < argc)
+			decay = atof(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			build.seed = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			thread_count = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--parameters") == 0 && i + 1 < argc)
+		{
+			if (kai_parameters_load(&parameters, argv[++i]) != 0)
+				return 1;
+		}
+		else if (path == NULL && argv[i][0] != '-')
+			path = argv[i];
+		else
+		{
+			fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (path == NULL || build.game_count < 1 || build.nodes < 1 || epochs < 1 || thread_count < 1)
+	{
+		fprintf(stderr, "Usage: %s <pattern file> [--games <n>] [--nodes <n>] [--epochs <n>] [--rate <r>] [--decay <d>] [--seed <n>] [--threads <n>] [--parameters <file>]\n", argv[0]);
+		return 1;
+	}
+
+	build.samples = (struct kai_patterns_sample_t*) malloc(build.game_count * KAI_PATTERNS_MAX_PLIES * sizeof(struct kai_patterns_sample_t));
+	build.sample_counts = (int*) calloc(build.game_count, sizeof(int));
+	to_move = (double*) calloc(KAI_PATTERN_COUNT, sizeof(double));
+	waiting = (double*) calloc(KAI_PATTERN_COUNT, sizeof(double));
+	entries = (struct kai_pattern_entry_t*) malloc(KAI_PATTERN_COUNT * sizeof(struct kai_pattern_entry_t));
+	threads = (struct kai_patterns_thread_t*) malloc(thread_count * sizeof(struct kai_patterns_thread_t));
+	if (build.samples == NULL || build.sample_counts == NULL || to_move == NULL || waiting == NULL || entries == NULL || threads == NULL)
+	{
+		free(build.samples);
+		free(build.sample_counts);
+		free(to_move);
+		free(waiting);
+		free(entries);
+		free(threads);
+		return 1;
+	}
+
+	// Play on all threads. Falls back on the calling thread if no thread could be started.
+	kai_timer_start(&timer);
+	for (i = 0; i < thread_count; ++i)
+	{
+		threads[i].build = &build;
+		threads[i].started = kai_thread_create(&threads[i].thread, kai_patterns_thread, &threads[i]) == 0;
+		started += threads[i].started;
+	}
+	for (i = 0; i < thread_count; ++i)
+	{
+		if (threads[i].started)
+			kai_thread_join(&threads[i].thread);
+	}
+	if (started == 0)
+		kai_patterns_thread(&threads[0]);
+
+	for (i = 0; i < build.game_count; ++i)
+		samples += build.sample_counts[i];
+	fprintf(stdout, "Played %ld games with %ld positions in %f seconds.\n", build.game_count, samples, kai_timer_get_time(&timer));
+
+	error = kai_patterns_fit(&build, epochs, rate, decay, to_move, waiting);
+	fprintf(stdout, "Fitted the patterns in %d epochs, with a root mean square error of %.2f.\n", epochs, error);
+
+	for (i = 0; i < KAI_PATTERN_COUNT; ++i)
+	{
+		entries[i].to_move = kai_patterns_round(to_move[i]);
+		entries[i].waiting = kai_patterns_round(waiting[i]);
+	}
+	result = kai_patterns_save(entries, path);
+
+	free(build.samples);
+	free(build.sample_counts);
+	free(to_move);
+	free(waiting);
+	free(entries);
+	free(threads);
+
+	return result;
+}
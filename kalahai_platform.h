@@ -0,0 +1,384 @@
+#ifndef KALAHAI_PLATFORM_H
+#define KALAHAI_PLATFORM_H
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+
+
+/**
+	DEFINES
+*/
+
+// Socket constants that differ between WinSock and BSD sockets.
+#ifdef _WIN32
+#define KAI_INVALID_SOCKET INVALID_SOCKET
+#define KAI_SOCKET_ERROR SOCKET_ERROR
+#define KAI_SHUTDOWN_BOTH SD_BOTH
+#else
+#define KAI_INVALID_SOCKET (-1)
+#define KAI_SOCKET_ERROR (-1)
+#define KAI_SHUTDOWN_BOTH SHUT_RDWR
+#endif
+
+// Atomic operations on a kai_atomic_t. Loads have acquire and stores have release semantics.
+// The kai_atomic64_* operations work on 64-bit integers and give no ordering guarantees, only untorn values.
+#ifdef _MSC_VER
+#define kai_atomic_load(p) (*(p))
+#define kai_atomic_store(p, v) ((void) InterlockedExchange((p), (v)))
+#define kai_atomic_add(p, v) (InterlockedExchangeAdd((p), (v)) + (v))
+#define kai_atomic64_load_relaxed(p) (*(p))
+#define kai_atomic64_store_relaxed(p, v) (*(p) = (v))
+#else
+#define kai_atomic_load(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define kai_atomic_store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define kai_atomic_add(p, v) __atomic_add_fetch((p), (v), __ATOMIC_ACQ_REL)
+#define kai_atomic64_load_relaxed(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define kai_atomic64_store_relaxed(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#endif
+
+// The hardware events counted by kai_counters_open(), as indices into the counted values.
+#define KAI_COUNTER_CYCLES 0
+#define KAI_COUNTER_INSTRUCTIONS 1
+#define KAI_COUNTER_BRANCH_MISSES 2
+#define KAI_COUNTER_L1D_MISSES 3
+#define KAI_COUNTER_LLC_MISSES 4
+#define KAI_COUNTER_COUNT 5
+
+// Keep the console window open before exiting on Windows, where it closes together with the program.
+#ifdef _WIN32
+#define kai_console_pause() getchar()
+#else
+#define kai_console_pause()
+#endif
+
+// Pass as the timeout to kai_event_wait() to wait forever.
+#define KAI_WAIT_INFINITE -1.0
+
+// The most processors kai_cpu_topology_read() reports.
+#define KAI_MAX_CPUS 256
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+#ifdef _WIN32
+typedef SOCKET kai_socket_t;
+#else
+typedef int kai_socket_t;
+#endif
+
+/**
+	An integer that can be shared between threads through the kai_atomic_* macros.
+*/
+typedef volatile long kai_atomic_t;
+
+/**
+	The entry point of a thread started by kai_thread_create().
+*/
+typedef void (*kai_thread_function_t)(void* argument);
+
+/**
+	Manages one timer instance. The timer is monotonic on every platform.
+*/
+struct kai_timer_t
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER start;
+#else
+	struct timespec start;
+#endif
+};
+
+/**
+	Manages one thread. Must stay alive until kai_thread_join() has returned.
+*/
+struct kai_thread_t
+{
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+
+	// The function the thread runs and its argument.
+	kai_thread_function_t function;
+	void* argument;
+};
+
+/**
+	A plain (non-recursive) mutex.
+*/
+struct kai_mutex_t
+{
+#ifdef _WIN32
+	CRITICAL_SECTION section;
+#else
+	pthread_mutex_t mutex;
+#endif
+};
+
+/**
+	A read-only memory mapping of a whole file.
+*/
+struct kai_file_mapping_t
+{
+	// The contents of the file, and its size in bytes.
+	const void* data;
+	size_t size;
+
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+};
+
+/**
+	A block of memory shared by every process that opens it by the same name.
+*/
+struct kai_shared_memory_t
+{
+	// The shared memory, and its size in bytes.
+	void* data;
+	size_t size;
+
+#ifdef _WIN32
+	HANDLE mapping;
+#endif
+};
+
+/**
+	Hardware performance counters of one thread.
+*/
+struct kai_counters_t
+{
+	// The file of every counter, or -1 if the event cannot be counted.
+	int files[KAI_COUNTER_COUNT];
+};
+
+/**
+	The processors the process may run on.
+*/
+struct kai_cpu_topology_t
+{
+	// The processors in the affinity mask of the process, and the physical core of each. SMT siblings have the same
+	// core (the lowest processor of the core).
+	int cpus[KAI_MAX_CPUS];
+	int cores[KAI_MAX_CPUS];
+	int cpu_count;
+
+	// The number of distinct physical cores among the processors.
+	int core_count;
+
+	// The processor time the process may use per second, from the cgroup v2 cpu.max of its cgroup and their parents,
+	// or 0 if it is not limited.
+	double quota;
+
+	// The number of threads worth running at once: the processors, limited by the quota rounded down (at least 1),
+	// so that busy threads are not throttled by the quota.
+	int thread_count;
+};
+
+/**
+	An auto-reset event. Setting it releases one waiter (or the next thread to wait).
+*/
+struct kai_event_t
+{
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	pthread_mutex_t mutex;
+	pthread_cond_t condition;
+	int signaled;
+#endif
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Initialize the socket layer. Must be called before any socket is opened.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_platform_startup();
+
+/**
+	Clean up after kai_platform_startup().
+*/
+void kai_platform_cleanup();
+
+/**
+	Return the error code of the last failed socket call.
+*/
+int kai_socket_last_error();
+
+/**
+	Close a socket.
+*/
+void kai_socket_close(kai_socket_t socket);
+
+/**
+	Start measuring time and store that state in the timer structure.
+*/
+void kai_timer_start(struct kai_timer_t* timer);
+
+/**
+	Calculate the time since kai_timer_start was called with the timer parameter.
+*/
+double kai_timer_get_time(const struct kai_timer_t* timer);
+
+/**
+	Block the calling thread for the given number of seconds.
+*/
+void kai_sleep(double seconds);
+
+/**
+	Return the number of threads worth running at once: the processors in the affinity mask of the process, limited by
+	its CPU quota (see kai_cpu_topology_t).
+*/
+int kai_cpu_count();
+
+/**
+	Find the processors the process may run on, their physical cores and the CPU quota of the process. Where these
+	cannot be read, every online processor is taken as a core of its own, without a quota.
+*/
+void kai_cpu_topology_read(struct kai_cpu_topology_t* topology);
+
+/**
+	Map size bytes of zeroed, page aligned memory for long-lived tables. Huge pages are tried first
+	(explicit huge pages, then transparent huge pages), falling back on normal pages.
+	size is rounded up to a whole number of pages; mapped_size receives the size actually mapped.
+
+	Returns NULL on failure.
+*/
+void* kai_memory_map(size_t size, size_t* mapped_size);
+
+/**
+	Unmap memory returned by kai_memory_map(). size is the mapped size.
+*/
+void kai_memory_unmap(void* memory, size_t size);
+
+/**
+	Return the size of the pages actually backing the memory returned by kai_memory_map(). Transparent huge pages
+	are only assigned when the memory is touched, so this should be called after the memory has been written to.
+*/
+size_t kai_memory_page_size(void* memory);
+
+/**
+	Map a whole file read-only into memory. The mapping is hinted for sequential access.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_file_map(struct kai_file_mapping_t* mapping, const char* path);
+
+/**
+	Unmap a file mapped by kai_file_map().
+*/
+void kai_file_unmap(struct kai_file_mapping_t* mapping);
+
+/**
+	Create a file for binary writing, if it does not exist. Creating the file and finding that it exists are one
+	operation, so of several processes creating the same file at once, exactly one gets it.
+
+	Returns the file, or NULL if it already exists or cannot be created.
+*/
+FILE* kai_file_create(const char* path);
+
+/**
+	Open the shared memory with the given name, creating it with size zeroed bytes if it does not exist.
+	created receives 1 if this call created the memory, 0 if it already existed (in which case its existing size is used).
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_shared_memory_open(struct kai_shared_memory_t* memory, const char* name, size_t size, int* created);
+
+/**
+	Unmap shared memory opened by kai_shared_memory_open(). The memory itself lives on until it is unlinked.
+*/
+void kai_shared_memory_close(struct kai_shared_memory_t* memory);
+
+/**
+	Remove the shared memory with the given name, once every process has closed it.
+	On Windows, shared memory is removed when the last process closes it, so this does nothing.
+*/
+void kai_shared_memory_unlink(const char* name);
+
+/**
+	Start counting the KAI_COUNTER_* hardware events of the calling thread in user space. Only available on Linux
+	(through perf_event_open), and only for the events the processor and the perf_event_paranoid setting allow.
+
+	Returns 0 if at least one event is counted, 1 otherwise.
+*/
+int kai_counters_open(struct kai_counters_t* counters);
+
+/**
+	Read the counts of every event since kai_counters_open() into values, indexed by KAI_COUNTER_*. Counts are scaled
+	up if the kernel had to share the hardware counters between events. Events that are not counted read -1.
+*/
+void kai_counters_read(const struct kai_counters_t* counters, long long* values);
+
+/**
+	Stop counting the events of kai_counters_open().
+*/
+void kai_counters_close(struct kai_counters_t* counters);
+
+/**
+	Start a new thread running function(argument).
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_thread_create(struct kai_thread_t* thread, kai_thread_function_t function, void* argument);
+
+/**
+	Block until the given thread has finished.
+*/
+void kai_thread_join(struct kai_thread_t* thread);
+
+/**
+	Restrict the calling thread to run on the given processor only (as in kai_cpu_topology_t::cpus).
+
+	Returns 0 on success, 1 if the thread cannot be pinned.
+*/
+int kai_thread_pin(int cpu);
+
+void kai_mutex_init(struct kai_mutex_t* mutex);
+void kai_mutex_destroy(struct kai_mutex_t* mutex);
+void kai_mutex_lock(struct kai_mutex_t* mutex);
+void kai_mutex_unlock(struct kai_mutex_t* mutex);
+
+void kai_event_init(struct kai_event_t* event);
+void kai_event_destroy(struct kai_event_t* event);
+
+/**
+	Signal the event, releasing one waiter.
+*/
+void kai_event_set(struct kai_event_t* event);
+
+/**
+	Wait until the event is signaled or timeout seconds have passed (KAI_WAIT_INFINITE to wait forever).
+
+	Returns 1 if the event was signaled, 0 on timeout.
+*/
+int kai_event_wait(struct kai_event_t* event, double timeout);
+
+#endif
@@ -0,0 +1,658 @@
+// For the affinity mask of threads (sched_getaffinity() and sched_setaffinity()).
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "kalahai_platform.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sched.h>
+#endif
+
+// Used when the huge page size cannot be read from /proc/meminfo.
+#define KAI_DEFAULT_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+
+int kai_platform_startup()
+{
+	return 0;
+}
+
+void kai_platform_cleanup()
+{
+}
+
+int kai_socket_last_error()
+{
+	return errno;
+}
+
+void kai_socket_close(kai_socket_t socket)
+{
+	close(socket);
+}
+
+void kai_timer_start(struct kai_timer_t* timer)
+{
+	clock_gettime(CLOCK_MONOTONIC, &timer->start);
+}
+
+double kai_timer_get_time(const struct kai_timer_t* timer)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - timer->start.tv_sec) + (now.tv_nsec - timer->start.tv_nsec) / 1e9;
+}
+
+void kai_sleep(double seconds)
+{
+	struct timespec duration;
+	duration.tv_sec = (time_t) seconds;
+	duration.tv_nsec = (long) ((seconds - duration.tv_sec) * 1e9);
+
+	// Keep sleeping for the remainder if a signal interrupts us.
+	while (nanosleep(&duration, &duration) != 0 && errno == EINTR);
+}
+
+int kai_cpu_count()
+{
+	struct kai_cpu_topology_t topology;
+
+	kai_cpu_topology_read(&topology);
+	return topology.thread_count;
+}
+
+#ifdef __linux__
+/**
+	Read the physical core of a processor: the lowest processor among its SMT siblings.
+*/
+static int kai_cpu_core(int cpu)
+{
+	FILE* file;
+	char path[128];
+	int core = cpu;
+
+	sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+	file = fopen(path, "r");
+	if (file == NULL)
+		return cpu;
+
+	// The list is sorted, as in "0,8" or "0-1".
+	if (fscanf(file, "%d", &core) != 1)
+		core = cpu;
+	fclose(file);
+
+	return core;
+}
+
+/**
+	Read the CPU quota of the cgroup (v2) of the process, in processors. A quota on a parent cgroup applies as well,
+	so the smallest quota on the way to the root is taken.
+
+	Returns the quota, or 0 if there is none.
+*/
+static double kai_cgroup_quota()
+{
+	FILE* file;
+	char line[512];
+	char path[600];
+	char* cgroup = NULL;
+	char* slash;
+	long long quota;
+	long long period;
+	double limit = 0.0;
+
+	file = fopen("/proc/self/cgroup", "r");
+	if (file == NULL)
+		return 0.0;
+
+	// The cgroup v2 hierarchy is the line "0::<path>".
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		if (strncmp(line, "0::/", 4) == 0)
+		{
+			cgroup = line + 3;
+			cgroup[strcspn(cgroup, "\n")] = '\0';
+			break;
+		}
+	}
+	fclose(file);
+
+	if (cgroup == NULL)
+		return 0.0;
+
+	while (1)
+	{
+		// cpu.max is "<quota> <period>" in microseconds, or "max <period>" without a quota.
+		sprintf(path, "/sys/fs/cgroup%s/cpu.max", strcmp(cgroup, "/") == 0 ? "" : cgroup);
+		file = fopen(path, "r");
+		if (file != NULL)
+		{
+			if (fscanf(file, "%lld %lld", &quota, &period) == 2 && quota > 0 && period > 0 &&
+				(limit == 0.0 || (double) quota / period < limit))
+				limit = (double) quota / period;
+			fclose(file);
+		}
+
+		if (strcmp(cgroup, "/") == 0)
+			break;
+
+		slash = strrchr(cgroup, '/');
+		if (slash == cgroup)
+			slash[1] = '\0';
+		else
+			*slash = '\0';
+	}
+
+	return limit;
+}
+#endif
+
+void kai_cpu_topology_read(struct kai_cpu_topology_t* topology)
+{
+	int i;
+	int j;
+	long online;
+#ifdef __linux__
+	cpu_set_t set;
+#endif
+
+	topology->cpu_count = 0;
+	topology->quota = 0.0;
+
+#ifdef __linux__
+	if (sched_getaffinity(0, sizeof(set), &set) == 0)
+	{
+		for (i = 0; i < CPU_SETSIZE && topology->cpu_count < KAI_MAX_CPUS; ++i)
+		{
+			if (!CPU_ISSET(i, &set))
+				continue;
+
+			topology->cpus[topology->cpu_count] = i;
+			topology->cores[topology->cpu_count] = kai_cpu_core(i);
+			topology->cpu_count++;
+		}
+	}
+
+	topology->quota = kai_cgroup_quota();
+#endif
+
+	if (topology->cpu_count == 0)
+	{
+		online = sysconf(_SC_NPROCESSORS_ONLN);
+		if (online < 1)
+			online = 1;
+
+		for (i = 0; i < online && i < KAI_MAX_CPUS; ++i)
+		{
+			topology->cpus[i] = i;
+			topology->cores[i] = i;
+		}
+		topology->cpu_count = i;
+	}
+
+	topology->core_count = 0;
+	for (i = 0; i < topology->cpu_count; ++i)
+	{
+		for (j = 0; j < i && topology->cores[j] != topology->cores[i]; ++j);
+		topology->core_count += j == i;
+	}
+
+	topology->thread_count = topology->cpu_count;
+	if (topology->quota > 0.0 && topology->quota < topology->thread_count)
+		topology->thread_count = topology->quota >= 1.0 ? (int) topology->quota : 1;
+}
+
+/**
+	Read the default huge page size of the system.
+*/
+static size_t kai_huge_page_size()
+{
+	FILE* file;
+	char line[128];
+	unsigned long kilobytes = 0;
+
+	file = fopen("/proc/meminfo", "r");
+	if (file == NULL)
+		return KAI_DEFAULT_HUGE_PAGE_SIZE;
+
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		if (sscanf(line, "Hugepagesize: %lu kB", &kilobytes) == 1)
+			break;
+	}
+
+	fclose(file);
+
+	return kilobytes != 0 ? kilobytes * 1024 : KAI_DEFAULT_HUGE_PAGE_SIZE;
+}
+
+void* kai_memory_map(size_t size, size_t* mapped_size)
+{
+	size_t huge_page_size = kai_huge_page_size();
+	size_t rounded_size = (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+	unsigned char* memory;
+	unsigned char* aligned;
+
+#ifdef MAP_HUGETLB
+	// Explicit huge pages only work if the administrator has reserved them, but are guaranteed when they do.
+	memory = (unsigned char*) mmap(NULL, rounded_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (memory != MAP_FAILED)
+	{
+		*mapped_size = rounded_size;
+		return memory;
+	}
+#endif
+
+	// Otherwise, map normal pages aligned to a huge page boundary and ask for transparent huge pages.
+	// Map one huge page extra, so the mapping can be trimmed to start on the boundary.
+	memory = (unsigned char*) mmap(NULL, rounded_size + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED)
+		return NULL;
+
+	aligned = (unsigned char*) (((uintptr_t) memory + huge_page_size - 1) / huge_page_size * huge_page_size);
+	if (aligned != memory)
+		munmap(memory, aligned - memory);
+	munmap(aligned + rounded_size, (memory + rounded_size + huge_page_size) - (aligned + rounded_size));
+
+#ifdef MADV_HUGEPAGE
+	madvise(aligned, rounded_size, MADV_HUGEPAGE);
+#endif
+
+	*mapped_size = rounded_size;
+	return aligned;
+}
+
+void kai_memory_unmap(void* memory, size_t size)
+{
+	munmap(memory, size);
+}
+
+size_t kai_memory_page_size(void* memory)
+{
+	FILE* file;
+	char line[256];
+	unsigned long start;
+	unsigned long end;
+	unsigned long address = (unsigned long) (uintptr_t) memory;
+	unsigned long kernel_page_size = 0;
+	unsigned long anonymous_huge_pages = 0;
+	unsigned long value;
+	int in_mapping = 0;
+
+	// Find the mapping in /proc/self/smaps and read what it is backed by.
+	file = fopen("/proc/self/smaps", "r");
+	if (file == NULL)
+		return (size_t) sysconf(_SC_PAGESIZE);
+
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		// Every mapping starts with a "start-end" address range line, followed by its fields.
+		if (sscanf(line, "%lx-%lx ", &start, &end) == 2)
+		{
+			if (in_mapping)
+				break;
+
+			in_mapping = address >= start && address < end;
+			continue;
+		}
+
+		if (!in_mapping)
+			continue;
+
+		if (sscanf(line, "KernelPageSize: %lu kB", &value) == 1)
+			kernel_page_size = value * 1024;
+		else if (sscanf(line, "AnonHugePages: %lu kB", &value) == 1)
+			anonymous_huge_pages = value * 1024;
+	}
+
+	fclose(file);
+
+	if (kernel_page_size == 0)
+		return (size_t) sysconf(_SC_PAGESIZE);
+
+	// Transparent huge pages show up as anonymous huge pages in a mapping with normal kernel pages.
+	if (anonymous_huge_pages > 0 && kernel_page_size < kai_huge_page_size())
+		return kai_huge_page_size();
+
+	return kernel_page_size;
+}
+
+int kai_file_map(struct kai_file_mapping_t* mapping, const char* path)
+{
+	int file;
+	struct stat status;
+	void* data;
+
+	file = open(path, O_RDONLY);
+	if (file == -1)
+		return 1;
+
+	if (fstat(file, &status) != 0)
+	{
+		close(file);
+		return 1;
+	}
+
+	mapping->size = (size_t) status.st_size;
+	mapping->data = NULL;
+	if (mapping->size > 0)
+	{
+		data = mmap(NULL, mapping->size, PROT_READ, MAP_SHARED, file, 0);
+		if (data == MAP_FAILED)
+		{
+			close(file);
+			return 1;
+		}
+
+		madvise(data, mapping->size, MADV_SEQUENTIAL);
+		mapping->data = data;
+	}
+
+	// The mapping stays valid after the file is closed.
+	close(file);
+
+	return 0;
+}
+
+void kai_file_unmap(struct kai_file_mapping_t* mapping)
+{
+	if (mapping->data != NULL)
+		munmap((void*) mapping->data, mapping->size);
+
+	mapping->data = NULL;
+	mapping->size = 0;
+}
+
+FILE* kai_file_create(const char* path)
+{
+	int file;
+	FILE* stream;
+
+	file = open(path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+	if (file == -1)
+		return NULL;
+
+	stream = fdopen(file, "wb");
+	if (stream == NULL)
+		close(file);
+
+	return stream;
+}
+
+int kai_shared_memory_open(struct kai_shared_memory_t* memory, const char* name, size_t size, int* created)
+{
+	int file;
+	struct stat status;
+	void* data;
+	char path[256];
+
+	// POSIX shared memory names start with a single slash.
+	snprintf(path, sizeof(path), "/%s", name);
+
+	*created = 1;
+	file = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (file == -1 && errno == EEXIST)
+	{
+		*created = 0;
+		file = shm_open(path, O_RDWR, 0600);
+	}
+
+	if (file == -1)
+		return 1;
+
+	if (*created)
+	{
+		if (ftruncate(file, (off_t) size) != 0)
+		{
+			close(file);
+			shm_unlink(path);
+			return 1;
+		}
+	}
+	else
+	{
+		if (fstat(file, &status) != 0)
+		{
+			close(file);
+			return 1;
+		}
+
+		size = (size_t) status.st_size;
+	}
+
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	close(file);
+	if (data == MAP_FAILED)
+		return 1;
+
+	memory->data = data;
+	memory->size = size;
+
+	return 0;
+}
+
+void kai_shared_memory_close(struct kai_shared_memory_t* memory)
+{
+	munmap(memory->data, memory->size);
+	memory->data = NULL;
+	memory->size = 0;
+}
+
+void kai_shared_memory_unlink(const char* name)
+{
+	char path[256];
+
+	snprintf(path, sizeof(path), "/%s", name);
+	shm_unlink(path);
+}
+
+int kai_counters_open(struct kai_counters_t* counters)
+{
+	int i;
+	int result = 1;
+#ifdef __linux__
+	struct perf_event_attr attributes;
+	static const unsigned int types[KAI_COUNTER_COUNT] =
+	{
+		PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE
+	};
+	static const unsigned long long configs[KAI_COUNTER_COUNT] =
+	{
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_BRANCH_MISSES,
+		PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+	};
+#endif
+
+	for (i = 0; i < KAI_COUNTER_COUNT; ++i)
+	{
+		counters->files[i] = -1;
+
+#ifdef __linux__
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = types[i];
+		attributes.config = configs[i];
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		// This thread, on any CPU.
+		counters->files[i] = (int) syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+		if (counters->files[i] != -1)
+			result = 0;
+#endif
+	}
+
+	return result;
+}
+
+void kai_counters_read(const struct kai_counters_t* counters, long long* values)
+{
+	int i;
+	unsigned long long data[3];
+
+	for (i = 0; i < KAI_COUNTER_COUNT; ++i)
+	{
+		values[i] = -1;
+		if (counters->files[i] == -1 || read(counters->files[i], data, sizeof(data)) != (ssize_t) sizeof(data))
+			continue;
+
+		// data holds the count, the time the event was enabled and the time it was actually counted.
+		if (data[2] == 0)
+			values[i] = 0;
+		else if (data[2] < data[1])
+			values[i] = (long long) ((double) data[0] * data[1] / data[2]);
+		else
+			values[i] = (long long) data[0];
+	}
+}
+
+void kai_counters_close(struct kai_counters_t* counters)
+{
+	int i;
+
+	for (i = 0; i < KAI_COUNTER_COUNT; ++i)
+	{
+		if (counters->files[i] != -1)
+			close(counters->files[i]);
+		counters->files[i] = -1;
+	}
+}
+
+static void* kai_thread_entry(void* argument)
+{
+	struct kai_thread_t* thread = (struct kai_thread_t*) argument;
+	thread->function(thread->argument);
+
+	return NULL;
+}
+
+int kai_thread_create(struct kai_thread_t* thread, kai_thread_function_t function, void* argument)
+{
+	thread->function = function;
+	thread->argument = argument;
+
+	return pthread_create(&thread->handle, NULL, kai_thread_entry, thread) == 0 ? 0 : 1;
+}
+
+void kai_thread_join(struct kai_thread_t* thread)
+{
+	pthread_join(thread->handle, NULL);
+}
+
+int kai_thread_pin(int cpu)
+{
+#ifdef __linux__
+	cpu_set_t set;
+
+	if (cpu < 0 || cpu >= CPU_SETSIZE)
+		return 1;
+
+	// A pid of 0 is the calling thread.
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return sched_setaffinity(0, sizeof(set), &set) == 0 ? 0 : 1;
+#else
+	(void) cpu;
+	return 1;
+#endif
+}
+
+void kai_mutex_init(struct kai_mutex_t* mutex)
+{
+	pthread_mutex_init(&mutex->mutex, NULL);
+}
+
+void kai_mutex_destroy(struct kai_mutex_t* mutex)
+{
+	pthread_mutex_destroy(&mutex->mutex);
+}
+
+void kai_mutex_lock(struct kai_mutex_t* mutex)
+{
+	pthread_mutex_lock(&mutex->mutex);
+}
+
+void kai_mutex_unlock(struct kai_mutex_t* mutex)
+{
+	pthread_mutex_unlock(&mutex->mutex);
+}
+
+void kai_event_init(struct kai_event_t* event)
+{
+	pthread_condattr_t attributes;
+
+	// Use the monotonic clock for timed waits, so they are not affected by changes to the wall clock.
+	pthread_condattr_init(&attributes);
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+
+	pthread_mutex_init(&event->mutex, NULL);
+	pthread_cond_init(&event->condition, &attributes);
+	pthread_condattr_destroy(&attributes);
+
+	event->signaled = 0;
+}
+
+void kai_event_destroy(struct kai_event_t* event)
+{
+	pthread_cond_destroy(&event->condition);
+	pthread_mutex_destroy(&event->mutex);
+}
+
+void kai_event_set(struct kai_event_t* event)
+{
+	pthread_mutex_lock(&event->mutex);
+	event->signaled = 1;
+	pthread_cond_signal(&event->condition);
+	pthread_mutex_unlock(&event->mutex);
+}
+
+int kai_event_wait(struct kai_event_t* event, double timeout)
+{
+	struct timespec deadline;
+	int result = 0;
+
+	if (timeout >= 0.0)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += (time_t) timeout;
+		deadline.tv_nsec += (long) ((timeout - (time_t) timeout) * 1e9);
+		if (deadline.tv_nsec >= 1000000000L)
+		{
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+	}
+
+	pthread_mutex_lock(&event->mutex);
+	while (!event->signaled && result == 0)
+	{
+		if (timeout >= 0.0)
+			result = pthread_cond_timedwait(&event->condition, &event->mutex, &deadline);
+		else
+			result = pthread_cond_wait(&event->condition, &event->mutex);
+	}
+
+	// Consume the signal (auto-reset).
+	result = event->signaled;
+	event->signaled = 0;
+	pthread_mutex_unlock(&event->mutex);
+
+	return result;
+}
@@ -0,0 +1,376 @@
+#include "kalahai_platform.h"
+
+#include <psapi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+
+int kai_platform_startup()
+{
+	int result;
+	WSADATA wsa_data;
+
+	result = WSAStartup(WINSOCK_VERSION, &wsa_data);
+	if (result != 0)
+	{
+		fprintf(stderr, "WSAStartup failed: %d\n", result);
+		return 1;
+	}
+
+	return 0;
+}
+
+void kai_platform_cleanup()
+{
+	WSACleanup();
+}
+
+int kai_socket_last_error()
+{
+	return WSAGetLastError();
+}
+
+void kai_socket_close(kai_socket_t socket)
+{
+	closesocket(socket);
+}
+
+void kai_timer_start(struct kai_timer_t* timer)
+{
+	QueryPerformanceFrequency(&timer->frequency);
+	QueryPerformanceCounter(&timer->start);
+}
+
+double kai_timer_get_time(const struct kai_timer_t* timer)
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	return (now.QuadPart - timer->start.QuadPart) / (double)timer->frequency.QuadPart;
+}
+
+void kai_sleep(double seconds)
+{
+	Sleep((DWORD) (seconds * 1000.0));
+}
+
+int kai_cpu_count()
+{
+	struct kai_cpu_topology_t topology;
+
+	kai_cpu_topology_read(&topology);
+	return topology.thread_count;
+}
+
+void kai_cpu_topology_read(struct kai_cpu_topology_t* topology)
+{
+	int i;
+	int j;
+	int bit;
+	DWORD size = 0;
+	DWORD_PTR process_mask;
+	DWORD_PTR system_mask;
+	SYSTEM_INFO info;
+	SYSTEM_LOGICAL_PROCESSOR_INFORMATION* cores = NULL;
+	int core_entries = 0;
+
+	topology->cpu_count = 0;
+	topology->quota = 0.0;
+
+	// Only the processors of the processor group of the process are seen, at most 64 of them.
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) || process_mask == 0)
+	{
+		GetSystemInfo(&info);
+		process_mask = info.dwNumberOfProcessors >= sizeof(DWORD_PTR) * 8 ? ~(DWORD_PTR) 0 : ((DWORD_PTR) 1 << info.dwNumberOfProcessors) - 1;
+	}
+
+	// The processors of each physical core, as a mask.
+	if (!GetLogicalProcessorInformation(NULL, &size) && GetLastError() == ERROR_INSUFFICIENT_BUFFER)
+	{
+		cores = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION*) malloc(size);
+		if (cores != NULL && GetLogicalProcessorInformation(cores, &size))
+			core_entries = (int) (size / sizeof(*cores));
+	}
+
+	for (i = 0; i < (int) sizeof(DWORD_PTR) * 8 && topology->cpu_count < KAI_MAX_CPUS; ++i)
+	{
+		if ((process_mask & ((DWORD_PTR) 1 << i)) == 0)
+			continue;
+
+		topology->cpus[topology->cpu_count] = i;
+		topology->cores[topology->cpu_count] = i;
+		for (j = 0; j < core_entries; ++j)
+		{
+			if (cores[j].Relationship != RelationProcessorCore || (cores[j].ProcessorMask & ((DWORD_PTR) 1 << i)) == 0)
+				continue;
+
+			// The core is its lowest processor.
+			for (bit = 0; (cores[j].ProcessorMask & ((DWORD_PTR) 1 << bit)) == 0; ++bit);
+			topology->cores[topology->cpu_count] = bit;
+			break;
+		}
+		topology->cpu_count++;
+	}
+	free(cores);
+
+	topology->core_count = 0;
+	for (i = 0; i < topology->cpu_count; ++i)
+	{
+		for (j = 0; j < i && topology->cores[j] != topology->cores[i]; ++j);
+		topology->core_count += j == i;
+	}
+
+	// There are no cgroups, so the processors are the limit.
+	topology->thread_count = topology->cpu_count;
+}
+
+void* kai_memory_map(size_t size, size_t* mapped_size)
+{
+	SYSTEM_INFO info;
+	SIZE_T large_page_size = GetLargePageMinimum();
+	size_t rounded_size;
+	void* memory;
+
+	// Large pages need the "Lock pages in memory" privilege, so this fails unless the user has been granted it.
+	if (large_page_size != 0)
+	{
+		rounded_size = (size + large_page_size - 1) / large_page_size * large_page_size;
+		memory = VirtualAlloc(NULL, rounded_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (memory != NULL)
+		{
+			*mapped_size = rounded_size;
+			return memory;
+		}
+	}
+
+	GetSystemInfo(&info);
+	rounded_size = (size + info.dwPageSize - 1) / info.dwPageSize * info.dwPageSize;
+	memory = VirtualAlloc(NULL, rounded_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if (memory == NULL)
+		return NULL;
+
+	*mapped_size = rounded_size;
+	return memory;
+}
+
+void kai_memory_unmap(void* memory, size_t size)
+{
+	VirtualFree(memory, 0, MEM_RELEASE);
+}
+
+size_t kai_memory_page_size(void* memory)
+{
+	SYSTEM_INFO info;
+	PSAPI_WORKING_SET_EX_INFORMATION working_set;
+
+	working_set.VirtualAddress = memory;
+	if (QueryWorkingSetEx(GetCurrentProcess(), &working_set, sizeof(working_set)) && working_set.VirtualAttributes.LargePage)
+		return GetLargePageMinimum();
+
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+}
+
+int kai_file_map(struct kai_file_mapping_t* mapping, const char* path)
+{
+	LARGE_INTEGER size;
+
+	mapping->data = NULL;
+	mapping->mapping = NULL;
+	mapping->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (mapping->file == INVALID_HANDLE_VALUE)
+		return 1;
+
+	if (!GetFileSizeEx(mapping->file, &size))
+	{
+		CloseHandle(mapping->file);
+		return 1;
+	}
+
+	mapping->size = (size_t) size.QuadPart;
+	if (mapping->size == 0)
+		return 0;
+
+	mapping->mapping = CreateFileMapping(mapping->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping->mapping == NULL)
+	{
+		CloseHandle(mapping->file);
+		return 1;
+	}
+
+	mapping->data = MapViewOfFile(mapping->mapping, FILE_MAP_READ, 0, 0, 0);
+	if (mapping->data == NULL)
+	{
+		CloseHandle(mapping->mapping);
+		CloseHandle(mapping->file);
+		return 1;
+	}
+
+	return 0;
+}
+
+void kai_file_unmap(struct kai_file_mapping_t* mapping)
+{
+	if (mapping->data != NULL)
+		UnmapViewOfFile(mapping->data);
+	if (mapping->mapping != NULL)
+		CloseHandle(mapping->mapping);
+	CloseHandle(mapping->file);
+
+	mapping->data = NULL;
+	mapping->size = 0;
+}
+
+FILE* kai_file_create(const char* path)
+{
+	int file;
+	FILE* stream;
+
+	file = _open(path, _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+	if (file == -1)
+		return NULL;
+
+	stream = _fdopen(file, "wb");
+	if (stream == NULL)
+		_close(file);
+
+	return stream;
+}
+
+int kai_shared_memory_open(struct kai_shared_memory_t* memory, const char* name, size_t size, int* created)
+{
+	char path[256];
+	MEMORY_BASIC_INFORMATION information;
+
+	_snprintf(path, sizeof(path), "Local\\%s", name);
+	path[sizeof(path) - 1] = '\0';
+
+	memory->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD) ((unsigned long long) size >> 32), (DWORD) size, path);
+	if (memory->mapping == NULL)
+		return 1;
+
+	*created = GetLastError() != ERROR_ALREADY_EXISTS;
+
+	memory->data = MapViewOfFile(memory->mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (memory->data == NULL)
+	{
+		CloseHandle(memory->mapping);
+		return 1;
+	}
+
+	// An existing mapping keeps the size it was created with.
+	VirtualQuery(memory->data, &information, sizeof(information));
+	memory->size = *created ? size : (size_t) information.RegionSize;
+
+	return 0;
+}
+
+void kai_shared_memory_close(struct kai_shared_memory_t* memory)
+{
+	UnmapViewOfFile(memory->data);
+	CloseHandle(memory->mapping);
+	memory->data = NULL;
+	memory->size = 0;
+}
+
+void kai_shared_memory_unlink(const char* name)
+{
+}
+
+int kai_counters_open(struct kai_counters_t* counters)
+{
+	int i;
+
+	for (i = 0; i < KAI_COUNTER_COUNT; ++i)
+		counters->files[i] = -1;
+
+	return 1;
+}
+
+void kai_counters_read(const struct kai_counters_t* counters, long long* values)
+{
+	int i;
+
+	for (i = 0; i < KAI_COUNTER_COUNT; ++i)
+		values[i] = -1;
+}
+
+void kai_counters_close(struct kai_counters_t* counters)
+{
+}
+
+static DWORD WINAPI kai_thread_entry(LPVOID argument)
+{
+	struct kai_thread_t* thread = (struct kai_thread_t*) argument;
+	thread->function(thread->argument);
+
+	return 0;
+}
+
+int kai_thread_create(struct kai_thread_t* thread, kai_thread_function_t function, void* argument)
+{
+	thread->function = function;
+	thread->argument = argument;
+	thread->handle = CreateThread(NULL, 0, kai_thread_entry, thread, 0, NULL);
+
+	return thread->handle != NULL ? 0 : 1;
+}
+
+void kai_thread_join(struct kai_thread_t* thread)
+{
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+}
+
+int kai_thread_pin(int cpu)
+{
+	if (cpu < 0 || cpu >= (int) sizeof(DWORD_PTR) * 8)
+		return 1;
+
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << cpu) != 0 ? 0 : 1;
+}
+
+void kai_mutex_init(struct kai_mutex_t* mutex)
+{
+	InitializeCriticalSection(&mutex->section);
+}
+
+void kai_mutex_destroy(struct kai_mutex_t* mutex)
+{
+	DeleteCriticalSection(&mutex->section);
+}
+
+void kai_mutex_lock(struct kai_mutex_t* mutex)
+{
+	EnterCriticalSection(&mutex->section);
+}
+
+void kai_mutex_unlock(struct kai_mutex_t* mutex)
+{
+	LeaveCriticalSection(&mutex->section);
+}
+
+void kai_event_init(struct kai_event_t* event)
+{
+	event->handle = CreateEvent(NULL, FALSE, FALSE, NULL);
+}
+
+void kai_event_destroy(struct kai_event_t* event)
+{
+	CloseHandle(event->handle);
+}
+
+void kai_event_set(struct kai_event_t* event)
+{
+	SetEvent(event->handle);
+}
+
+int kai_event_wait(struct kai_event_t* event, double timeout)
+{
+	DWORD milliseconds = timeout >= 0.0 ? (DWORD) (timeout * 1000.0) : INFINITE;
+
+	return WaitForSingleObject(event->handle, milliseconds) == WAIT_OBJECT_0 ? 1 : 0;
+}
@@ -0,0 +1,193 @@
+#include "kalahai_record.h"
+
+// The on-disk layout depends on these sizes.
+typedef char kai_record_game_size_check[sizeof(struct kai_record_game_t) == KAI_RECORD_SIZE ? 1 : -1];
+typedef char kai_record_ply_size_check[sizeof(struct kai_record_ply_t) == KAI_RECORD_SIZE ? 1 : -1];
+typedef char kai_record_header_size_check[sizeof(struct kai_record_file_header_t) == 16 ? 1 : -1];
+
+
+int kai_record_writer_open(struct kai_record_writer_t* writer, const char* path)
+{
+	struct kai_record_file_header_t header;
+	FILE* file;
+	int result;
+
+	// Only the process that creates the file writes the header, so processes opening a new file at once cannot
+	// both write one.
+	file = kai_file_create(path);
+	if (file != NULL)
+	{
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, KAI_RECORD_MAGIC, sizeof(header.magic));
+		header.version = KAI_RECORD_VERSION;
+		header.record_size = KAI_RECORD_SIZE;
+		result = fwrite(&header, sizeof(header), 1, file) != 1;
+		if (fclose(file) != 0 || result != 0)
+		{
+			fprintf(stderr, "Failed to write record file header to %s\n", path);
+			return 1;
+		}
+	}
+
+	writer->file = fopen(path, "ab");
+	if (writer->file == NULL)
+	{
+		fprintf(stderr, "Failed to open record file %s\n", path);
+		return 1;
+	}
+
+	// Unbuffered, so every game is appended with a single write.
+	setvbuf(writer->file, NULL, _IONBF, 0);
+
+	kai_record_writer_begin_game(writer, KAI_PLAYER_NONE);
+
+	return 0;
+}
+
+void kai_record_writer_close(struct kai_record_writer_t* writer)
+{
+	fclose(writer->file);
+}
+
+void kai_record_writer_begin_game(struct kai_record_writer_t* writer, kai_player_id_t player_id)
+{
+	memset(&writer->game, 0, sizeof(writer->game));
+	writer->game.type = KAI_RECORD_TYPE_GAME;
+	writer->game.player_id = player_id;
+}
+
+void kai_record_writer_add_ply(struct kai_record_writer_t* writer, const struct kai_board_state_t* board_state, int move, const struct kai_search_info_t* search)
+{
+	struct kai_record_ply_t* ply;
+
+	if (writer->game.ply_count >= KAI_RECORD_MAX_PLIES)
+		return;
+
+	ply = &writer->plies[writer->game.ply_count++];
+	memset(ply, 0, sizeof(*ply));
+	ply->type = KAI_RECORD_TYPE_PLY;
+	ply->player = board_state->player;
+	ply->move = (uint8_t) move;
+	memcpy(ply->seeds, board_state->seeds, sizeof(ply->seeds));
+
+	if (search != NULL)
+	{
+		ply->depth = (uint8_t) (search->depth < 255 ? search->depth : 255);
+		ply->score = search->score;
+		ply->nodes = (uint32_t) (search->nodes < UINT32_MAX ? search->nodes : UINT32_MAX);
+	}
+}
+
+int kai_record_writer_end_game(struct kai_record_writer_t* writer, kai_player_id_t winner)
+{
+	unsigned char buffer[(KAI_RECORD_MAX_PLIES + 1) * KAI_RECORD_SIZE];
+	size_t size;
+
+	writer->game.winner = winner;
+
+	// Write the game as one block, so games from several writers never interleave.
+	memcpy(buffer, &writer->game, sizeof(writer->game));
+	memcpy(buffer + sizeof(writer->game), writer->plies, writer->game.ply_count * sizeof(writer->plies[0]));
+	size = (writer->game.ply_count + 1) * KAI_RECORD_SIZE;
+
+	kai_record_writer_begin_game(writer, writer->game.player_id);
+
+	if (fwrite(buffer, size, 1, writer->file) != 1)
+	{
+		fprintf(stderr, "Failed to write game record\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+int kai_record_reader_open(struct kai_record_reader_t* reader, const char* path)
+{
+	const struct kai_record_file_header_t* header;
+	const struct kai_record_game_t* game;
+	size_t index;
+	size_t capacity = 1024;
+	size_t* games;
+
+	reader->games = NULL;
+	reader->game_count = 0;
+	reader->ply_count = 0;
+
+	if (kai_file_map(&reader->mapping, path) != 0)
+	{
+		fprintf(stderr, "Failed to map record file %s\n", path);
+		return 1;
+	}
+
+	header = (const struct kai_record_file_header_t*) reader->mapping.data;
+	if (reader->mapping.size < sizeof(*header) ||
+		memcmp(header->magic, KAI_RECORD_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != KAI_RECORD_VERSION ||
+		header->record_size != KAI_RECORD_SIZE)
+	{
+		fprintf(stderr, "%s is not a version %d record file\n", path, KAI_RECORD_VERSION);
+		kai_file_unmap(&reader->mapping);
+		return 1;
+	}
+
+	reader->records = (const struct kai_record_ply_t*) (header + 1);
+	reader->record_count = (reader->mapping.size - sizeof(*header)) / KAI_RECORD_SIZE;
+
+	reader->games = (size_t*) malloc(capacity * sizeof(size_t));
+	if (reader->games == NULL)
+	{
+		kai_file_unmap(&reader->mapping);
+		return 1;
+	}
+
+	// Index the games by hopping from game record to game record. Only the game records are touched.
+	index = 0;
+	while (index < reader->record_count)
+	{
+		game = (const struct kai_record_game_t*) &reader->records[index];
+		if (game->type != KAI_RECORD_TYPE_GAME || index + 1 + game->ply_count > reader->record_count)
+			break;
+
+		if (reader->game_count == capacity)
+		{
+			capacity *= 2;
+			games = (size_t*) realloc(reader->games, capacity * sizeof(size_t));
+			if (games == NULL)
+			{
+				free(reader->games);
+				kai_file_unmap(&reader->mapping);
+				return 1;
+			}
+
+			reader->games = games;
+		}
+
+		reader->games[reader->game_count++] = index;
+		reader->ply_count += game->ply_count;
+		index += 1 + game->ply_count;
+	}
+
+	return 0;
+}
+
+void kai_record_reader_close(struct kai_record_reader_t* reader)
+{
+	free(reader->games);
+	kai_file_unmap(&reader->mapping);
+}
+
+const struct kai_record_game_t* kai_record_reader_game(const struct kai_record_reader_t* reader, size_t index, const struct kai_record_ply_t** plies)
+{
+	const struct kai_record_ply_t* record = &reader->records[reader->games[index]];
+
+	if (plies != NULL)
+		*plies = record + 1;
+
+	return (const struct kai_record_game_t*) record;
+}
+
+void kai_record_ply_board(const struct kai_record_ply_t* ply, struct kai_board_state_t* board_state)
+{
+	memcpy(board_state->seeds, ply->seeds, sizeof(board_state->seeds));
+	board_state->player = ply->player;
+}
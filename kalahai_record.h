@@ -0,0 +1,194 @@
+#ifndef KALAHAI_RECORD_H
+#define KALAHAI_RECORD_H
+
+#include "kalahai.h"
+#include <stdint.h>
+
+
+/**
+	DEFINES
+*/
+
+/*
+	Game record files.
+
+	A record file starts with a kai_record_file_header_t, followed by any number of games. A game is a
+	kai_record_game_t followed by ply_count kai_record_ply_t. Both structures are KAI_RECORD_SIZE bytes, so the
+	file is an array of fixed size records after the header. The structures are written as they are in memory, so
+	integers are in the byte order of the machine that wrote the file, and only machines with the same byte order
+	can read it.
+
+	Games are only written once they have ended, with a single append, so several processes can append to the
+	same file and a crash can at most leave one truncated game at the end (which readers ignore).
+*/
+
+// The magic bytes at the start of a record file.
+#define KAI_RECORD_MAGIC "KAIREC"
+
+// The version of the format.
+#define KAI_RECORD_VERSION 1
+
+// The size of every record in the file.
+#define KAI_RECORD_SIZE 24
+
+// Record types.
+#define KAI_RECORD_TYPE_GAME 1
+#define KAI_RECORD_TYPE_PLY 2
+
+// The number of plies the writer can hold for one game. Kalah games are far shorter than this.
+#define KAI_RECORD_MAX_PLIES 1024
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	The start of a record file.
+*/
+struct kai_record_file_header_t
+{
+	char magic[6];
+	uint16_t version;
+	uint16_t record_size;
+	uint8_t reserved[6];
+};
+
+/**
+	The first record of a game.
+*/
+struct kai_record_game_t
+{
+	// KAI_RECORD_TYPE_GAME.
+	uint8_t type;
+
+	// The winner of the game. 0 for a draw.
+	int8_t winner;
+
+	// The player whose moves were searched by the engine (0 if both were).
+	int8_t player_id;
+
+	uint8_t reserved0;
+
+	// The number of kai_record_ply_t that follow.
+	uint32_t ply_count;
+
+	uint8_t reserved1[16];
+};
+
+/**
+	One ply of a game: the board before the move, the move, and the search that chose it.
+*/
+struct kai_record_ply_t
+{
+	// KAI_RECORD_TYPE_PLY.
+	uint8_t type;
+
+	// The player making the move.
+	int8_t player;
+
+	// The move (1 - 6).
+	uint8_t move;
+
+	// The depth of the deepest completed iteration of the search. 0 if the move was not searched.
+	uint8_t depth;
+
+	// The search score of the move, from the perspective of the player making it.
+	int16_t score;
+
+	// The board before the move, in the same layout as kai_board_state_t::seeds.
+	uint8_t seeds[14];
+
+	// The number of nodes searched (saturated at UINT32_MAX).
+	uint32_t nodes;
+};
+
+/**
+	Appends games to a record file.
+*/
+struct kai_record_writer_t
+{
+	FILE* file;
+
+	// The game being recorded. Written when it ends.
+	struct kai_record_game_t game;
+	struct kai_record_ply_t plies[KAI_RECORD_MAX_PLIES];
+};
+
+/**
+	Reads a record file through a memory mapping.
+*/
+struct kai_record_reader_t
+{
+	struct kai_file_mapping_t mapping;
+
+	// The records after the file header.
+	const struct kai_record_ply_t* records;
+	size_t record_count;
+
+	// The index of every complete game: the record index of its kai_record_game_t.
+	size_t* games;
+	size_t game_count;
+
+	// The total number of plies in all complete games.
+	size_t ply_count;
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Open a record file for appending, creating it (with its header) if needed.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_record_writer_open(struct kai_record_writer_t* writer, const char* path);
+
+/**
+	Close the record file. A game that has not ended is discarded.
+*/
+void kai_record_writer_close(struct kai_record_writer_t* writer);
+
+/**
+	Start recording a new game, discarding any game that has not ended.
+	player_id is the player searched by the engine (0 if both are).
+*/
+void kai_record_writer_begin_game(struct kai_record_writer_t* writer, kai_player_id_t player_id);
+
+/**
+	Record one ply of the current game. search may be NULL if the move was not searched.
+*/
+void kai_record_writer_add_ply(struct kai_record_writer_t* writer, const struct kai_board_state_t* board_state, int move, const struct kai_search_info_t* search);
+
+/**
+	End the current game and append it to the file.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_record_writer_end_game(struct kai_record_writer_t* writer, kai_player_id_t winner);
+
+/**
+	Map a record file and index its games.
+
+	Returns 0 on success, 1 if the file cannot be read or is not a record file.
+*/
+int kai_record_reader_open(struct kai_record_reader_t* reader, const char* path);
+
+/**
+	Unmap the record file.
+*/
+void kai_record_reader_close(struct kai_record_reader_t* reader);
+
+/**
+	Return the game with the given index (0 to game_count - 1). plies receives a pointer to its plies.
+*/
+const struct kai_record_game_t* kai_record_reader_game(const struct kai_record_reader_t* reader, size_t index, const struct kai_record_ply_t** plies);
+
+/**
+	Copy the board of a recorded ply into a board state.
+*/
+void kai_record_ply_board(const struct kai_record_ply_t* ply, struct kai_board_state_t* board_state);
+
+#endif
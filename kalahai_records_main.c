@@ -0,0 +1,63 @@
+#include "kalahai_record.h"
+
+/**
+	Program entry point.
+
+	Usage: kalahai_records <file> [game]
+	Without a game index, prints a summary of the record file. With one, prints every ply of that game.
+*/
+int main(int argc, char* argv[])
+{
+	size_t i;
+	size_t index;
+	size_t wins[3] = { 0, 0, 0 };
+	const struct kai_record_game_t* game;
+	const struct kai_record_ply_t* plies;
+	struct kai_record_reader_t reader;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s <file> [game]\n", argv[0]);
+		return 1;
+	}
+
+	if (kai_record_reader_open(&reader, argv[1]) != 0)
+		return 1;
+
+	if (argc < 3)
+	{
+		for (i = 0; i < reader.game_count; ++i)
+		{
+			game = kai_record_reader_game(&reader, i, NULL);
+			if (game->winner >= 0 && game->winner <= 2)
+				wins[game->winner]++;
+		}
+
+		fprintf(stdout, "Games: %lu. Plies: %lu. Player 1 wins: %lu. Player 2 wins: %lu. Draws: %lu.\n",
+			(unsigned long) reader.game_count, (unsigned long) reader.ply_count, (unsigned long) wins[1], (unsigned long) wins[2], (unsigned long) wins[0]);
+	}
+	else
+	{
+		index = (size_t) strtoul(argv[2], NULL, 10);
+		if (index >= reader.game_count)
+		{
+			fprintf(stderr, "There are only %lu games.\n", (unsigned long) reader.game_count);
+			kai_record_reader_close(&reader);
+			return 1;
+		}
+
+		game = kai_record_reader_game(&reader, index, &plies);
+		fprintf(stdout, "Game %lu. Engine player: %d. Winner: %d. Plies: %lu.\n", (unsigned long) index, (int) game->player_id, (int) game->winner, (unsigned long) game->ply_count);
+		for (i = 0; i < game->ply_count; ++i)
+		{
+			fprintf(stdout, "%d;%d;%d;%d;%d;%d;%d;%d;%d;%d;%d;%d;%d;%d;%d move %d score %d depth %d nodes %lu\n",
+				plies[i].seeds[13], plies[i].seeds[0], plies[i].seeds[1], plies[i].seeds[2], plies[i].seeds[3], plies[i].seeds[4], plies[i].seeds[5],
+				plies[i].seeds[6], plies[i].seeds[7], plies[i].seeds[8], plies[i].seeds[9], plies[i].seeds[10], plies[i].seeds[11], plies[i].seeds[12],
+				(int) plies[i].player, (int) plies[i].move, (int) plies[i].score, (int) plies[i].depth, (unsigned long) plies[i].nodes);
+		}
+	}
+
+	kai_record_reader_close(&reader);
+
+	return 0;
+}
@@ -0,0 +1,164 @@
+#include "kalahai_tree.h"
+
+/**
+	Print one event of a tree file.
+*/
+static void kai_replay_print_event(const char* name, const struct kai_tree_reader_t* reader, size_t index)
+{
+	const struct kai_tree_event_t* event;
+	static const char* types[] = { "?", "search", "iteration", "node", "cutoff", "table cutoff", "end" };
+
+	if (index >= reader->event_count)
+	{
+		fprintf(stdout, "%s: the end of the file.\n", name);
+		return;
+	}
+
+	event = &reader->events[index];
+	fprintf(stdout, "%s: %s, ply %d, move %d, depth %d, value %d.\n", name, types[event->type <= KAI_TREE_EVENT_END ? event->type : 0],
+		(int) event->ply, (int) event->move, (int) event->depth, (int) event->value);
+}
+
+/**
+	Print the totals of every iteration of a tree file.
+*/
+static void kai_replay_summary(const struct kai_tree_reader_t* reader)
+{
+	size_t index = 0;
+	long search = -1;
+	long long nodes = 0;
+	struct kai_tree_iteration_t iteration;
+
+	while (kai_tree_reader_iteration(reader, index, &search, &iteration))
+	{
+		fprintf(stdout, "Search %ld depth %d: %lld nodes, %lld cutoffs, %lld table cutoffs. %s move %d, score %d.\n",
+			iteration.search, iteration.depth, iteration.nodes, iteration.cutoffs, iteration.table_cutoffs,
+			iteration.completed ? "Completed," : "Aborted,", iteration.move, iteration.score);
+		nodes += iteration.nodes;
+		index = iteration.last;
+	}
+
+	fprintf(stdout, "Searches: %ld. Nodes: %lld. Events: %lu.\n", search + 1, nodes, (unsigned long) reader->event_count);
+}
+
+/**
+	Compare two tree files: the nodes both spent on every iteration, and the first event where they differ.
+*/
+static void kai_replay_diff(const struct kai_tree_reader_t* first, const struct kai_tree_reader_t* second)
+{
+	int i;
+	int path_length;
+	int moves[KAI_MINIMAX_MAX_PLY];
+	int found[2];
+	size_t index[2] = { 0, 0 };
+	size_t diverge;
+	size_t event;
+	long diverged_search = -1;
+	long search[2] = { -1, -1 };
+	long long nodes[2] = { 0, 0 };
+	struct kai_tree_iteration_t iteration[2];
+	struct kai_tree_iteration_t diverged;
+
+	// The iterations are paired up in order, which is the same search and depth until the trees diverge.
+	while (1)
+	{
+		found[0] = kai_tree_reader_iteration(first, index[0], &search[0], &iteration[0]);
+		found[1] = kai_tree_reader_iteration(second, index[1], &search[1], &iteration[1]);
+		if (!found[0] && !found[1])
+			break;
+
+		for (i = 0; i < 2; ++i)
+		{
+			if (!found[i])
+				memset(&iteration[i], 0, sizeof(iteration[i]));
+			else
+				index[i] = iteration[i].last;
+			nodes[i] += iteration[i].nodes;
+		}
+
+		fprintf(stdout, "Search %ld depth %d: %lld / %lld nodes (%+.1f%%).%s\n",
+			found[0] ? iteration[0].search : iteration[1].search, found[0] ? iteration[0].depth : iteration[1].depth,
+			iteration[0].nodes, iteration[1].nodes,
+			iteration[0].nodes > 0 ? 100.0 * (iteration[1].nodes - iteration[0].nodes) / iteration[0].nodes : 0.0,
+			found[0] && found[1] && (iteration[0].search != iteration[1].search || iteration[0].depth != iteration[1].depth) ? " Different iterations." : "");
+	}
+
+	fprintf(stdout, "Nodes: %lld / %lld (%+.1f%%).\n", nodes[0], nodes[1], nodes[0] > 0 ? 100.0 * (nodes[1] - nodes[0]) / nodes[0] : 0.0);
+
+	diverge = kai_tree_diverge(first, second);
+	if (diverge == first->event_count && diverge == second->event_count)
+	{
+		fprintf(stdout, "The trees are the same.\n");
+		return;
+	}
+
+	// Find the search and iteration of the first difference, and the moves leading to it.
+	for (event = 0; event <= diverge && event < first->event_count; ++event)
+	{
+		if (first->events[event].type == KAI_TREE_EVENT_SEARCH)
+			++diverged_search;
+	}
+
+	index[0] = 0;
+	search[0] = -1;
+	memset(&diverged, 0, sizeof(diverged));
+	while (kai_tree_reader_iteration(first, index[0], &search[0], &iteration[0]) && iteration[0].first <= diverge)
+	{
+		diverged = iteration[0];
+		index[0] = iteration[0].last;
+	}
+
+	if (diverged.last > diverge && diverged.search == diverged_search)
+		fprintf(stdout, "The trees diverge at event %lu, in search %ld at depth %d.\n", (unsigned long) diverge, diverged_search, diverged.depth);
+	else
+		fprintf(stdout, "The trees diverge at event %lu, at the start of search %ld.\n", (unsigned long) diverge, diverged_search);
+	path_length = kai_tree_reader_path(diverge < first->event_count ? first : second, diverge, moves);
+	fprintf(stdout, "Moves from the root:");
+	for (i = 0; i < path_length; ++i)
+		fprintf(stdout, " %d", moves[i]);
+	fprintf(stdout, "%s\n", path_length == 0 ? " none." : ".");
+
+	kai_replay_print_event("First", first, diverge);
+	kai_replay_print_event("Second", second, diverge);
+}
+
+/**
+	Program entry point.
+
+	Usage: kalahai_replay <file> [other file]
+	Replays a tree file (as written by 'kalahai --tree' or kai_engine_record_tree()) and prints the totals of every
+	iteration. With two files, compares the nodes they spent on every iteration and finds the first event where they
+	differ, for comparing two builds of the engine on the same node-limited searches.
+*/
+int main(int argc, char* argv[])
+{
+	struct kai_tree_reader_t first;
+	struct kai_tree_reader_t second;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s <file> [other file]\n", argv[0]);
+		return 1;
+	}
+
+	if (kai_tree_reader_open(&first, argv[1]) != 0)
+		return 1;
+
+	if (argc < 3)
+		kai_replay_summary(&first);
+	else
+	{
+		if (kai_tree_reader_open(&second, argv[2]) != 0)
+		{
+			kai_tree_reader_close(&first);
+			return 1;
+		}
+
+		kai_replay_diff(&first, &second);
+		kai_tree_reader_close(&second);
+	}
+
+	kai_tree_reader_close(&first);
+
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include "kalahai_sched.h"
+#include "kalahai_log.h"
+
+
+void kai_sched_init(struct kai_sched_t* sched, int pin, int avoid_smt)
+{
+	int i;
+	int j;
+	int sibling;
+	const struct kai_cpu_topology_t* topology = &sched->topology;
+
+	kai_cpu_topology_read(&sched->topology);
+
+	sched->thread_count = topology->thread_count;
+	if (avoid_smt && sched->thread_count > topology->core_count)
+		sched->thread_count = topology->core_count;
+
+	sched->cpu_count = 0;
+	if (!pin)
+		return;
+
+	// The first processor of every physical core, then the rest.
+	for (sibling = 0; sibling <= (avoid_smt ? 0 : 1); ++sibling)
+	{
+		for (i = 0; i < topology->cpu_count && sched->cpu_count < sched->thread_count; ++i)
+		{
+			for (j = 0; j < i && topology->cores[j] != topology->cores[i]; ++j);
+			if ((j < i) == sibling)
+				sched->cpus[sched->cpu_count++] = topology->cpus[i];
+		}
+	}
+}
+
+int kai_sched_cpu(const struct kai_sched_t* sched, int slot)
+{
+	if (sched->cpu_count == 0 || slot < 0)
+		return -1;
+
+	return sched->cpus[slot % sched->cpu_count];
+}
+
+void kai_sched_log(const struct kai_sched_t* sched, struct kai_log_ring_t* ring)
+{
+	int i;
+	int j;
+	const struct kai_cpu_topology_t* topology = &sched->topology;
+
+	KAI_LOG_VALUES(ring, KAI_LOG_INFO, "%lld processors on %lld physical cores, running %lld threads at once.\n",
+		topology->cpu_count, topology->core_count, sched->thread_count);
+	if (topology->quota > 0.0)
+		KAI_LOG_VALUES(ring, KAI_LOG_INFO, "CPU quota of %lld.%02lld processors.\n", (long long) (topology->quota * 100.0 + 0.5) / 100,
+			(long long) (topology->quota * 100.0 + 0.5) % 100, 0);
+
+	for (i = 0; i < sched->cpu_count; ++i)
+	{
+		for (j = 0; j < topology->cpu_count && topology->cpus[j] != sched->cpus[i]; ++j);
+		KAI_LOG_VALUES(ring, KAI_LOG_INFO, "Thread slot %lld runs on processor %lld (physical core %lld).\n",
+			i, sched->cpus[i], j < topology->cpu_count ? topology->cores[j] : sched->cpus[i]);
+	}
+}
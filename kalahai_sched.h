@@ -0,0 +1,65 @@
+#ifndef KALAHAI_SCHED_H
+#define KALAHAI_SCHED_H
+
+#include "kalahai.h"
+#include "kalahai_platform.h"
+
+
+/**
+	DEFINES
+*/
+
+/*
+	Thread placement.
+
+	kai_sched_init() reads the processors the process may run on (see kai_cpu_topology_t) and sizes the threads to
+	run at once to the affinity mask and the CPU quota of the process, so that a container with a quota below the
+	core count of the host is not oversubscribed. Threads that are pinned get a slot each (0, 1, ...), and every slot
+	has a processor of its own: one on every physical core first, then their SMT siblings, unless siblings are
+	avoided. Slots beyond the processors wrap around.
+*/
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	Where the threads of the process run.
+*/
+struct kai_sched_t
+{
+	// The processors the process may run on.
+	struct kai_cpu_topology_t topology;
+
+	// The number of threads to run at once: topology.thread_count, limited to the physical cores if SMT siblings are
+	// avoided.
+	int thread_count;
+
+	// The processor of every slot. cpu_count is 0 if threads are not pinned.
+	int cpus[KAI_MAX_CPUS];
+	int cpu_count;
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Read the processors of the process and size the threads to them. If pin is 1, every slot up to thread_count is
+	given a processor. If avoid_smt is 1, at most one processor of every physical core is used.
+*/
+void kai_sched_init(struct kai_sched_t* sched, int pin, int avoid_smt);
+
+/**
+	Return the processor of a slot, or -1 if threads are not pinned.
+*/
+int kai_sched_cpu(const struct kai_sched_t* sched, int slot);
+
+/**
+	Log the processors, the quota and the processor of every slot at KAI_LOG_INFO.
+*/
+void kai_sched_log(const struct kai_sched_t* sched, struct kai_log_ring_t* ring);
+
+#endif
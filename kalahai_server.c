@@ -0,0 +1,160 @@
+#include "kalahai_server.h"
+
+
+/**
+	Parse the space separated integers after a command into values.
+
+	Returns the number of integers, or -1 if anything else follows the command.
+*/
+static int kai_server_parse_ints(const char* arguments, int* values, int max_count)
+{
+	int count = 0;
+	long value;
+	char* end;
+
+	while (*arguments != '\0')
+	{
+		if (*arguments != ' ')
+			return -1;
+		while (*arguments == ' ')
+			++arguments;
+		if (*arguments == '\0')
+			break;
+
+		value = strtol(arguments, &end, 10);
+		if (end == arguments || count == max_count)
+			return -1;
+
+		values[count++] = (int) value;
+		arguments = end;
+	}
+
+	return count;
+}
+
+/**
+	Decide the winner once the game is over, or a house holds more than half the seeds.
+*/
+static void kai_server_update_winner(struct kai_server_game_t* game)
+{
+	const kai_ambo_t* seeds = game->board_state.seeds;
+
+	if (!kai_is_game_over(&game->board_state) && seeds[KAI_SOUTH_HOUSE] < KAI_SEED_WIN_THRESHOLD && seeds[KAI_NORTH_HOUSE] < KAI_SEED_WIN_THRESHOLD)
+		return;
+
+	if (seeds[KAI_SOUTH_HOUSE] > seeds[KAI_NORTH_HOUSE])
+		game->winner = 1;
+	else if (seeds[KAI_NORTH_HOUSE] > seeds[KAI_SOUTH_HOUSE])
+		game->winner = 2;
+	else
+		game->winner = KAI_PLAYER_NONE;
+}
+
+void kai_server_game_init(struct kai_server_game_t* game)
+{
+	kai_server_game_restart(game);
+	game->player_count = 0;
+	game->connected_count = 0;
+}
+
+void kai_server_game_restart(struct kai_server_game_t* game)
+{
+	kai_parse_board_state(&game->board_state, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+	game->winner = KAI_SERVER_NO_WINNER;
+}
+
+int kai_server_execute(struct kai_server_game_t* game, kai_player_id_t player_id, const char* command, char* reply)
+{
+	int arguments[2];
+	int argument_count;
+	size_t length;
+	kai_ambo_index_t ambo;
+
+	// The length of the command word.
+	for (length = 0; command[length] != '\0' && command[length] != ' '; ++length);
+
+	if (length == strlen(KAI_COMMAND_HELLO) && strncmp(command, KAI_COMMAND_HELLO, length) == 0)
+	{
+		sprintf(reply, "%s %d\n", KAI_COMMAND_HELLO, (int) player_id);
+		return KAI_SERVER_COMMAND_HELLO;
+	}
+
+	if (length == strlen(KAI_COMMAND_BOARD) && strncmp(command, KAI_COMMAND_BOARD, length) == 0)
+	{
+		kai_format_board_state(&game->board_state, reply);
+		strcat(reply, "\n");
+		return KAI_SERVER_COMMAND_BOARD;
+	}
+
+	if (length == strlen(KAI_COMMAND_MOVE) && strncmp(command, KAI_COMMAND_MOVE, length) == 0)
+	{
+		argument_count = kai_server_parse_ints(command + length, arguments, 2);
+		if (game->player_count < 2)
+			sprintf(reply, "%s\n", KAI_ERROR_GAME_NOT_FULL);
+		else if (argument_count != 2)
+			sprintf(reply, "%s\n", KAI_ERROR_INVALID_PARAMS);
+		else if (arguments[0] < 1 || arguments[0] > KAI_AMBO_COUNT)
+			sprintf(reply, "%s\n", KAI_ERROR_INVALID_MOVE);
+		else if (arguments[1] != player_id || game->board_state.player != player_id || game->winner != KAI_SERVER_NO_WINNER)
+			sprintf(reply, "%s\n", KAI_ERROR_WRONG_PLAYER);
+		else
+		{
+			ambo = (kai_ambo_index_t) ((player_id == 1 ? KAI_SOUTH_START : KAI_NORTH_START) + arguments[0] - 1);
+			if (game->board_state.seeds[ambo] == 0)
+				sprintf(reply, "%s\n", KAI_ERROR_AMBO_EMPTY);
+			else
+			{
+				kai_play_move(&game->board_state, ambo);
+				kai_server_update_winner(game);
+				kai_format_board_state(&game->board_state, reply);
+				strcat(reply, "\n");
+			}
+		}
+
+		return KAI_SERVER_COMMAND_MOVE;
+	}
+
+	if (length == strlen(KAI_COMMAND_NEXT_PLAYER) && strncmp(command, KAI_COMMAND_NEXT_PLAYER, length) == 0)
+	{
+		if (game->player_count < 2)
+			sprintf(reply, "%s\n", KAI_ERROR_GAME_NOT_FULL);
+		else
+			sprintf(reply, "%d\n", (int) game->board_state.player);
+		return KAI_SERVER_COMMAND_NEXT_PLAYER;
+	}
+
+	if (length == strlen(KAI_COMMAND_NEW_GAME) && strncmp(command, KAI_COMMAND_NEW_GAME, length) == 0)
+	{
+		if (game->player_count < 2)
+			sprintf(reply, "%s\n", KAI_ERROR_GAME_NOT_FULL);
+		else
+		{
+			kai_server_game_restart(game);
+			kai_format_board_state(&game->board_state, reply);
+			strcat(reply, "\n");
+		}
+		return KAI_SERVER_COMMAND_NEW_GAME;
+	}
+
+	if (length == strlen(KAI_COMMAND_WINNER) && strncmp(command, KAI_COMMAND_WINNER, length) == 0)
+	{
+		if (game->player_count < 2)
+			sprintf(reply, "%s\n", KAI_ERROR_GAME_NOT_FULL);
+		else
+			sprintf(reply, "%d\n", game->winner);
+		return KAI_SERVER_COMMAND_WINNER;
+	}
+
+	sprintf(reply, "%s\n", KAI_ERROR_CMD_NOT_FOUND);
+	return KAI_SERVER_COMMAND_UNKNOWN;
+}
+
+const char* kai_server_command_name(int command)
+{
+	static const char* names[KAI_SERVER_COMMAND_COUNT] =
+	{
+		KAI_COMMAND_HELLO, KAI_COMMAND_MOVE, KAI_COMMAND_BOARD, KAI_COMMAND_NEXT_PLAYER, KAI_COMMAND_NEW_GAME, KAI_COMMAND_WINNER, "(unknown)"
+	};
+
+	return names[command];
+}
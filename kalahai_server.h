@@ -0,0 +1,72 @@
+#ifndef KALAHAI_SERVER_H
+#define KALAHAI_SERVER_H
+
+#include "kalahai.h"
+
+
+/**
+	DEFINES
+*/
+
+// The commands of the protocol, as indices into the latency histograms. KAI_SERVER_COMMAND_UNKNOWN is anything else.
+#define KAI_SERVER_COMMAND_HELLO 0
+#define KAI_SERVER_COMMAND_MOVE 1
+#define KAI_SERVER_COMMAND_BOARD 2
+#define KAI_SERVER_COMMAND_NEXT_PLAYER 3
+#define KAI_SERVER_COMMAND_NEW_GAME 4
+#define KAI_SERVER_COMMAND_WINNER 5
+#define KAI_SERVER_COMMAND_UNKNOWN 6
+#define KAI_SERVER_COMMAND_COUNT 7
+
+// The winner of a game that has not ended.
+#define KAI_SERVER_NO_WINNER -1
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	One game hosted by the server.
+*/
+struct kai_server_game_t
+{
+	struct kai_board_state_t board_state;
+
+	// The winner, 0 for a draw, or KAI_SERVER_NO_WINNER while the game goes on.
+	int winner;
+
+	// The number of players that have joined (the game is full at two), and how many of them are still connected.
+	int player_count;
+	int connected_count;
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Set up a game at the start position, with no players.
+*/
+void kai_server_game_init(struct kai_server_game_t* game);
+
+/**
+	Restart a game at the start position, keeping its players.
+*/
+void kai_server_game_restart(struct kai_server_game_t* game);
+
+/**
+	Run one command (without the newline) from the given player of a game, as described in kalahai.h.
+	reply receives the full reply, including the newline. It must be at least KAI_COMMAND_MAX_SIZE bytes.
+
+	Returns the KAI_SERVER_COMMAND_* index of the command.
+*/
+int kai_server_execute(struct kai_server_game_t* game, kai_player_id_t player_id, const char* command, char* reply);
+
+/**
+	Return the name of a KAI_SERVER_COMMAND_* index.
+*/
+const char* kai_server_command_name(int command);
+
+#endif
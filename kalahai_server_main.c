@@ -0,0 +1,494 @@
+#define _GNU_SOURCE
+
+#include "kalahai_server.h"
+#include "kalahai_trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+// The number of events taken from epoll at a time.
+#define KAI_SERVER_EVENT_COUNT 256
+
+// Replies waiting for a slow client. A client that lets more than this pile up is disconnected.
+#define KAI_SERVER_SEND_BUFFER_SIZE 4096
+
+/**
+	One connected client.
+*/
+struct kai_server_connection_t
+{
+	int socket;
+
+	// The game the client plays in, and its player ID in that game.
+	struct kai_server_game_t* game;
+	kai_player_id_t player_id;
+
+	// Received data that does not make up a full command yet.
+	char receive_buffer[KAI_RECEIVE_BUFFER_SIZE];
+	size_t receive_size;
+
+	// Replies that could not be sent at once, and whether epoll is watching for the socket to drain.
+	char send_buffer[KAI_SERVER_SEND_BUFFER_SIZE];
+	size_t send_size;
+	int waiting;
+};
+
+/**
+	The state of the server.
+*/
+struct kai_server_t
+{
+	int epoll;
+	int listener;
+
+	// Every game slot, the unused slots, and the game waiting for its second player (or NULL).
+	struct kai_server_game_t* games;
+	int* free_games;
+	int free_game_count;
+	struct kai_server_game_t* open_game;
+
+	int connection_count;
+
+	// Measures the time since the server started. Command latencies are measured with it, into a histogram per
+	// command.
+	struct kai_timer_t timer;
+	struct kai_trace_histogram_t latency[KAI_SERVER_COMMAND_COUNT];
+};
+
+// Set by the signal handler to make the server exit.
+static volatile sig_atomic_t kai_server_quit = 0;
+
+
+/**
+	Ask the event loop to exit.
+*/
+void kai_server_signal(int signal_number);
+
+/**
+	Open the listening socket on the given port and add it to epoll.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_server_listen(struct kai_server_t* server, const char* port);
+
+/**
+	Accept every pending connection and seat it in a game.
+*/
+void kai_server_accept(struct kai_server_t* server);
+
+/**
+	Read from a connection and run every complete command.
+
+	Returns 0 if the connection should stay open, 1 if it should be closed.
+*/
+int kai_server_receive(struct kai_server_t* server, struct kai_server_connection_t* connection);
+
+/**
+	Send as much of the pending replies of a connection as the socket takes.
+
+	Returns 0 if the connection should stay open, 1 if it should be closed.
+*/
+int kai_server_flush(struct kai_server_t* server, struct kai_server_connection_t* connection);
+
+/**
+	Close a connection and leave its game.
+*/
+void kai_server_close(struct kai_server_t* server, struct kai_server_connection_t* connection);
+
+/**
+	Print the latency of every command to stdout.
+*/
+void kai_server_print_latency(const struct kai_server_t* server);
+
+
+/**
+	Program entry point.
+
+	Usage: kalahai_server [--port <port>] [--games <n>] [--stats <seconds>]
+	Hosts games of the protocol in kalahai.h. Every two connecting clients are seated in a new game, as player 1 and 2.
+	--games limits the number of concurrent games; clients beyond that get KAI_ERROR_GAME_FULL.
+	--stats prints the command latencies every given number of seconds. They are always printed on exit (SIGINT or SIGTERM).
+*/
+int main(int argc, char* argv[])
+{
+	int i;
+	int event_count;
+	int close_connection;
+	int max_games = 4096;
+	double stats_interval = 0.0;
+	double next_stats;
+	const char* port = KAI_DEFAULT_PORT;
+	struct rlimit limit;
+	struct epoll_event events[KAI_SERVER_EVENT_COUNT];
+	struct kai_server_connection_t* connection;
+	struct kai_server_t server;
+
+	for (i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+			port = argv[++i];
+		else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+			max_games = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc)
+			stats_interval = atof(argv[++i]);
+		else
+		{
+			fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (max_games < 1)
+	{
+		fprintf(stderr, "There must be room for at least one game.\n");
+		return 1;
+	}
+
+	// Every game takes two sockets, so allow as many descriptors as we are permitted.
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+	{
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, kai_server_signal);
+	signal(SIGTERM, kai_server_signal);
+
+	memset(&server, 0, sizeof(server));
+	server.games = (struct kai_server_game_t*) malloc(max_games * sizeof(struct kai_server_game_t));
+	server.free_games = (int*) malloc(max_games * sizeof(int));
+	if (server.games == NULL || server.free_games == NULL)
+	{
+		fprintf(stderr, "Failed to allocate %d games.\n", max_games);
+		return 1;
+	}
+
+	for (i = 0; i < max_games; ++i)
+		server.free_games[i] = max_games - 1 - i;
+	server.free_game_count = max_games;
+
+	if (kai_server_listen(&server, port) != 0)
+		return 1;
+
+	fprintf(stdout, "Listening on port %s for up to %d games.\n", port, max_games);
+	kai_timer_start(&server.timer);
+	next_stats = stats_interval;
+
+	while (!kai_server_quit)
+	{
+		event_count = epoll_wait(server.epoll, events, KAI_SERVER_EVENT_COUNT, stats_interval > 0.0 ? 100 : 1000);
+		if (event_count < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			fprintf(stderr, "epoll_wait failed: %d\n", errno);
+			break;
+		}
+
+		for (i = 0; i < event_count; ++i)
+		{
+			if (events[i].data.ptr == NULL)
+			{
+				kai_server_accept(&server);
+				continue;
+			}
+
+			connection = (struct kai_server_connection_t*) events[i].data.ptr;
+			close_connection = (events[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+			if (!close_connection && (events[i].events & EPOLLIN))
+				close_connection = kai_server_receive(&server, connection);
+			if (!close_connection && (events[i].events & EPOLLOUT))
+				close_connection = kai_server_flush(&server, connection);
+
+			if (close_connection)
+				kai_server_close(&server, connection);
+		}
+
+		if (stats_interval > 0.0 && kai_timer_get_time(&server.timer) >= next_stats)
+		{
+			fprintf(stdout, "%d connections, %d games.\n", server.connection_count, max_games - server.free_game_count);
+			kai_server_print_latency(&server);
+			next_stats += stats_interval;
+		}
+	}
+
+	kai_server_print_latency(&server);
+
+	close(server.listener);
+	close(server.epoll);
+	free(server.games);
+	free(server.free_games);
+
+	return 0;
+}
+
+void kai_server_signal(int signal_number)
+{
+	(void) signal_number;
+	kai_server_quit = 1;
+}
+
+int kai_server_listen(struct kai_server_t* server, const char* port)
+{
+	int result;
+	int reuse = 1;
+	struct addrinfo hints;
+	struct addrinfo* address_info;
+	struct epoll_event event;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	hints.ai_flags = AI_PASSIVE;
+
+	result = getaddrinfo(NULL, port, &hints, &address_info);
+	if (result != 0)
+	{
+		fprintf(stderr, "getaddrinfo failed: %d\n", result);
+		return 1;
+	}
+
+	server->listener = socket(address_info->ai_family, address_info->ai_socktype | SOCK_NONBLOCK, address_info->ai_protocol);
+	if (server->listener < 0)
+	{
+		fprintf(stderr, "Failed to create the listening socket: %d\n", errno);
+		freeaddrinfo(address_info);
+		return 1;
+	}
+
+	setsockopt(server->listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	result = bind(server->listener, address_info->ai_addr, address_info->ai_addrlen);
+	freeaddrinfo(address_info);
+	if (result != 0 || listen(server->listener, SOMAXCONN) != 0)
+	{
+		fprintf(stderr, "Failed to listen on port %s: %d\n", port, errno);
+		close(server->listener);
+		return 1;
+	}
+
+	server->epoll = epoll_create1(0);
+	if (server->epoll < 0)
+	{
+		fprintf(stderr, "epoll_create1 failed: %d\n", errno);
+		close(server->listener);
+		return 1;
+	}
+
+	// The listener is the only event source without a connection.
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	if (epoll_ctl(server->epoll, EPOLL_CTL_ADD, server->listener, &event) != 0)
+	{
+		fprintf(stderr, "Failed to add the listening socket to epoll: %d\n", errno);
+		close(server->epoll);
+		close(server->listener);
+		return 1;
+	}
+
+	return 0;
+}
+
+void kai_server_accept(struct kai_server_t* server)
+{
+	int socket;
+	int no_delay = 1;
+	struct epoll_event event;
+	struct kai_server_connection_t* connection;
+	char reply[KAI_COMMAND_MAX_SIZE];
+
+	while (1)
+	{
+		socket = accept4(server->listener, NULL, NULL, SOCK_NONBLOCK);
+		if (socket < 0)
+			return;
+
+		// Every game is full and there are no free slots for a new one.
+		if (server->open_game == NULL && server->free_game_count == 0)
+		{
+			sprintf(reply, "%s\n", KAI_ERROR_GAME_FULL);
+			send(socket, reply, strlen(reply), MSG_NOSIGNAL);
+			close(socket);
+			continue;
+		}
+
+		connection = (struct kai_server_connection_t*) malloc(sizeof(*connection));
+		if (connection == NULL)
+		{
+			close(socket);
+			continue;
+		}
+
+		// Replies are small and latency matters, so do not wait to fill packets.
+		setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+		connection->socket = socket;
+		connection->receive_size = 0;
+		connection->send_size = 0;
+		connection->waiting = 0;
+
+		event.events = EPOLLIN;
+		event.data.ptr = connection;
+		if (epoll_ctl(server->epoll, EPOLL_CTL_ADD, socket, &event) != 0)
+		{
+			close(socket);
+			free(connection);
+			continue;
+		}
+
+		// Fill the open game, or open a new one.
+		if (server->open_game == NULL)
+		{
+			server->open_game = &server->games[server->free_games[--server->free_game_count]];
+			kai_server_game_init(server->open_game);
+		}
+
+		connection->game = server->open_game;
+		connection->player_id = (kai_player_id_t) ++connection->game->player_count;
+		connection->game->connected_count++;
+		if (connection->game->player_count == 2)
+			server->open_game = NULL;
+
+		server->connection_count++;
+	}
+}
+
+int kai_server_receive(struct kai_server_t* server, struct kai_server_connection_t* connection)
+{
+	ssize_t result;
+	size_t start;
+	size_t end;
+	size_t reply_size;
+	int command;
+	double time;
+	char reply[KAI_COMMAND_MAX_SIZE];
+
+	while (1)
+	{
+		result = recv(connection->socket, connection->receive_buffer + connection->receive_size, KAI_RECEIVE_BUFFER_SIZE - connection->receive_size, 0);
+		if (result == 0)
+			return 1;
+		if (result < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : 1;
+
+		connection->receive_size += (size_t) result;
+
+		// Run every complete command in the buffer.
+		start = 0;
+		for (end = 0; end < connection->receive_size; ++end)
+		{
+			if (connection->receive_buffer[end] != '\n')
+				continue;
+
+			time = kai_timer_get_time(&server->timer);
+			connection->receive_buffer[end] = '\0';
+			if (end > start && connection->receive_buffer[end - 1] == '\r')
+				connection->receive_buffer[end - 1] = '\0';
+
+			command = kai_server_execute(connection->game, connection->player_id, connection->receive_buffer + start, reply);
+			start = end + 1;
+
+			reply_size = strlen(reply);
+			if (connection->send_size + reply_size > KAI_SERVER_SEND_BUFFER_SIZE)
+				return 1;
+
+			memcpy(connection->send_buffer + connection->send_size, reply, reply_size);
+			connection->send_size += reply_size;
+			if (kai_server_flush(server, connection) != 0)
+				return 1;
+
+			kai_trace_histogram_add(&server->latency[command], (uint64_t) ((kai_timer_get_time(&server->timer) - time) * 1000000000.0));
+		}
+
+		// A command that fills the whole buffer can never be completed.
+		if (start == 0 && connection->receive_size == KAI_RECEIVE_BUFFER_SIZE)
+			return 1;
+
+		memmove(connection->receive_buffer, connection->receive_buffer + start, connection->receive_size - start);
+		connection->receive_size -= start;
+	}
+}
+
+int kai_server_flush(struct kai_server_t* server, struct kai_server_connection_t* connection)
+{
+	ssize_t result;
+	struct epoll_event event;
+
+	while (connection->send_size > 0)
+	{
+		result = send(connection->socket, connection->send_buffer, connection->send_size, MSG_NOSIGNAL);
+		if (result < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				return 1;
+
+			// Wait for the socket to drain before sending the rest.
+			if (!connection->waiting)
+			{
+				event.events = EPOLLIN | EPOLLOUT;
+				event.data.ptr = connection;
+				epoll_ctl(server->epoll, EPOLL_CTL_MOD, connection->socket, &event);
+				connection->waiting = 1;
+			}
+			return 0;
+		}
+
+		memmove(connection->send_buffer, connection->send_buffer + result, connection->send_size - (size_t) result);
+		connection->send_size -= (size_t) result;
+	}
+
+	if (connection->waiting)
+	{
+		event.events = EPOLLIN;
+		event.data.ptr = connection;
+		epoll_ctl(server->epoll, EPOLL_CTL_MOD, connection->socket, &event);
+		connection->waiting = 0;
+	}
+
+	return 0;
+}
+
+void kai_server_close(struct kai_server_t* server, struct kai_server_connection_t* connection)
+{
+	struct kai_server_game_t* game = connection->game;
+
+	epoll_ctl(server->epoll, EPOLL_CTL_DEL, connection->socket, NULL);
+	close(connection->socket);
+	free(connection);
+	server->connection_count--;
+
+	// Free the game once no one is left. A game waiting for its second player starts over empty instead.
+	if (--game->connected_count == 0)
+	{
+		if (game == server->open_game)
+			kai_server_game_init(game);
+		else
+			server->free_games[server->free_game_count++] = (int) (game - server->games);
+	}
+}
+
+void kai_server_print_latency(const struct kai_server_t* server)
+{
+	int i;
+	const struct kai_trace_histogram_t* latency;
+
+	fprintf(stdout, "%-10s %12s %10s %10s %10s %10s\n", "Command", "Count", "Mean (us)", "p50 (us)", "p99 (us)", "Max (us)");
+	for (i = 0; i < KAI_SERVER_COMMAND_COUNT; ++i)
+	{
+		latency = &server->latency[i];
+		if (latency->count == 0)
+			continue;
+
+		fprintf(stdout, "%-10s %12lld %10.1f %10.1f %10.1f %10.1f\n", kai_server_command_name(i), latency->count,
+			(double) latency->total / latency->count / 1000.0, kai_trace_histogram_percentile(latency, 50.0) / 1000.0,
+			kai_trace_histogram_percentile(latency, 99.0) / 1000.0, latency->maximum / 1000.0);
+	}
+
+	fflush(stdout);
+}
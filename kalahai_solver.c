@@ -0,0 +1,295 @@
+#include "kalahai_solver.h"
+#include "kalahai_table.h"
+#include "kalahai_sow.h"
+
+
+/**
+	Return 1 if attacker has won on a board, 0 if the attacker can no longer win, or -1 if the game goes on.
+*/
+static int kai_solver_terminal(const struct kai_board_state_t* board_state, kai_player_id_t attacker)
+{
+	kai_ambo_index_t house = attacker == 1 ? KAI_SOUTH_HOUSE : KAI_NORTH_HOUSE;
+	kai_ambo_index_t opponent_house = attacker == 1 ? KAI_NORTH_HOUSE : KAI_SOUTH_HOUSE;
+
+	if (board_state->seeds[house] >= KAI_SEED_WIN_THRESHOLD)
+		return 1;
+
+	// A finished game that nobody won is a draw, which is no win either.
+	if (board_state->seeds[opponent_house] >= KAI_SEED_WIN_THRESHOLD || kai_is_game_over(board_state))
+		return 0;
+
+	return -1;
+}
+
+static struct kai_solver_bucket_t* kai_solver_bucket(const struct kai_solver_t* solver, const uint64_t key[2])
+{
+	uint64_t hash = key[0] ^ (key[1] * 0x9E3779B97F4A7C15ULL);
+
+	hash ^= hash >> 31;
+	hash *= 0xBF58476D1CE4E5B9ULL;
+	hash ^= hash >> 29;
+
+	return &solver->buckets[hash % solver->bucket_count];
+}
+
+static const struct kai_solver_entry_t* kai_solver_find(const struct kai_solver_t* solver, const uint64_t key[2])
+{
+	int i;
+	struct kai_solver_bucket_t* bucket = kai_solver_bucket(solver, key);
+
+	for (i = 0; i < KAI_SOLVER_BUCKET_SIZE; ++i)
+	{
+		if (bucket->entries[i].key[0] == key[0] && bucket->entries[i].key[1] == key[1])
+			return &bucket->entries[i];
+	}
+
+	return NULL;
+}
+
+/**
+	Store the numbers of a position. The first entry of a bucket keeps solved positions and, among unsolved ones, the
+	one with the highest numbers (a rough measure of the work behind them). The second entry takes the rest.
+*/
+static void kai_solver_store(struct kai_solver_t* solver, const struct kai_solver_entry_t* value)
+{
+	int i;
+	int solved;
+	struct kai_solver_entry_t* first;
+	struct kai_solver_bucket_t* bucket = kai_solver_bucket(solver, value->key);
+
+	for (i = 0; i < KAI_SOLVER_BUCKET_SIZE; ++i)
+	{
+		if (bucket->entries[i].key[0] == value->key[0] && bucket->entries[i].key[1] == value->key[1])
+		{
+			bucket->entries[i] = *value;
+			return;
+		}
+	}
+
+	first = &bucket->entries[0];
+	solved = first->proof == 0 || first->disproof == 0;
+	if (first->key[0] == 0 && first->key[1] == 0)
+		*first = *value;
+	else if (!solved && (value->proof == 0 || value->disproof == 0 || value->proof + value->disproof >= first->proof + first->disproof))
+		*first = *value;
+	else
+		bucket->entries[1] = *value;
+}
+
+/**
+	The numbers of a position that has not been expanded: from the table if it is there, otherwise 1 and 1.
+*/
+static void kai_solver_initial(const struct kai_solver_t* solver, const struct kai_board_state_t* board_state, struct kai_solver_entry_t* value)
+{
+	int outcome = kai_solver_terminal(board_state, solver->attacker);
+	const struct kai_solver_entry_t* entry;
+
+	kai_table_key(board_state, solver->attacker, value->key);
+	value->proof = outcome == -1 ? 1 : (outcome == 1 ? 0 : KAI_SOLVER_INFINITY);
+	value->disproof = outcome == -1 ? 1 : (outcome == 1 ? KAI_SOLVER_INFINITY : 0);
+	value->distance = 0;
+	value->move = 0;
+
+	if (outcome == -1)
+	{
+		entry = kai_solver_find(solver, value->key);
+		if (entry != NULL)
+			*value = *entry;
+	}
+}
+
+/**
+	Combine the numbers of the children of a position. When the position is solved, the player to move takes the
+	fastest way to win, or the slowest way to lose.
+*/
+static void kai_solver_combine(int attacking, const struct kai_solver_entry_t* children, const int* moves, int count, struct kai_solver_entry_t* value)
+{
+	int i;
+	int chosen = -1;
+	int winning;
+	uint32_t sum = 0;
+	uint32_t minimum = KAI_SOLVER_INFINITY;
+
+	// The attacker needs one child proven, the defender one child disproven.
+	for (i = 0; i < count; ++i)
+	{
+		if ((attacking ? children[i].proof : children[i].disproof) < minimum)
+			minimum = attacking ? children[i].proof : children[i].disproof;
+
+		sum += attacking ? children[i].disproof : children[i].proof;
+		if (sum > KAI_SOLVER_INFINITY)
+			sum = KAI_SOLVER_INFINITY;
+	}
+
+	value->proof = attacking ? minimum : sum;
+	value->disproof = attacking ? sum : minimum;
+	value->distance = 0;
+	value->move = 0;
+
+	if (value->proof != 0 && value->disproof != 0)
+		return;
+
+	// The player to move wins if it is the attacker and the position is proven, or the defender and it is disproven.
+	winning = attacking == (value->proof == 0);
+	for (i = 0; i < count; ++i)
+	{
+		if (winning)
+		{
+			if ((attacking ? children[i].proof : children[i].disproof) == 0 && (chosen == -1 || children[i].distance < children[chosen].distance))
+				chosen = i;
+		}
+		else if (chosen == -1 || children[i].distance > children[chosen].distance)
+			chosen = i;
+	}
+
+	value->distance = (uint16_t) (children[chosen].distance + 1);
+	value->move = (unsigned char) moves[chosen];
+}
+
+/**
+	Expand a position until its proof number reaches proof_threshold or its disproof number reaches disproof_threshold,
+	always working on the most proving child. value receives the numbers of the position, which are also stored.
+*/
+static void kai_solver_mid(struct kai_solver_t* solver, const struct kai_board_state_t* board_state, uint32_t proof_threshold, uint32_t disproof_threshold, struct kai_solver_entry_t* value)
+{
+	int i;
+	int best;
+	int count = 0;
+	int moves[KAI_AMBO_COUNT];
+	int attacking = board_state->player == solver->attacker;
+	uint32_t second;
+	uint32_t child_proof_threshold;
+	uint32_t child_disproof_threshold;
+	kai_ambo_index_t first_ambo = board_state->player == 1 ? KAI_SOUTH_START : KAI_NORTH_START;
+	struct kai_board_state_t children[KAI_AMBO_COUNT];
+	struct kai_solver_entry_t values[KAI_AMBO_COUNT];
+
+	++solver->node_count;
+
+	for (i = 0; i < KAI_AMBO_COUNT; ++i)
+	{
+		if (board_state->seeds[first_ambo + i] == 0)
+			continue;
+
+		memcpy(&children[count], board_state, sizeof(*board_state));
+		kai_sow_move(&children[count], (kai_ambo_index_t) (first_ambo + i));
+		kai_solver_initial(solver, &children[count], &values[count]);
+		moves[count] = i + 1;
+		++count;
+	}
+
+	kai_table_key(board_state, solver->attacker, value->key);
+
+	while (1)
+	{
+		kai_solver_combine(attacking, values, moves, count, value);
+		if (value->proof >= proof_threshold || value->disproof >= disproof_threshold)
+			break;
+
+		if (solver->node_count >= solver->node_limit || (solver->stop != NULL && kai_atomic_load(solver->stop)))
+		{
+			solver->aborted = 1;
+			break;
+		}
+
+		// Work on the child that is cheapest to solve for the player to move, until it costs more than the next best
+		// one. The next best is given a quarter on top, so the search does not switch back and forth between them.
+		best = 0;
+		second = KAI_SOLVER_INFINITY;
+		for (i = 1; i < count; ++i)
+		{
+			if ((attacking ? values[i].proof : values[i].disproof) < (attacking ? values[best].proof : values[best].disproof))
+			{
+				second = attacking ? values[best].proof : values[best].disproof;
+				best = i;
+			}
+			else if ((attacking ? values[i].proof : values[i].disproof) < second)
+				second = attacking ? values[i].proof : values[i].disproof;
+		}
+
+		second += second / 4 + 1;
+		if (attacking)
+		{
+			child_proof_threshold = proof_threshold < second ? proof_threshold : second;
+			child_disproof_threshold = disproof_threshold - value->disproof + values[best].disproof;
+		}
+		else
+		{
+			child_proof_threshold = proof_threshold - value->proof + values[best].proof;
+			child_disproof_threshold = disproof_threshold < second ? disproof_threshold : second;
+		}
+
+		if (child_proof_threshold > KAI_SOLVER_INFINITY)
+			child_proof_threshold = KAI_SOLVER_INFINITY;
+		if (child_disproof_threshold > KAI_SOLVER_INFINITY)
+			child_disproof_threshold = KAI_SOLVER_INFINITY;
+
+		kai_solver_mid(solver, &children[best], child_proof_threshold, child_disproof_threshold, &values[best]);
+	}
+
+	kai_solver_store(solver, value);
+}
+
+int kai_solver_create(struct kai_solver_t* solver, void* memory, size_t size)
+{
+	solver->buckets = (struct kai_solver_bucket_t*) memory;
+	solver->bucket_count = size / sizeof(struct kai_solver_bucket_t);
+	solver->node_limit = KAI_SOLVER_DEFAULT_NODE_LIMIT;
+	solver->node_count = 0;
+	solver->aborted = 0;
+	solver->attacker = KAI_PLAYER_NONE;
+	solver->stop = NULL;
+
+	if (solver->bucket_count == 0)
+		return 1;
+
+	memset(memory, 0, solver->bucket_count * sizeof(struct kai_solver_bucket_t));
+	return 0;
+}
+
+int kai_solver_solve(struct kai_solver_t* solver, const struct kai_board_state_t* board_state, kai_player_id_t attacker, kai_atomic_t* stop)
+{
+	int outcome;
+	struct kai_solver_entry_t root;
+
+	solver->attacker = attacker;
+	solver->stop = stop;
+	solver->node_count = 0;
+	solver->aborted = 0;
+
+	outcome = kai_solver_terminal(board_state, attacker);
+	if (outcome != -1)
+		return outcome == 1 ? KAI_SOLVER_WIN : KAI_SOLVER_NO_WIN;
+
+	kai_solver_mid(solver, board_state, KAI_SOLVER_INFINITY, KAI_SOLVER_INFINITY, &root);
+	if (root.proof == 0)
+		return KAI_SOLVER_WIN;
+	if (root.disproof == 0)
+		return KAI_SOLVER_NO_WIN;
+
+	return KAI_SOLVER_UNKNOWN;
+}
+
+int kai_solver_lookup(const struct kai_solver_t* solver, const struct kai_board_state_t* board_state, kai_player_id_t attacker, int* distance, int* move)
+{
+	int outcome = kai_solver_terminal(board_state, attacker);
+	uint64_t key[2];
+	const struct kai_solver_entry_t* entry = NULL;
+
+	if (outcome == -1)
+	{
+		kai_table_key(board_state, attacker, key);
+		entry = kai_solver_find(solver, key);
+		if (entry == NULL || (entry->proof != 0 && entry->disproof != 0))
+			return KAI_SOLVER_UNKNOWN;
+
+		outcome = entry->proof == 0 ? 1 : 0;
+	}
+
+	if (distance != NULL)
+		*distance = entry != NULL ? entry->distance : 0;
+	if (move != NULL)
+		*move = entry != NULL ? entry->move : 0;
+
+	return outcome == 1 ? KAI_SOLVER_WIN : KAI_SOLVER_NO_WIN;
+}
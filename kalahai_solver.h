@@ -0,0 +1,105 @@
+#ifndef KALAHAI_SOLVER_H
+#define KALAHAI_SOLVER_H
+
+#include "kalahai.h"
+#include <stdint.h>
+
+
+/**
+	DEFINES
+*/
+
+// Proof and disproof numbers of this size mean the position is disproven or proven.
+#define KAI_SOLVER_INFINITY 100000000
+
+// The outcome of kai_solver_solve() for the attacking player.
+#define KAI_SOLVER_UNKNOWN 0
+#define KAI_SOLVER_WIN 1
+#define KAI_SOLVER_NO_WIN 2
+
+// The number of entries in one bucket.
+#define KAI_SOLVER_BUCKET_SIZE 2
+
+// kai_minimax_search() tries to solve the root first once either house holds this many seeds.
+#define KAI_SOLVER_TRIGGER_SEEDS 28
+
+// The size of the table kai_run() gives its solver, and the default node limit of one solve.
+#define KAI_SOLVER_DEFAULT_SIZE (16 * 1024 * 1024)
+#define KAI_SOLVER_DEFAULT_NODE_LIMIT 1000000
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	The proof and disproof numbers of one position, for one attacker. The key is the one of kai_table_key().
+*/
+struct kai_solver_entry_t
+{
+	uint64_t key[2];
+	uint32_t proof;
+	uint32_t disproof;
+
+	// For a solved position, the number of plies to the end of the proof (or disproof) tree, and the move (1 - 6) the
+	// player to move should make: the fastest one if the player to move wins, the slowest one otherwise.
+	uint16_t distance;
+	unsigned char move;
+};
+
+struct kai_solver_bucket_t
+{
+	struct kai_solver_entry_t entries[KAI_SOLVER_BUCKET_SIZE];
+};
+
+/**
+	A depth-first proof-number (df-pn) solver, deciding whether a player can force more than half the seeds into their
+	house. All memory is given to kai_solver_create(), so a solver never allocates. Solved positions are kept over
+	unsolved ones when the table fills up. Not thread safe.
+*/
+struct kai_solver_t
+{
+	struct kai_solver_bucket_t* buckets;
+	size_t bucket_count;
+
+	// The maximum number of nodes of one solve.
+	long long node_limit;
+
+	// The number of nodes of the last solve, and 1 if it ran out of nodes or was stopped.
+	long long node_count;
+	int aborted;
+
+	// The player trying to win, and the flag stopping the solve (may be NULL).
+	kai_player_id_t attacker;
+	kai_atomic_t* stop;
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Set up a solver in size bytes of memory, with KAI_SOLVER_DEFAULT_NODE_LIMIT. The memory is cleared.
+
+	Returns 0 on success, 1 if the memory cannot hold a single bucket.
+*/
+int kai_solver_create(struct kai_solver_t* solver, void* memory, size_t size);
+
+/**
+	Try to prove that attacker can force a win from board_state, within the node limit of the solver. The solve ends
+	early if stop (which may be NULL) is set. Results are kept in the table, so solving again continues the work.
+
+	Returns KAI_SOLVER_WIN or KAI_SOLVER_NO_WIN (the opponent can force a win or a draw), or KAI_SOLVER_UNKNOWN.
+*/
+int kai_solver_solve(struct kai_solver_t* solver, const struct kai_board_state_t* board_state, kai_player_id_t attacker, kai_atomic_t* stop);
+
+/**
+	Look up a position solved for attacker by kai_solver_solve(). distance and move receive the values of
+	kai_solver_entry_t, and may be NULL.
+
+	Returns KAI_SOLVER_WIN, KAI_SOLVER_NO_WIN or KAI_SOLVER_UNKNOWN (also if the position is no longer in the table).
+*/
+int kai_solver_lookup(const struct kai_solver_t* solver, const struct kai_board_state_t* board_state, kai_player_id_t attacker, int* distance, int* move);
+
+#endif
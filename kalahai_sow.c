@@ -0,0 +1,112 @@
+#include "kalahai_sow.h"
+
+
+/**
+	The table is written out by the preprocessor, so every entry is a constant expression. Side 0 is the south
+	(player 1), side 1 the north.
+*/
+
+// The first ambo of a side, the pit sown from, and the house that is skipped.
+#define KAI_SOW_FIRST(side) ((side) == 0 ? KAI_SOUTH_START : KAI_NORTH_START)
+#define KAI_SOW_ORIGIN(side, ambo) (KAI_SOW_FIRST(side) + (ambo))
+#define KAI_SOW_SKIPPED(side) ((side) == 0 ? KAI_NORTH_HOUSE : KAI_SOUTH_HOUSE)
+
+// The number of steps around the board from one pit to another, and from the origin to the skipped house.
+#define KAI_SOW_STEPS(from, to) (((to) - (from) + 14) % 14)
+#define KAI_SOW_SKIPPED_STEPS(side, ambo) KAI_SOW_STEPS(KAI_SOW_ORIGIN(side, ambo), KAI_SOW_SKIPPED(side))
+
+// The place (1 - KAI_SOW_LAP) of a pit in the order it is sown, or 0 if it is never sown.
+#define KAI_SOW_PLACE(side, ambo, pit) \
+	((pit) == KAI_SOW_ORIGIN(side, ambo) || (pit) == KAI_SOW_SKIPPED(side) ? 0 : \
+	KAI_SOW_STEPS(KAI_SOW_ORIGIN(side, ambo), pit) - (KAI_SOW_STEPS(KAI_SOW_ORIGIN(side, ambo), pit) > KAI_SOW_SKIPPED_STEPS(side, ambo)))
+
+// Every sown pit gets a seed per full lap, and the first ones of the last lap get one more.
+#define KAI_SOW_INCREMENT(side, ambo, seeds, pit) \
+	(KAI_SOW_PLACE(side, ambo, pit) == 0 ? 0 : (seeds) / KAI_SOW_LAP + (KAI_SOW_PLACE(side, ambo, pit) <= (seeds) % KAI_SOW_LAP))
+
+// The last seed lands at the place of the last lap, one step further if the skipped house is on the way.
+#define KAI_SOW_LAST_PLACE(seeds) (((seeds) - 1) % KAI_SOW_LAP + 1)
+#define KAI_SOW_LANDING(side, ambo, seeds) \
+	((seeds) == 0 ? KAI_SOW_ORIGIN(side, ambo) : \
+	(KAI_SOW_ORIGIN(side, ambo) + KAI_SOW_LAST_PLACE(seeds) + (KAI_SOW_LAST_PLACE(seeds) >= KAI_SOW_SKIPPED_STEPS(side, ambo))) % 14)
+
+#define KAI_SOW_ENTRY(side, ambo, seeds) \
+	{ { KAI_SOW_INCREMENT(side, ambo, seeds, 0), KAI_SOW_INCREMENT(side, ambo, seeds, 1), KAI_SOW_INCREMENT(side, ambo, seeds, 2), \
+	KAI_SOW_INCREMENT(side, ambo, seeds, 3), KAI_SOW_INCREMENT(side, ambo, seeds, 4), KAI_SOW_INCREMENT(side, ambo, seeds, 5), \
+	KAI_SOW_INCREMENT(side, ambo, seeds, 6), KAI_SOW_INCREMENT(side, ambo, seeds, 7), KAI_SOW_INCREMENT(side, ambo, seeds, 8), \
+	KAI_SOW_INCREMENT(side, ambo, seeds, 9), KAI_SOW_INCREMENT(side, ambo, seeds, 10), KAI_SOW_INCREMENT(side, ambo, seeds, 11), \
+	KAI_SOW_INCREMENT(side, ambo, seeds, 12), KAI_SOW_INCREMENT(side, ambo, seeds, 13) }, KAI_SOW_LANDING(side, ambo, seeds) }
+
+#define KAI_SOW_TEN(side, ambo, tens) \
+	KAI_SOW_ENTRY(side, ambo, (tens) * 10 + 0), KAI_SOW_ENTRY(side, ambo, (tens) * 10 + 1), \
+	KAI_SOW_ENTRY(side, ambo, (tens) * 10 + 2), KAI_SOW_ENTRY(side, ambo, (tens) * 10 + 3), \
+	KAI_SOW_ENTRY(side, ambo, (tens) * 10 + 4), KAI_SOW_ENTRY(side, ambo, (tens) * 10 + 5), \
+	KAI_SOW_ENTRY(side, ambo, (tens) * 10 + 6), KAI_SOW_ENTRY(side, ambo, (tens) * 10 + 7), \
+	KAI_SOW_ENTRY(side, ambo, (tens) * 10 + 8), KAI_SOW_ENTRY(side, ambo, (tens) * 10 + 9)
+
+// Seed counts 0 to 72 (KAI_SEED_TOTAL).
+#define KAI_SOW_AMBO(side, ambo) \
+	{ KAI_SOW_TEN(side, ambo, 0), KAI_SOW_TEN(side, ambo, 1), KAI_SOW_TEN(side, ambo, 2), KAI_SOW_TEN(side, ambo, 3), \
+	KAI_SOW_TEN(side, ambo, 4), KAI_SOW_TEN(side, ambo, 5), KAI_SOW_TEN(side, ambo, 6), \
+	KAI_SOW_ENTRY(side, ambo, 70), KAI_SOW_ENTRY(side, ambo, 71), KAI_SOW_ENTRY(side, ambo, 72) }
+
+#define KAI_SOW_SIDE(side) \
+	{ KAI_SOW_AMBO(side, 0), KAI_SOW_AMBO(side, 1), KAI_SOW_AMBO(side, 2), \
+	KAI_SOW_AMBO(side, 3), KAI_SOW_AMBO(side, 4), KAI_SOW_AMBO(side, 5) }
+
+static const struct kai_sow_t kai_sow_table[2][KAI_AMBO_COUNT][KAI_SEED_TOTAL + 1] = { KAI_SOW_SIDE(0), KAI_SOW_SIDE(1) };
+
+
+void kai_sow_move(struct kai_board_state_t* state, kai_ambo_index_t ambo)
+{
+	int i;
+	int side = state->player == 1 ? 0 : 1;
+	int first = KAI_SOW_FIRST(side);
+	kai_ambo_index_t house = side == 0 ? KAI_SOUTH_HOUSE : KAI_NORTH_HOUSE;
+	kai_ambo_index_t landing;
+	kai_ambo_index_t opposite_ambo;
+	kai_ambo_t* seeds = state->seeds;
+	const struct kai_sow_t* sow;
+
+	if (ambo < first || ambo >= first + KAI_AMBO_COUNT || seeds[ambo] > KAI_SEED_TOTAL)
+	{
+		kai_play_move(state, ambo);
+		return;
+	}
+
+	sow = &kai_sow_table[side][ambo - first][seeds[ambo]];
+	seeds[ambo] = 0;
+	for (i = 0; i < 14; ++i)
+		seeds[i] = (kai_ambo_t) (seeds[i] + sow->increments[i]);
+
+	// Landing in our own house gives an extra move, landing in an empty ambo of our own captures the opposite ambo.
+	landing = sow->landing;
+	if (landing != house)
+		state->player = (kai_player_id_t) (side == 0 ? 2 : 1);
+
+	if (landing >= first && landing < first + KAI_AMBO_COUNT && seeds[landing] == 1)
+	{
+		opposite_ambo = KAI_NORTH_END - landing;
+		seeds[house] = (kai_ambo_t) (seeds[house] + seeds[opposite_ambo] + 1);
+		seeds[opposite_ambo] = 0;
+		seeds[landing] = 0;
+	}
+
+	// When a side is out of seeds, the other side goes into its owner's house.
+	if ((seeds[0] | seeds[1] | seeds[2] | seeds[3] | seeds[4] | seeds[5]) == 0)
+	{
+		seeds[KAI_NORTH_HOUSE] = (kai_ambo_t) (seeds[KAI_NORTH_HOUSE] + seeds[7] + seeds[8] + seeds[9] + seeds[10] + seeds[11] + seeds[12]);
+		memset(&seeds[KAI_NORTH_START], 0, KAI_AMBO_COUNT);
+	}
+
+	if ((seeds[7] | seeds[8] | seeds[9] | seeds[10] | seeds[11] | seeds[12]) == 0)
+	{
+		seeds[KAI_SOUTH_HOUSE] = (kai_ambo_t) (seeds[KAI_SOUTH_HOUSE] + seeds[0] + seeds[1] + seeds[2] + seeds[3] + seeds[4] + seeds[5]);
+		memset(&seeds[KAI_SOUTH_START], 0, KAI_AMBO_COUNT);
+	}
+}
+
+const struct kai_sow_t* kai_sow_lookup(kai_player_id_t player, int ambo, int seeds)
+{
+	return &kai_sow_table[player == 1 ? 0 : 1][ambo][seeds];
+}
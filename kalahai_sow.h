@@ -0,0 +1,48 @@
+#ifndef KALAHAI_SOW_H
+#define KALAHAI_SOW_H
+
+#include "kalahai.h"
+
+
+/**
+	DEFINES
+*/
+
+// The number of pits one lap of sowing passes: every pit but the ambo sown from and the house of the opponent.
+#define KAI_SOW_LAP 12
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	The outcome of sowing a number of seeds from one ambo, before captures and the end of the game.
+*/
+struct kai_sow_t
+{
+	// The number of seeds every pit of the board receives, including the full laps.
+	kai_ambo_t increments[14];
+
+	// The pit the last seed lands in.
+	kai_ambo_index_t landing;
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Make a move like kai_play_move(), with the sowing taken from a table instead of done seed by seed. The table holds
+	every count of seeds up to KAI_SEED_TOTAL from every ambo of both players, and is generated at compile time. Larger
+	counts, and ambos of the player not to move, are left to kai_play_move().
+*/
+void kai_sow_move(struct kai_board_state_t* state, kai_ambo_index_t ambo);
+
+/**
+	Return the table entry of sowing seeds (0 - KAI_SEED_TOTAL) from an ambo (0 - 5) of a player.
+*/
+const struct kai_sow_t* kai_sow_lookup(kai_player_id_t player, int ambo, int seeds);
+
+#endif
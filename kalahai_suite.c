@@ -0,0 +1,108 @@
+#include "kalahai_suite.h"
+
+/**
+	Follows the iterations of a search on a suite position.
+*/
+struct kai_suite_progress_t
+{
+	const struct kai_suite_position_t* position;
+	struct kai_suite_result_t* result;
+};
+
+/**
+	Iteration callback of kai_suite_run(). A completed iteration on another move forgets when the move was found.
+*/
+static void kai_suite_iteration(const struct kai_search_info_t* info, void* user_data)
+{
+	struct kai_suite_progress_t* progress = (struct kai_suite_progress_t*) user_data;
+
+	if (!info->completed)
+		return;
+
+	if (info->best_move != progress->position->move)
+		progress->result->solved = 0;
+	else if (!progress->result->solved)
+	{
+		progress->result->solved = 1;
+		progress->result->depth = info->depth;
+		progress->result->nodes = info->nodes;
+		progress->result->time = info->time;
+	}
+}
+
+int kai_suite_load(struct kai_suite_t* suite, const char* path)
+{
+	FILE* file;
+	char line[256];
+	char board_string[128];
+	const char* c;
+	int separators;
+	int line_number = 0;
+	struct kai_suite_position_t* position;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Failed to open suite file %s\n", path);
+		return 1;
+	}
+
+	suite->position_count = 0;
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		++line_number;
+		if (line[0] == '#' || sscanf(line, "%127s", board_string) != 1)
+			continue;
+
+		if (suite->position_count == KAI_SUITE_MAX_POSITIONS)
+		{
+			fprintf(stderr, "%s:%d: More than %d positions\n", path, line_number, KAI_SUITE_MAX_POSITIONS);
+			fclose(file);
+			return 1;
+		}
+
+		// A board string has the 14 pits and the player to move, and the move must be of a non-empty ambo.
+		position = &suite->positions[suite->position_count];
+		for (c = board_string, separators = 0; *c != '\0'; ++c)
+			separators += *c == ';';
+		if (separators != 14 || sscanf(line, "%*s %d %d", &position->move, &position->score) != 2 ||
+			kai_parse_board_state(&position->board_state, board_string) != 0 ||
+			(position->board_state.player != 1 && position->board_state.player != 2) ||
+			position->move < 1 || position->move > KAI_AMBO_COUNT ||
+			position->board_state.seeds[(position->board_state.player == 1 ? KAI_SOUTH_START : KAI_NORTH_START) + position->move - 1] == 0)
+		{
+			fprintf(stderr, "%s:%d: Invalid position: %s", path, line_number, line);
+			fclose(file);
+			return 1;
+		}
+
+		position->line = line_number;
+		suite->position_count++;
+	}
+
+	fclose(file);
+	return 0;
+}
+
+int kai_suite_run(struct kai_engine_t* engine, const struct kai_suite_position_t* position, const struct kai_engine_limits_t* limits, struct kai_suite_result_t* result)
+{
+	struct kai_suite_progress_t progress;
+	struct kai_engine_callbacks_t callbacks;
+
+	memset(result, 0, sizeof(*result));
+	progress.position = position;
+	progress.result = result;
+	callbacks.iteration = kai_suite_iteration;
+	callbacks.user_data = &progress;
+
+	kai_engine_set_position(engine, &position->board_state);
+	if (kai_engine_search(engine, limits, &callbacks, &result->search) == -1)
+		return 1;
+
+	// The move of the last completed iteration is the one the search ends on.
+	if (result->search.best_move != position->move)
+		result->solved = 0;
+	result->proved = result->solved && result->search.score == position->score;
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef KALAHAI_SUITE_H
+#define KALAHAI_SUITE_H
+
+#include "kalahai.h"
+#include "kalahai_engine.h"
+
+
+/**
+	DEFINES
+*/
+
+/*
+	Test position suites.
+
+	A suite file has one position per line: a board string (as kai_parse_board_state() reads it), the proven best move
+	(1 - 6) of the player to move, and the proven score of the position for the player to move (KAI_EVALUATION_MAX for
+	a forced win), separated by spaces. Anything after the score is a comment, as are lines starting with '#'.
+*/
+
+// The most positions a suite holds.
+#define KAI_SUITE_MAX_POSITIONS 256
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	One position of a suite.
+*/
+struct kai_suite_position_t
+{
+	struct kai_board_state_t board_state;
+
+	// The best move (1 - 6) and the score of the position for the player to move.
+	int move;
+	int score;
+
+	// The line of the suite file the position is on.
+	int line;
+};
+
+/**
+	The positions of a suite file.
+*/
+struct kai_suite_t
+{
+	struct kai_suite_position_t positions[KAI_SUITE_MAX_POSITIONS];
+	int position_count;
+};
+
+/**
+	How a search did on a position of a suite.
+*/
+struct kai_suite_result_t
+{
+	// 1 if the search ended on the best move.
+	int solved;
+
+	// The first completed iteration that selected the best move, with every later iteration keeping it: its depth,
+	// the nodes searched until it completed and the time since the search started. Only set if solved.
+	int depth;
+	long long nodes;
+	double time;
+
+	// 1 if the search also ended on the score of the position.
+	int proved;
+
+	// The whole search: its deepest completed iteration and the nodes and time it took.
+	struct kai_search_info_t search;
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Read a suite file.
+
+	Returns 0 on success, 1 if the file cannot be read or has a line that is not a position.
+*/
+int kai_suite_load(struct kai_suite_t* suite, const char* path);
+
+/**
+	Search a position of a suite with an engine, and find when the search found the best move and kept it.
+	The position of the engine is set to the position, the rest of its state is used as it is.
+
+	Returns 0 on success, 1 if the search failed.
+*/
+int kai_suite_run(struct kai_engine_t* engine, const struct kai_suite_position_t* position, const struct kai_engine_limits_t* limits, struct kai_suite_result_t* result);
+
+#endif
@@ -0,0 +1,313 @@
+#include "kalahai_suite.h"
+#include "kalahai_solver.h"
+#include "kalahai_parameters.h"
+#include <math.h>
+
+// The smallest node count and time counted in geometric means, so that a position solved at once does not count as 0.
+#define KAI_SUITE_MIN_NODES 1.0
+#define KAI_SUITE_MIN_TIME 0.000001
+
+// The size of the transposition table of the table and solver configurations.
+#define KAI_SUITE_TABLE_SIZE (32 * 1024 * 1024)
+
+// Configurations: no tables, a transposition table, and a transposition table and the solver.
+#define KAI_SUITE_CONFIG_PLAIN 0
+#define KAI_SUITE_CONFIG_TABLE 1
+#define KAI_SUITE_CONFIG_SOLVER 2
+#define KAI_SUITE_CONFIG_COUNT 3
+
+static const char* kai_suite_config_names[KAI_SUITE_CONFIG_COUNT] = { "plain", "table", "solver" };
+
+/**
+	Statistics of a set of values.
+*/
+struct kai_suite_statistics_t
+{
+	double mean;
+	double median;
+	double geometric_mean;
+};
+
+
+/**
+	Compare two doubles for qsort().
+*/
+static int kai_suite_compare(const void* a, const void* b)
+{
+	double x = *(const double*) a;
+	double y = *(const double*) b;
+
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/**
+	Find the mean, median and geometric mean of count values. The values are sorted. Values below minimum are counted
+	as minimum in the geometric mean.
+*/
+static void kai_suite_statistics(double* values, int count, double minimum, struct kai_suite_statistics_t* statistics)
+{
+	int i;
+	double sum = 0.0;
+	double log_sum = 0.0;
+
+	memset(statistics, 0, sizeof(*statistics));
+	if (count == 0)
+		return;
+
+	qsort(values, count, sizeof(double), kai_suite_compare);
+	for (i = 0; i < count; ++i)
+	{
+		sum += values[i];
+		log_sum += log(values[i] > minimum ? values[i] : minimum);
+	}
+
+	statistics->mean = sum / count;
+	statistics->median = count % 2 == 1 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2.0;
+	statistics->geometric_mean = exp(log_sum / count);
+}
+
+/**
+	Create an engine for a configuration.
+
+	Returns the engine, or NULL on failure.
+*/
+static struct kai_engine_t* kai_suite_create_engine(int config, const struct kai_parameters_t* parameters)
+{
+	size_t size = 0;
+	struct kai_engine_t* engine;
+
+	engine = kai_engine_create();
+	if (engine == NULL)
+		return NULL;
+
+	if (parameters != NULL)
+		kai_engine_set_parameters(engine, parameters);
+
+	if (config == KAI_SUITE_CONFIG_TABLE)
+		size = KAI_SUITE_TABLE_SIZE;
+	else if (config == KAI_SUITE_CONFIG_SOLVER)
+		size = KAI_SUITE_TABLE_SIZE + KAI_SOLVER_DEFAULT_SIZE;
+
+	if (size > 0 && (kai_engine_reserve_memory(engine, size) != 0 || kai_engine_create_table(engine, KAI_SUITE_TABLE_SIZE) != 0 ||
+		(config == KAI_SUITE_CONFIG_SOLVER && kai_engine_create_solver(engine, KAI_SOLVER_DEFAULT_SIZE) != 0)))
+	{
+		kai_engine_destroy(engine);
+		return NULL;
+	}
+
+	return engine;
+}
+
+/**
+	Program entry point.
+
+	Usage: kalahai_suite <suite file> [--nodes <count>] [--time <seconds>] [--depth <depth>] [--config <name>]...
+	                     [--parameters <file>]
+
+	Searches every position of a suite file (see kalahai_suite.h) with every configuration, and measures the nodes and
+	time each search needs to find the best move of the position and keep it. The configurations are 'plain' (no
+	tables), 'table' (a transposition table) and 'solver' (a transposition table and the solver), all three unless
+	some are given. Every search starts from a new engine, so the positions do not share tables. Searches are limited
+	to 10 million nodes unless other limits are given.
+
+	Prints every search, then the solved positions and the statistics of the nodes and time to the best move of every
+	configuration, and finally compares the configurations on the positions all of them solved.
+*/
+int main(int argc, char* argv[])
+{
+	int i;
+	int c;
+	int p;
+	int count;
+	int config_count = 0;
+	int configs[KAI_SUITE_CONFIG_COUNT];
+	int solved[KAI_SUITE_CONFIG_COUNT];
+	int proved[KAI_SUITE_CONFIG_COUNT];
+	int solved_by_all;
+	double* nodes;
+	double* times;
+	double total_time;
+	long long total_nodes;
+	double log_ratios[KAI_SUITE_CONFIG_COUNT];
+	const char* suite_path = NULL;
+	struct kai_suite_t* suite;
+	struct kai_suite_result_t* results;
+	struct kai_suite_result_t* result;
+	struct kai_suite_statistics_t node_statistics;
+	struct kai_suite_statistics_t time_statistics;
+	struct kai_engine_limits_t limits;
+	struct kai_engine_t* engine;
+	struct kai_parameters_t parameters;
+	const struct kai_parameters_t* search_parameters = NULL;
+
+	limits.depth = 0;
+	limits.nodes = 10000000;
+	limits.time = 0.0;
+
+	for (i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc)
+			limits.nodes = atoll(argv[++i]);
+		else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc)
+			limits.time = atof(argv[++i]);
+		else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+			limits.depth = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--config") == 0 && i + 1 < argc)
+		{
+			++i;
+			for (c = 0; c < KAI_SUITE_CONFIG_COUNT && strcmp(argv[i], kai_suite_config_names[c]) != 0; ++c);
+			if (c == KAI_SUITE_CONFIG_COUNT || config_count == KAI_SUITE_CONFIG_COUNT)
+			{
+				fprintf(stderr, "Unknown or repeated configuration: %s\n", argv[i]);
+				return 1;
+			}
+			configs[config_count++] = c;
+		}
+		else if (strcmp(argv[i], "--parameters") == 0 && i + 1 < argc)
+		{
+			kai_parameters_init(&parameters);
+			if (kai_parameters_load(&parameters, argv[++i]) != 0)
+				return 1;
+			search_parameters = &parameters;
+		}
+		else if (suite_path == NULL && argv[i][0] != '-')
+			suite_path = argv[i];
+		else
+		{
+			fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (suite_path == NULL)
+	{
+		fprintf(stderr, "Usage: %s <suite file> [--nodes <count>] [--time <seconds>] [--depth <depth>] [--config <name>]... [--parameters <file>]\n", argv[0]);
+		return 1;
+	}
+
+	// The searches are only limited by the nodes given, if only nodes are given.
+	if (limits.time > 0.0 || limits.depth > 0)
+	{
+		for (i = 1; i < argc && strcmp(argv[i], "--nodes") != 0; ++i);
+		if (i == argc)
+			limits.nodes = 0;
+	}
+
+	if (config_count == 0)
+	{
+		for (c = 0; c < KAI_SUITE_CONFIG_COUNT; ++c)
+			configs[config_count++] = c;
+	}
+
+	// The suite holds every position, so keep it off the stack.
+	suite = (struct kai_suite_t*) malloc(sizeof(*suite));
+	if (suite == NULL || kai_suite_load(suite, suite_path) != 0)
+	{
+		free(suite);
+		return 1;
+	}
+
+	results = (struct kai_suite_result_t*) malloc(config_count * suite->position_count * sizeof(*results) + 1);
+	nodes = (double*) malloc(suite->position_count * sizeof(double) + 1);
+	times = (double*) malloc(suite->position_count * sizeof(double) + 1);
+	if (results == NULL || nodes == NULL || times == NULL)
+	{
+		free(results);
+		free(nodes);
+		free(times);
+		free(suite);
+		return 1;
+	}
+
+	for (p = 0; p < suite->position_count; ++p)
+	{
+		for (c = 0; c < config_count; ++c)
+		{
+			result = &results[c * suite->position_count + p];
+			engine = kai_suite_create_engine(configs[c], search_parameters);
+			if (engine == NULL || kai_suite_run(engine, &suite->positions[p], &limits, result) != 0)
+			{
+				fprintf(stderr, "Failed to search the position on line %d with configuration %s.\n", suite->positions[p].line, kai_suite_config_names[configs[c]]);
+				if (engine != NULL)
+					kai_engine_destroy(engine);
+				free(results);
+				free(nodes);
+				free(times);
+				free(suite);
+				return 1;
+			}
+			kai_engine_destroy(engine);
+
+			if (result->solved)
+			{
+				fprintf(stdout, "Line %d, %s: found move %d at depth %d after %lld nodes in %f seconds.%s\n", suite->positions[p].line,
+					kai_suite_config_names[configs[c]], suite->positions[p].move, result->depth, result->nodes, result->time, result->proved ? " Proved the score." : "");
+			}
+			else
+			{
+				fprintf(stdout, "Line %d, %s: not found, selected move %d at depth %d (best move %d).\n", suite->positions[p].line,
+					kai_suite_config_names[configs[c]], result->search.best_move, result->search.depth, suite->positions[p].move);
+			}
+		}
+	}
+
+	fprintf(stdout, "\n");
+	for (c = 0; c < config_count; ++c)
+	{
+		count = 0;
+		total_nodes = 0;
+		total_time = 0.0;
+		proved[c] = 0;
+		for (p = 0; p < suite->position_count; ++p)
+		{
+			result = &results[c * suite->position_count + p];
+			total_nodes += result->search.nodes;
+			total_time += result->search.time;
+			proved[c] += result->proved;
+			if (!result->solved)
+				continue;
+
+			nodes[count] = (double) result->nodes;
+			times[count] = result->time;
+			++count;
+		}
+		solved[c] = count;
+
+		kai_suite_statistics(nodes, count, KAI_SUITE_MIN_NODES, &node_statistics);
+		kai_suite_statistics(times, count, KAI_SUITE_MIN_TIME, &time_statistics);
+		fprintf(stdout, "%s: solved %d of %d, proved %d. Searched %lld nodes in %f seconds.\n", kai_suite_config_names[configs[c]],
+			solved[c], suite->position_count, proved[c], total_nodes, total_time);
+		fprintf(stdout, "    Nodes to solution: mean %.0f, median %.0f, geometric mean %.0f.\n", node_statistics.mean, node_statistics.median, node_statistics.geometric_mean);
+		fprintf(stdout, "    Time to solution: mean %f, median %f, geometric mean %f seconds.\n", time_statistics.mean, time_statistics.median, time_statistics.geometric_mean);
+	}
+
+	// Compare the nodes to solution to the first configuration, on the positions every configuration solved.
+	if (config_count > 1)
+	{
+		solved_by_all = 0;
+		for (c = 0; c < config_count; ++c)
+			log_ratios[c] = 0.0;
+
+		for (p = 0; p < suite->position_count; ++p)
+		{
+			for (c = 0; c < config_count && results[c * suite->position_count + p].solved; ++c);
+			if (c < config_count)
+				continue;
+
+			++solved_by_all;
+			for (c = 1; c < config_count; ++c)
+				log_ratios[c] += log((results[c * suite->position_count + p].nodes + KAI_SUITE_MIN_NODES) / (results[p].nodes + KAI_SUITE_MIN_NODES));
+		}
+
+		fprintf(stdout, "\nOn the %d positions solved by all, nodes to solution against %s (geometric mean):", solved_by_all, kai_suite_config_names[configs[0]]);
+		for (c = 1; c < config_count; ++c)
+			fprintf(stdout, " %s %.2fx%s", kai_suite_config_names[configs[c]], solved_by_all > 0 ? exp(log_ratios[c] / solved_by_all) : 0.0, c + 1 < config_count ? "," : ".\n");
+	}
+
+	free(results);
+	free(nodes);
+	free(times);
+	free(suite);
+
+	return 0;
+}
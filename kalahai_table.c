@@ -0,0 +1,162 @@
+#include "kalahai_table.h"
+
+// Bit layout of kai_table_entry_t::data.
+#define KAI_TABLE_DATA_SCORE_SHIFT 0
+#define KAI_TABLE_DATA_DEPTH_SHIFT 16
+#define KAI_TABLE_DATA_BOUND_SHIFT 24
+#define KAI_TABLE_DATA_MOVE_SHIFT 28
+#define KAI_TABLE_DATA_VALID ((uint64_t) 1 << 32)
+
+// The buckets of a shared table start this far into the shared memory.
+#define KAI_TABLE_HEADER_SIZE 64
+
+
+/**
+	Select the bucket for a key.
+*/
+static struct kai_table_bucket_t* kai_table_bucket(const struct kai_table_t* table, const uint64_t key[2])
+{
+	uint64_t hash = key[0] ^ (key[1] * 0x9E3779B97F4A7C15ULL);
+
+	hash ^= hash >> 31;
+	hash *= 0xBF58476D1CE4E5B9ULL;
+	hash ^= hash >> 29;
+
+	return &table->buckets[hash % table->bucket_count];
+}
+
+int kai_table_create(struct kai_table_t* table, void* memory, size_t size)
+{
+	table->buckets = (struct kai_table_bucket_t*) memory;
+	table->bucket_count = size / sizeof(struct kai_table_bucket_t);
+	table->shared = 0;
+	table->probes = 0;
+	table->hits = 0;
+
+	return table->bucket_count > 0 ? 0 : 1;
+}
+
+int kai_table_attach(struct kai_table_t* table, const char* name, size_t size)
+{
+	int created;
+	struct kai_timer_t timer;
+	struct kai_table_header_t* header;
+
+	if (size < KAI_TABLE_HEADER_SIZE + sizeof(struct kai_table_bucket_t))
+		return 1;
+
+	if (kai_shared_memory_open(&table->shared_memory, name, size, &created) != 0)
+	{
+		fprintf(stderr, "Failed to open shared table %s\n", name);
+		return 1;
+	}
+
+	header = (struct kai_table_header_t*) table->shared_memory.data;
+	if (created)
+	{
+		// The memory is zeroed, which is an empty table. Only the header has to be written.
+		memcpy(header->magic, KAI_TABLE_MAGIC, sizeof(header->magic));
+		header->version = KAI_TABLE_VERSION;
+		header->bucket_size = sizeof(struct kai_table_bucket_t);
+		header->bucket_count = (table->shared_memory.size - KAI_TABLE_HEADER_SIZE) / sizeof(struct kai_table_bucket_t);
+		kai_atomic_store(&header->ready, 1);
+	}
+	else
+	{
+		// Wait for the process that created the table to write the header.
+		kai_timer_start(&timer);
+		while (!kai_atomic_load(&header->ready) && kai_timer_get_time(&timer) < KAI_TABLE_ATTACH_TIMEOUT)
+			kai_sleep(0.001);
+
+		if (!kai_atomic_load(&header->ready) ||
+			memcmp(header->magic, KAI_TABLE_MAGIC, sizeof(header->magic)) != 0 ||
+			header->version != KAI_TABLE_VERSION ||
+			header->bucket_size != sizeof(struct kai_table_bucket_t) ||
+			KAI_TABLE_HEADER_SIZE + header->bucket_count * sizeof(struct kai_table_bucket_t) > table->shared_memory.size)
+		{
+			fprintf(stderr, "Shared table %s has an incompatible layout\n", name);
+			kai_shared_memory_close(&table->shared_memory);
+			return 1;
+		}
+	}
+
+	table->buckets = (struct kai_table_bucket_t*) ((unsigned char*) table->shared_memory.data + KAI_TABLE_HEADER_SIZE);
+	table->bucket_count = header->bucket_count;
+	table->shared = 1;
+	table->probes = 0;
+	table->hits = 0;
+
+	return 0;
+}
+
+void kai_table_detach(struct kai_table_t* table)
+{
+	if (table->shared)
+		kai_shared_memory_close(&table->shared_memory);
+
+	table->buckets = NULL;
+	table->bucket_count = 0;
+	table->shared = 0;
+}
+
+void kai_table_key(const struct kai_board_state_t* board_state, kai_player_id_t perspective, uint64_t key[2])
+{
+	unsigned char bytes[16];
+
+	// The board fits in the key as is, so different positions never share a key.
+	memcpy(bytes, board_state->seeds, 14);
+	bytes[14] = (unsigned char) board_state->player;
+	bytes[15] = (unsigned char) perspective;
+	memcpy(key, bytes, sizeof(bytes));
+}
+
+int kai_table_probe(const struct kai_table_t* table, const uint64_t key[2], struct kai_table_value_t* value)
+{
+	int i;
+	uint64_t data;
+	struct kai_table_entry_t* entry;
+	struct kai_table_bucket_t* bucket = kai_table_bucket(table, key);
+
+	for (i = 0; i < KAI_TABLE_BUCKET_SIZE; ++i)
+	{
+		entry = &bucket->entries[i];
+		data = kai_atomic64_load_relaxed(&entry->data);
+		if (!(data & KAI_TABLE_DATA_VALID))
+			continue;
+
+		if ((kai_atomic64_load_relaxed(&entry->check[0]) ^ data) != key[0] || (kai_atomic64_load_relaxed(&entry->check[1]) ^ data) != key[1])
+			continue;
+
+		value->score = (kai_evaluation_t) (uint16_t) (data >> KAI_TABLE_DATA_SCORE_SHIFT);
+		value->depth = (unsigned char) (data >> KAI_TABLE_DATA_DEPTH_SHIFT);
+		value->bound = (unsigned char) ((data >> KAI_TABLE_DATA_BOUND_SHIFT) & 0x3);
+		value->move = (unsigned char) ((data >> KAI_TABLE_DATA_MOVE_SHIFT) & 0x7);
+		return 1;
+	}
+
+	return 0;
+}
+
+void kai_table_store(struct kai_table_t* table, const uint64_t key[2], const struct kai_table_value_t* value)
+{
+	uint64_t data;
+	uint64_t existing;
+	struct kai_table_entry_t* entry;
+	struct kai_table_bucket_t* bucket = kai_table_bucket(table, key);
+
+	data = KAI_TABLE_DATA_VALID |
+		((uint64_t) (uint16_t) value->score << KAI_TABLE_DATA_SCORE_SHIFT) |
+		((uint64_t) value->depth << KAI_TABLE_DATA_DEPTH_SHIFT) |
+		((uint64_t) value->bound << KAI_TABLE_DATA_BOUND_SHIFT) |
+		((uint64_t) value->move << KAI_TABLE_DATA_MOVE_SHIFT);
+
+	// Keep the deepest result in the first entry. Anything else goes into the second one.
+	entry = &bucket->entries[0];
+	existing = kai_atomic64_load_relaxed(&entry->data);
+	if ((existing & KAI_TABLE_DATA_VALID) && value->depth < (unsigned char) (existing >> KAI_TABLE_DATA_DEPTH_SHIFT))
+		entry = &bucket->entries[1];
+
+	kai_atomic64_store_relaxed(&entry->check[0], key[0] ^ data);
+	kai_atomic64_store_relaxed(&entry->check[1], key[1] ^ data);
+	kai_atomic64_store_relaxed(&entry->data, data);
+}
@@ -0,0 +1,138 @@
+#ifndef KALAHAI_TABLE_H
+#define KALAHAI_TABLE_H
+
+#include "kalahai.h"
+#include <stdint.h>
+
+
+/**
+	DEFINES
+*/
+
+// Identifies the table layout in shared memory.
+#define KAI_TABLE_MAGIC "KAITABLE"
+#define KAI_TABLE_VERSION 1
+
+// The number of entries in one bucket. The first entry keeps the deepest result, the second the latest.
+#define KAI_TABLE_BUCKET_SIZE 2
+
+// How a stored score relates to the true value of the position.
+#define KAI_TABLE_BOUND_EXACT 0
+#define KAI_TABLE_BOUND_LOWER 1
+#define KAI_TABLE_BOUND_UPPER 2
+
+// The time to wait for another process to finish setting up a shared table.
+#define KAI_TABLE_ATTACH_TIMEOUT 5.0
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	One stored search result. The key is not stored as is, but XOR:ed with the data. A reader that sees a
+	write from another thread or process half done gets a key that does not match, so torn entries are
+	never used and no locks are needed.
+*/
+struct kai_table_entry_t
+{
+	uint64_t check[2];
+	uint64_t data;
+};
+
+struct kai_table_bucket_t
+{
+	struct kai_table_entry_t entries[KAI_TABLE_BUCKET_SIZE];
+};
+
+/**
+	The start of a shared table, followed by the buckets.
+*/
+struct kai_table_header_t
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t bucket_size;
+	uint64_t bucket_count;
+
+	// Set to 1 by the process that created the table once the header is written.
+	kai_atomic_t ready;
+};
+
+/**
+	A search result as stored in the table.
+*/
+struct kai_table_value_t
+{
+	kai_evaluation_t score;
+
+	// The remaining depth the position was searched to.
+	unsigned char depth;
+
+	// One of KAI_TABLE_BOUND_*.
+	unsigned char bound;
+
+	// The best move found (1 - 6), or 0 if none.
+	unsigned char move;
+};
+
+/**
+	A transposition table, either private to the process or in shared memory where every local engine process
+	attached to the same name reads and writes it.
+*/
+struct kai_table_t
+{
+	struct kai_table_bucket_t* buckets;
+	uint64_t bucket_count;
+
+	// The shared memory backing the table, if it is shared.
+	int shared;
+	struct kai_shared_memory_t shared_memory;
+
+	// Lookups and lookups that found their key, by this process only. Updated at the end of every search.
+	kai_atomic_t probes;
+	kai_atomic_t hits;
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Set up a private table in the given zeroed memory (for example from a kai_arena_t).
+
+	Returns 0 on success, 1 if the memory is too small for a single bucket.
+*/
+int kai_table_create(struct kai_table_t* table, void* memory, size_t size);
+
+/**
+	Attach to the shared table with the given name, creating it with size bytes if no process has yet.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_table_attach(struct kai_table_t* table, const char* name, size_t size);
+
+/**
+	Detach from a shared table. Does nothing for a private table.
+*/
+void kai_table_detach(struct kai_table_t* table);
+
+/**
+	Build the key of a board searched from the perspective of the given player.
+*/
+void kai_table_key(const struct kai_board_state_t* board_state, kai_player_id_t perspective, uint64_t key[2]);
+
+/**
+	Look up a key.
+
+	Returns 1 and fills value if the key was found, 0 otherwise.
+*/
+int kai_table_probe(const struct kai_table_t* table, const uint64_t key[2], struct kai_table_value_t* value);
+
+/**
+	Store a search result for a key.
+*/
+void kai_table_store(struct kai_table_t* table, const uint64_t key[2], const struct kai_table_value_t* value);
+
+#endif
@@ -1,10 +1,34 @@
 #include "kalahai.h"
+#include "kalahai_engine.h"
+#include "kalahai_arena.h"
+#include "kalahai_record.h"
+#include "kalahai_table.h"
+#include "kalahai_parameters.h"
+#include "kalahai_server.h"
+#include "kalahai_trace.h"
+#include "kalahai_solver.h"
+#include "kalahai_sow.h"
+#include "kalahai_tree.h"
+#include "kalahai_log.h"
+#include "kalahai_suite.h"
+#include "kalahai_sched.h"
+#include "kalahai_pattern.h"
 #include <stdio.h>
 
 #define assert_eq(actual, expected) if ((actual) == (expected)) report_success(); else report_failure();
 #define report_success() printf("[SUCCESS] Test %s:%d success.\n", __FUNCTION__, __LINE__)
 #define report_failure() printf("[FAILURE] Test %s:%d failure.\n", __FUNCTION__, __LINE__)
 
+/**
+	A search run on its own thread by test_engine().
+*/
+struct test_engine_job_t
+{
+	struct kai_engine_t* engine;
+	struct kai_engine_limits_t limits;
+	struct kai_search_info_t result;
+};
+
 /**
 	Test the kai_play_move() function.
 */
@@ -15,6 +39,126 @@ void test_play_move();
 */
 void test_minimax();
 
+/**
+	Test running a search on the worker thread and stopping it early.
+*/
+void test_search_worker();
+
+/**
+	Test the engine API, including several engines searching concurrently.
+*/
+void test_engine();
+
+/**
+	Thread entry point for test_engine(). Runs the test_engine_job_t passed as argument.
+*/
+void test_engine_thread(void* argument);
+
+/**
+	Test that multi-PV mode gives every root move its exact score.
+*/
+void test_multi_pv();
+
+/**
+	Test allocating from a memory arena.
+*/
+void test_arena();
+
+/**
+	Test writing game records and reading them back.
+*/
+void test_record();
+
+/**
+	Open the record file at the path passed as argument and append a game to it, for test_record().
+*/
+void test_record_thread(void* argument);
+
+/**
+	Test the transposition table, both private and shared between engines.
+*/
+void test_table();
+
+/**
+	Test writing and reading parameter files, and searching with other parameters.
+*/
+void test_parameters();
+
+/**
+	Test the commands of the game server.
+*/
+void test_server();
+
+/**
+	Test the latency histograms of the turn trace.
+*/
+void test_trace();
+
+/**
+	Test counting hardware events during a search, where the processor allows it.
+*/
+void test_counters();
+
+/**
+	Test proving wins and losses with the solver, and taking the fastest win in a search.
+*/
+void test_solver();
+
+/**
+	Test replying at once on the principal variation of the previous search, and continuing below it.
+*/
+void test_reuse();
+
+/**
+	Test that sowing from the table makes the same moves as kai_play_move().
+*/
+void test_sow();
+
+/**
+	Test recording searches into tree files, and comparing them.
+*/
+void test_tree();
+
+/**
+	Test that evaluating boards together gives the evaluations of kai_minimax_node_evaluation().
+*/
+void test_evaluate_batch();
+
+/**
+	Test logging from several rings through the writer thread.
+*/
+void test_log();
+
+/**
+	Test reading test position suites and measuring searches on them.
+*/
+void test_suite();
+
+/**
+	Test that a position and its mirror, with the other player to move, share the results of the table.
+*/
+void test_negamax();
+
+/**
+	Test sizing threads to the processors of the process, and placing them on distinct physical cores.
+*/
+void test_sched();
+
+/**
+	Pin a thread of test_sched() to the processor passed as argument, and store whether it succeeded there.
+*/
+void test_sched_thread(void* argument);
+
+/**
+	Return the physical core of a processor of a kai_sched_t.
+*/
+int test_sched_core(const struct kai_sched_t* sched, int cpu);
+
+/**
+	Test writing, mapping and indexing pattern files, and adding their values to the evaluation.
+*/
+void test_patterns();
+
 
 /**
 	Program entry point
@@ -23,8 +167,28 @@ int main(int argc, char* argv[])
 {
 	//test_play_move();
 	test_minimax();
+	test_search_worker();
+	test_engine();
+	test_multi_pv();
+	test_arena();
+	test_record();
+	test_table();
+	test_parameters();
+	test_server();
+	test_trace();
+	test_counters();
+	test_solver();
+	test_reuse();
+	test_sow();
+	test_tree();
+	test_evaluate_batch();
+	test_log();
+	test_suite();
+	test_negamax();
+	test_sched();
+	test_patterns();
 
-	getchar();
+	kai_console_pause();
 	return 0;
 }
 
@@ -177,4 +341,1278 @@ void test_minimax()
 	move = kai_minimax_make_move(&game_state);
 	fprintf(stdout, "Selected move: %d\n", move);
 	//assert_eq(move, 1);
-}
\ No newline at end of file
+}
+
+void test_search_worker()
+{
+	int move;
+	struct kai_game_state_t game_state;
+	struct kai_search_worker_t worker;
+
+	game_state.player_id = 1;
+	game_state.player_first_ambo = 0;
+	game_state.player_end_ambo = 5;
+	game_state.player_house_ambo = 6;
+	game_state.opponent_first_ambo = 7;
+	game_state.opponent_end_ambo = 12;
+	game_state.opponent_house_ambo = 13;
+	kai_parse_board_state(&game_state.board_state, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+
+	assert_eq(kai_search_worker_start(&worker), 0);
+
+	// The search would run forever without being stopped, so it should still be running after a short wait.
+	kai_search_worker_post(&worker, &game_state);
+	assert_eq(kai_search_worker_wait(&worker, 0.2), 0);
+
+	// Stopping should give us a valid move at once, and the worker should then finish.
+	move = kai_search_worker_stop(&worker);
+	assert_eq(move >= 1 && move <= 6, 1);
+	assert_eq(kai_search_worker_wait(&worker, KAI_WAIT_INFINITE), 1);
+
+	kai_search_worker_shutdown(&worker);
+}
+
+void test_engine()
+{
+	int move;
+	int i;
+	struct kai_engine_t* engine;
+	struct test_engine_job_t jobs[4];
+	struct kai_thread_t threads[4];
+	struct kai_engine_limits_t limits;
+	struct kai_search_info_t result;
+	struct kai_search_info_t expected;
+
+	engine = kai_engine_create();
+	assert_eq(engine != NULL, 1);
+
+	// A depth limited search should stop at exactly that depth.
+	limits.depth = 10;
+	limits.nodes = 0;
+	limits.time = 0.0;
+	move = kai_engine_search(engine, &limits, NULL, &expected);
+	assert_eq(move, expected.best_move);
+	assert_eq(expected.depth, 10);
+	assert_eq(expected.completed, 1);
+
+	// A node limited search should not search (much) more than the limit.
+	limits.depth = 0;
+	limits.nodes = 100000;
+	move = kai_engine_search(engine, &limits, NULL, &result);
+	assert_eq(move >= 1 && move <= 6, 1);
+	assert_eq(result.nodes <= limits.nodes + 1, 1);
+
+	// A stop before a search without limits stops that search, and only that one.
+	limits.nodes = 0;
+	kai_engine_stop(engine);
+	move = kai_engine_search(engine, &limits, NULL, &result);
+	assert_eq(move >= 1 && move <= 6, 1);
+	assert_eq(result.completed, 0);
+	limits.depth = 10;
+	kai_engine_search(engine, &limits, NULL, &result);
+	assert_eq(result.completed, 1);
+
+	kai_engine_destroy(engine);
+
+	// Engines searching concurrently should not affect each other.
+	for (i = 0; i < 4; ++i)
+	{
+		jobs[i].engine = kai_engine_create();
+		jobs[i].limits.depth = 10;
+		jobs[i].limits.nodes = 0;
+		jobs[i].limits.time = 0.0;
+		kai_thread_create(&threads[i], test_engine_thread, &jobs[i]);
+	}
+
+	for (i = 0; i < 4; ++i)
+	{
+		kai_thread_join(&threads[i]);
+		kai_engine_destroy(jobs[i].engine);
+
+		assert_eq(jobs[i].result.best_move, expected.best_move);
+		assert_eq(jobs[i].result.nodes, expected.nodes);
+	}
+}
+
+void test_engine_thread(void* argument)
+{
+	struct test_engine_job_t* job = (struct test_engine_job_t*) argument;
+
+	kai_engine_search(job->engine, &job->limits, NULL, &job->result);
+}
+
+void test_multi_pv()
+{
+	int i;
+	struct kai_engine_t* engine;
+	struct kai_engine_limits_t limits;
+	struct kai_search_info_t single;
+	struct kai_search_info_t result;
+	struct kai_game_state_t game_state;
+	struct kai_search_t search;
+	struct kai_minimax_node_t node;
+	kai_evaluation_t score;
+
+	engine = kai_engine_create();
+	kai_engine_set_position_string(engine, "7;5;0;7;7;1;8;4;7;1;0;9;8;8;1");
+	limits.depth = 8;
+	limits.nodes = 0;
+	limits.time = 0.0;
+
+	kai_engine_search(engine, &limits, NULL, &single);
+	kai_engine_set_multi_pv(engine, KAI_AMBO_COUNT);
+	kai_engine_search(engine, &limits, NULL, &result);
+
+	// Every non-empty ambo should be listed, best first, and the best line should agree with a normal search.
+	assert_eq(result.line_count, 5);
+	assert_eq(result.lines[0].score, single.score);
+	assert_eq(result.lines[0].pv[0], result.lines[0].move);
+	for (i = 1; i < result.line_count; ++i)
+		assert_eq(result.lines[i - 1].score >= result.lines[i].score, 1);
+
+	// Each score should be exact, i.e. the same as a full window search of the move.
+	kai_game_state_init(&game_state, 1);
+	kai_parse_board_state(&game_state.board_state, "7;5;0;7;7;1;8;4;7;1;0;9;8;8;1");
+	for (i = 0; i < result.line_count; ++i)
+	{
+		kai_search_init(&search);
+		search.iteration_depth = limits.depth;
+		memcpy(&node.state, &game_state.board_state, sizeof(node.state));
+		kai_play_move(&node.state, (kai_ambo_index_t) (result.lines[i].move - 1));
+		node.alpha = KAI_EVALUATION_MIN;
+		node.beta = KAI_EVALUATION_MAX;
+		node.node_count = 0;
+		search.node_budget = LLONG_MAX;
+		score = kai_minimax_expand_node(&game_state, &node, &game_state.board_state, limits.depth - 1, &search);
+		assert_eq(score, result.lines[i].score);
+	}
+
+	kai_engine_destroy(engine);
+}
+
+void test_arena()
+{
+	size_t i;
+	int zeroed = 1;
+	unsigned char* a;
+	unsigned char* b;
+	struct kai_arena_t arena;
+
+	assert_eq(kai_arena_create(&arena, 8 * 1024 * 1024, 4), 0);
+	assert_eq(arena.size >= 8 * 1024 * 1024, 1);
+	assert_eq(arena.page_size >= 4096, 1);
+	fprintf(stdout, "Arena page size: %lu\n", (unsigned long) arena.page_size);
+
+	for (i = 0; i < arena.size; ++i)
+		zeroed = zeroed && arena.memory[i] == 0;
+	assert_eq(zeroed, 1);
+
+	// Allocations should be aligned and should not overlap.
+	a = (unsigned char*) kai_arena_allocate(&arena, 100, 64);
+	b = (unsigned char*) kai_arena_allocate(&arena, 100, 64);
+	assert_eq(a != NULL && b != NULL, 1);
+	assert_eq(((size_t) a) % 64, 0);
+	assert_eq(((size_t) b) % 64, 0);
+	assert_eq(b >= a + 100, 1);
+
+	// The arena should refuse allocations larger than what is left.
+	assert_eq(kai_arena_allocate(&arena, arena.size, 1) == NULL, 1);
+
+	kai_arena_destroy(&arena);
+}
+
+void test_record()
+{
+	const char* path = "kalahai_test_record.bin";
+	int i;
+	const struct kai_record_game_t* game;
+	const struct kai_record_ply_t* plies;
+	struct kai_board_state_t board_state;
+	struct kai_search_info_t search_info;
+	struct kai_record_writer_t* writer;
+	struct kai_record_reader_t reader;
+	struct kai_thread_t threads[8];
+
+	remove(path);
+	writer = (struct kai_record_writer_t*) malloc(sizeof(*writer));
+	assert_eq(kai_record_writer_open(writer, path), 0);
+
+	// Record two games: one of three plies and one of a single ply.
+	kai_parse_board_state(&board_state, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+	memset(&search_info, 0, sizeof(search_info));
+	kai_record_writer_begin_game(writer, 1);
+	for (i = 0; i < 3; ++i)
+	{
+		search_info.depth = 10 + i;
+		search_info.score = (kai_evaluation_t) (-5 * i);
+		search_info.nodes = 1000 * i;
+		kai_record_writer_add_ply(writer, &board_state, i + 1, &search_info);
+		kai_play_move(&board_state, (kai_ambo_index_t) (board_state.player == 1 ? i : i + 7));
+	}
+	assert_eq(kai_record_writer_end_game(writer, 2), 0);
+
+	kai_record_writer_begin_game(writer, 2);
+	kai_record_writer_add_ply(writer, &board_state, 4, NULL);
+	assert_eq(kai_record_writer_end_game(writer, 0), 0);
+
+	// A game that never ends should not be written.
+	kai_record_writer_begin_game(writer, 1);
+	kai_record_writer_add_ply(writer, &board_state, 1, NULL);
+	kai_record_writer_close(writer);
+	free(writer);
+
+	assert_eq(kai_record_reader_open(&reader, path), 0);
+	assert_eq(reader.game_count, 2);
+	assert_eq(reader.ply_count, 4);
+
+	game = kai_record_reader_game(&reader, 0, &plies);
+	assert_eq(game->ply_count, 3);
+	assert_eq(game->winner, 2);
+	assert_eq(game->player_id, 1);
+	assert_eq(plies[2].move, 3);
+	assert_eq(plies[2].depth, 12);
+	assert_eq(plies[2].score, -10);
+	assert_eq(plies[2].nodes, 2000);
+	assert_eq(plies[0].seeds[0], 6);
+
+	game = kai_record_reader_game(&reader, 1, &plies);
+	assert_eq(game->ply_count, 1);
+	assert_eq(game->winner, 0);
+	kai_record_ply_board(&plies[0], &board_state);
+	assert_eq(plies[0].move, 4);
+	assert_eq(plies[0].depth, 0);
+
+	kai_record_reader_close(&reader);
+	remove(path);
+
+	// Processes creating the same file at once write a single header between them.
+	for (i = 0; i < 8; ++i)
+		assert_eq(kai_thread_create(&threads[i], test_record_thread, (void*) path), 0);
+	for (i = 0; i < 8; ++i)
+		kai_thread_join(&threads[i]);
+	assert_eq(kai_record_reader_open(&reader, path), 0);
+	assert_eq(reader.game_count, 8);
+	assert_eq(reader.ply_count, 8);
+	kai_record_reader_close(&reader);
+	remove(path);
+}
+
+void test_record_thread(void* argument)
+{
+	struct kai_record_writer_t* writer;
+	struct kai_board_state_t board_state;
+
+	writer = (struct kai_record_writer_t*) malloc(sizeof(*writer));
+	if (kai_record_writer_open(writer, (const char*) argument) == 0)
+	{
+		kai_parse_board_state(&board_state, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+		kai_record_writer_begin_game(writer, 1);
+		kai_record_writer_add_ply(writer, &board_state, 1, NULL);
+		kai_record_writer_end_game(writer, 1);
+		kai_record_writer_close(writer);
+	}
+	free(writer);
+}
+void test_table()
+{
+	const char* name = "kalahai_test_table";
+	uint64_t key[2];
+	uint64_t other_key[2];
+	long long probes;
+	long long hits;
+	int move;
+	int i;
+	struct kai_board_state_t board_state;
+	struct kai_table_value_t value;
+	struct kai_table_t table;
+	struct kai_engine_t* engine;
+	struct kai_engine_t* other_engine;
+	struct kai_engine_limits_t limits;
+	struct kai_search_info_t cold;
+	struct kai_search_info_t warm;
+	void* memory;
+
+	// A stored value should be found again, but not for another perspective.
+	memory = calloc(1, 64 * 1024);
+	assert_eq(kai_table_create(&table, memory, 64 * 1024), 0);
+	kai_parse_board_state(&board_state, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+	kai_table_key(&board_state, 1, key);
+	kai_table_key(&board_state, 2, other_key);
+	assert_eq(kai_table_probe(&table, key, &value), 0);
+
+	value.score = -123;
+	value.depth = 9;
+	value.bound = KAI_TABLE_BOUND_LOWER;
+	value.move = 4;
+	kai_table_store(&table, key, &value);
+	memset(&value, 0, sizeof(value));
+	assert_eq(kai_table_probe(&table, key, &value), 1);
+	assert_eq(value.score, -123);
+	assert_eq(value.depth, 9);
+	assert_eq(value.bound, KAI_TABLE_BOUND_LOWER);
+	assert_eq(value.move, 4);
+	assert_eq(kai_table_probe(&table, other_key, &value), 0);
+	free(memory);
+
+	limits.depth = 12;
+	limits.nodes = 0;
+	limits.time = 0.0;
+
+	// The table should cut down the tree of a search on its own.
+	engine = kai_engine_create();
+	kai_engine_search(engine, &limits, NULL, &cold);
+	assert_eq(kai_engine_reserve_memory(engine, 4 * 1024 * 1024), 0);
+	assert_eq(kai_engine_create_table(engine, 4 * 1024 * 1024), 0);
+	move = kai_engine_search(engine, &limits, NULL, &warm);
+	assert_eq(move >= 1 && move <= 6, 1);
+	assert_eq(warm.nodes < cold.nodes, 1);
+
+	// A table created again reuses the memory of the first one, cleared, and cannot outgrow it.
+	for (i = 0; i < 8; ++i)
+		assert_eq(kai_engine_create_table(engine, 4 * 1024 * 1024), 0);
+	kai_engine_search(engine, &limits, NULL, &cold);
+	assert_eq(cold.nodes, warm.nodes);
+	assert_eq(kai_engine_create_table(engine, 1024 * 1024), 0);
+	assert_eq(kai_engine_create_table(engine, 8 * 1024 * 1024), 1);
+	kai_engine_destroy(engine);
+
+	// An engine attached to a shared table should find the results of another engine.
+	kai_shared_memory_unlink(name);
+	engine = kai_engine_create();
+	other_engine = kai_engine_create();
+	assert_eq(kai_engine_attach_shared_table(engine, name, 4 * 1024 * 1024), 0);
+	assert_eq(kai_engine_attach_shared_table(other_engine, name, 4 * 1024 * 1024), 0);
+
+	kai_engine_search(engine, &limits, NULL, &cold);
+	kai_engine_search(other_engine, &limits, NULL, &warm);
+	assert_eq(warm.nodes < cold.nodes, 1);
+	assert_eq(warm.score, cold.score);
+
+	kai_engine_table_counts(other_engine, &probes, &hits);
+	assert_eq(probes > 0, 1);
+	assert_eq(hits > 0, 1);
+
+	kai_engine_destroy(engine);
+	kai_engine_destroy(other_engine);
+	kai_shared_memory_unlink(name);
+}
+
+void test_parameters()
+{
+	const char* path = "kalahai_test_parameters.txt";
+	FILE* file;
+	struct kai_parameters_t defaults;
+	struct kai_parameters_t parameters;
+	struct kai_engine_t* engine;
+	struct kai_engine_limits_t limits;
+	struct kai_search_info_t result;
+
+	// The defaults should be the constants in kalahai.h.
+	kai_parameters_init(&defaults);
+	assert_eq(defaults.house_seed_weight, KAI_MINIMAX_EVALUATION_HOUSE_SEED_WEIGHT);
+	assert_eq(defaults.start_depth, KAI_MINIMAX_START_DEPTH);
+
+	// Saved parameters should load back the same, and a file may set only some of them.
+	parameters = defaults;
+	parameters.house_seed_weight = 7;
+	parameters.extra_turn_term = 0;
+	assert_eq(kai_parameters_save(&parameters, path), 0);
+	kai_parameters_init(&parameters);
+	assert_eq(kai_parameters_load(&parameters, path), 0);
+	assert_eq(parameters.house_seed_weight, 7);
+	assert_eq(parameters.extra_turn_term, 0);
+	assert_eq(parameters.depth_step, defaults.depth_step);
+
+	file = fopen(path, "w");
+	fprintf(file, "# Only the start depth.\nstart_depth 3\n");
+	fclose(file);
+	assert_eq(kai_parameters_load(&parameters, path), 0);
+	assert_eq(parameters.start_depth, 3);
+	assert_eq(parameters.house_seed_weight, 7);
+
+	// Unknown names and values out of range should be refused.
+	file = fopen(path, "w");
+	fprintf(file, "no_such_parameter 1\n");
+	fclose(file);
+	assert_eq(kai_parameters_load(&parameters, path), 1);
+	file = fopen(path, "w");
+	fprintf(file, "start_depth 0\n");
+	fclose(file);
+	assert_eq(kai_parameters_load(&parameters, path), 1);
+	remove(path);
+
+	// The first iteration should go to the start depth of the parameters.
+	engine = kai_engine_create();
+	limits.depth = 0;
+	limits.nodes = 1000;
+	limits.time = 0.0;
+	parameters.start_depth = 2;
+	kai_engine_set_parameters(engine, &parameters);
+	kai_engine_search(engine, &limits, NULL, &result);
+	assert_eq(result.depth >= 2, 1);
+	assert_eq(result.best_move >= 1 && result.best_move <= 6, 1);
+	kai_engine_destroy(engine);
+}
+
+void test_server()
+{
+	int i;
+	char reply[KAI_COMMAND_MAX_SIZE];
+	struct kai_server_game_t game;
+	struct kai_trace_histogram_t latency;
+
+	kai_server_game_init(&game);
+	kai_server_execute(&game, 1, "HELLO", reply);
+	assert_eq(strcmp(reply, "HELLO 1\n"), 0);
+	assert_eq(kai_server_execute(&game, 1, "BOARD", reply), KAI_SERVER_COMMAND_BOARD);
+	assert_eq(strcmp(reply, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1\n"), 0);
+
+	// Nothing but the board can be asked for before the second player has joined.
+	kai_server_execute(&game, 1, "PLAYER", reply);
+	assert_eq(strcmp(reply, KAI_ERROR_GAME_NOT_FULL "\n"), 0);
+	kai_server_execute(&game, 1, "MOVE 1 1", reply);
+	assert_eq(strcmp(reply, KAI_ERROR_GAME_NOT_FULL "\n"), 0);
+
+	game.player_count = 2;
+	kai_server_execute(&game, 1, "MOVE 1", reply);
+	assert_eq(strcmp(reply, KAI_ERROR_INVALID_PARAMS "\n"), 0);
+	kai_server_execute(&game, 1, "MOVE 1 x", reply);
+	assert_eq(strcmp(reply, KAI_ERROR_INVALID_PARAMS "\n"), 0);
+	kai_server_execute(&game, 1, "MOVE 7 1", reply);
+	assert_eq(strcmp(reply, KAI_ERROR_INVALID_MOVE "\n"), 0);
+	kai_server_execute(&game, 2, "MOVE 1 2", reply);
+	assert_eq(strcmp(reply, KAI_ERROR_WRONG_PLAYER "\n"), 0);
+	assert_eq(kai_server_execute(&game, 1, "SOW", reply), KAI_SERVER_COMMAND_UNKNOWN);
+	assert_eq(strcmp(reply, KAI_ERROR_CMD_NOT_FOUND "\n"), 0);
+
+	// The first ambo ends in the house, so player 1 moves again and finds it empty.
+	kai_server_execute(&game, 1, "MOVE 1 1", reply);
+	assert_eq(strcmp(reply, "0;0;7;7;7;7;7;1;6;6;6;6;6;6;1\n"), 0);
+	kai_server_execute(&game, 1, "MOVE 1 1", reply);
+	assert_eq(strcmp(reply, KAI_ERROR_AMBO_EMPTY "\n"), 0);
+	kai_server_execute(&game, 2, "WINNER", reply);
+	assert_eq(strcmp(reply, "-1\n"), 0);
+
+	// A house with more than half the seeds decides the game.
+	kai_parse_board_state(&game.board_state, "0;0;0;0;0;0;1;36;1;1;1;1;1;30;1");
+	kai_server_execute(&game, 1, "MOVE 6 1", reply);
+	kai_server_execute(&game, 2, "WINNER", reply);
+	assert_eq(strcmp(reply, "1\n"), 0);
+
+	kai_server_execute(&game, 2, "NEW", reply);
+	assert_eq(strcmp(reply, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1\n"), 0);
+
+	// Command latencies of a few microseconds are told apart to within 1/32.
+	memset(&latency, 0, sizeof(latency));
+	for (i = 0; i < 99; ++i)
+		kai_trace_histogram_add(&latency, 3000);
+	kai_trace_histogram_add(&latency, 1000000);
+	assert_eq(latency.count, 100);
+	assert_eq(kai_trace_histogram_percentile(&latency, 50.0) >= 3000, 1);
+	assert_eq(kai_trace_histogram_percentile(&latency, 50.0) <= 3000 + 3000 / 32, 1);
+	assert_eq(kai_trace_histogram_percentile(&latency, 100.0), 1000000);
+}
+
+void test_trace()
+{
+	int i;
+	uint64_t p;
+	struct kai_trace_t trace;
+
+	kai_trace_init(&trace);
+	assert_eq(kai_trace_histogram_percentile(&trace.spans[KAI_TRACE_TURN], 99.0), 0);
+
+	// Small values have a bucket each.
+	for (i = 1; i <= 10; ++i)
+		kai_trace_histogram_add(&trace.spans[KAI_TRACE_PARSE], (uint64_t) i);
+	assert_eq(kai_trace_histogram_percentile(&trace.spans[KAI_TRACE_PARSE], 50.0), 5);
+	assert_eq(kai_trace_histogram_percentile(&trace.spans[KAI_TRACE_PARSE], 90.0), 9);
+	assert_eq(kai_trace_histogram_percentile(&trace.spans[KAI_TRACE_PARSE], 100.0), 10);
+
+	// Larger values are at most 1/32 off, and never above the maximum.
+	for (i = 1; i <= 1000; ++i)
+		kai_trace_record(&trace, KAI_TRACE_TURN, i / 1000000.0);
+	assert_eq(trace.spans[KAI_TRACE_TURN].count, 1000);
+	p = kai_trace_histogram_percentile(&trace.spans[KAI_TRACE_TURN], 50.0);
+	assert_eq(p >= 499000 && p <= 500000 + 500000 / 32, 1);
+	p = kai_trace_histogram_percentile(&trace.spans[KAI_TRACE_TURN], 99.0);
+	assert_eq(p >= 989000 && p <= 990000 + 990000 / 32, 1);
+	assert_eq(kai_trace_histogram_percentile(&trace.spans[KAI_TRACE_TURN], 100.0), trace.spans[KAI_TRACE_TURN].maximum);
+
+	// Values beyond the range end up in the last bucket.
+	kai_trace_histogram_add(&trace.spans[KAI_TRACE_SEND], (uint64_t) 1 << 50);
+	assert_eq(kai_trace_histogram_percentile(&trace.spans[KAI_TRACE_SEND], 50.0), ((uint64_t) 1 << KAI_TRACE_MAX_BITS) - 1);
+
+	// Tracing without a trace does nothing.
+	kai_trace_record(NULL, KAI_TRACE_TURN, 1.0);
+	kai_trace_poll(NULL, stdout);
+}
+
+void test_counters()
+{
+	int c;
+	int available;
+	struct kai_counters_t counters;
+	struct kai_engine_t* engine;
+	struct kai_engine_limits_t limits;
+	struct kai_search_info_t result;
+
+	available = kai_counters_open(&counters) == 0;
+	kai_counters_close(&counters);
+
+	engine = kai_engine_create();
+	kai_engine_count_events(engine, 1);
+	limits.depth = 10;
+	limits.nodes = 0;
+	limits.time = 0.0;
+	kai_engine_search(engine, &limits, NULL, &result);
+
+	// Counting does not change the search.
+	assert_eq(result.nodes, 229303);
+
+	if (available)
+	{
+		for (c = 0; c < KAI_COUNTER_COUNT && result.counters[c] < 0; ++c);
+		assert_eq(c < KAI_COUNTER_COUNT, 1);
+		if (result.counters[KAI_COUNTER_INSTRUCTIONS] >= 0)
+		{
+			assert_eq(result.counters[KAI_COUNTER_INSTRUCTIONS] > result.nodes, 1);
+		}
+	}
+	else
+	{
+		for (c = 0; c < KAI_COUNTER_COUNT; ++c)
+			assert_eq(result.counters[c], -1);
+	}
+
+	// Without asking for them, nothing is counted.
+	kai_engine_count_events(engine, 0);
+	kai_engine_search(engine, &limits, NULL, &result);
+	for (c = 0; c < KAI_COUNTER_COUNT; ++c)
+		assert_eq(result.counters[c], -1);
+
+	kai_engine_destroy(engine);
+}
+
+void test_solver()
+{
+	int distance;
+	int move;
+	size_t size = 1024 * 1024;
+	void* memory;
+	struct kai_board_state_t board_state;
+	struct kai_solver_t solver;
+	struct kai_engine_t* engine;
+	struct kai_engine_limits_t limits;
+	struct kai_search_info_t result;
+
+	memory = malloc(size);
+	assert_eq(kai_solver_create(&solver, memory, size), 0);
+
+	// Both moves win: ambo 1 captures into 37 seeds at once, ambo 6 only gets an extra turn first.
+	kai_parse_board_state(&board_state, "29;1;0;0;0;0;1;35;1;1;1;1;1;1;1");
+	assert_eq(kai_solver_solve(&solver, &board_state, 1, NULL), KAI_SOLVER_WIN);
+	assert_eq(kai_solver_lookup(&solver, &board_state, 1, &distance, &move), KAI_SOLVER_WIN);
+	assert_eq(distance, 1);
+	assert_eq(move, 1);
+	assert_eq(kai_solver_solve(&solver, &board_state, 2, NULL), KAI_SOLVER_NO_WIN);
+
+	// Every move empties the south, which gives the north the rest of the seeds.
+	kai_parse_board_state(&board_state, "36;0;0;0;0;1;0;30;0;0;0;0;0;5;1");
+	assert_eq(kai_solver_solve(&solver, &board_state, 1, NULL), KAI_SOLVER_NO_WIN);
+	assert_eq(kai_solver_solve(&solver, &board_state, 2, NULL), KAI_SOLVER_WIN);
+
+	// A solve that runs out of nodes decides nothing.
+	assert_eq(kai_solver_create(&solver, memory, size), 0);
+	solver.node_limit = 1;
+	kai_parse_board_state(&board_state, "23;2;3;1;0;4;2;28;3;0;2;1;0;3;1");
+	assert_eq(kai_solver_solve(&solver, &board_state, 1, NULL), KAI_SOLVER_UNKNOWN);
+	assert_eq(solver.aborted, 1);
+
+	free(memory);
+
+	// A search with a solver proves the win and takes the fastest one.
+	engine = kai_engine_create();
+	assert_eq(kai_engine_reserve_memory(engine, 4 * 1024 * 1024), 0);
+	assert_eq(kai_engine_create_solver(engine, 1024 * 1024), 0);
+	limits.depth = 0;
+	limits.nodes = 0;
+	limits.time = 0.0;
+	kai_engine_set_position_string(engine, "29;1;0;0;0;0;1;35;1;1;1;1;1;1;1");
+	assert_eq(kai_engine_search(engine, &limits, NULL, &result), 1);
+	assert_eq(result.score, KAI_EVALUATION_MAX);
+	assert_eq(result.depth, 1);
+
+	kai_engine_set_position_string(engine, "36;0;0;0;0;1;0;30;0;0;0;0;0;5;1");
+	assert_eq(kai_engine_search(engine, &limits, NULL, &result), 5);
+	assert_eq(result.score, KAI_EVALUATION_MIN);
+
+	// A node limit bounds the solver as well, and leaves the search enough to complete an iteration.
+	limits.nodes = 5000;
+	kai_engine_set_position_string(engine, "28;2;3;4;5;2;2;20;1;1;1;1;1;2;1");
+	kai_engine_search(engine, &limits, NULL, &result);
+	assert_eq(result.nodes <= limits.nodes + 1, 1);
+	assert_eq(result.best_move != -1, 1);
+	kai_engine_destroy(engine);
+}
+
+/**
+	Keep the depth of the first iteration of a search.
+*/
+static void test_reuse_iteration(const struct kai_search_info_t* info, void* user_data)
+{
+	int* first_depth = (int*) user_data;
+
+	if (*first_depth == 0)
+		*first_depth = info->depth;
+}
+
+void test_reuse()
+{
+	int ply;
+	int first_depth;
+	struct kai_board_state_t board_state;
+	struct kai_engine_t* engine;
+	struct kai_engine_limits_t limits;
+	struct kai_engine_callbacks_t callbacks;
+	struct kai_search_info_t result;
+	kai_ambo_index_t pv[KAI_MINIMAX_MAX_PLY];
+
+	engine = kai_engine_create();
+	assert_eq(kai_engine_reserve_memory(engine, 4 * 1024 * 1024), 0);
+	kai_engine_reuse_tree(engine, 1);
+	limits.depth = 10;
+	limits.nodes = 0;
+	limits.time = 0.0;
+	kai_engine_search(engine, &limits, NULL, &result);
+
+	// Reusing the tree does not change the first search.
+	assert_eq(result.nodes, 229303);
+	assert_eq(result.line_count, 1);
+	assert_eq(kai_engine_create_table(engine, 1024 * 1024), 0);
+
+	// Follow the principal variation until player 1 is to move again.
+	memcpy(pv, result.lines[0].pv, sizeof(pv));
+	kai_parse_board_state(&board_state, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+	for (ply = 0; ply == 0 || board_state.player != 1; ++ply)
+		kai_play_move(&board_state, (kai_ambo_index_t) ((board_state.player == 1 ? KAI_SOUTH_START : KAI_NORTH_START) + pv[ply] - 1));
+
+	// What is left of the variation is deep enough, so the reply comes without searching.
+	kai_engine_set_position(engine, &board_state);
+	limits.depth = 10 - ply;
+	assert_eq(kai_engine_search(engine, &limits, NULL, &result), pv[ply]);
+	assert_eq(result.nodes, 0);
+	assert_eq(result.depth, 10 - ply);
+	assert_eq(result.completed, 1);
+
+	// Searching deeper starts where the previous search stopped.
+	first_depth = 0;
+	callbacks.iteration = test_reuse_iteration;
+	callbacks.user_data = &first_depth;
+	limits.depth = 12 - ply;
+	kai_engine_search(engine, &limits, &callbacks, &result);
+	assert_eq(first_depth, 10 - ply);
+	assert_eq(result.depth, 12 - ply);
+
+	// A position off the variation is searched from the start.
+	first_depth = 0;
+	kai_engine_set_position_string(engine, "0;5;5;5;5;5;5;6;7;7;7;7;7;7;1");
+	kai_engine_search(engine, &limits, &callbacks, &result);
+	assert_eq(first_depth, KAI_MINIMAX_START_DEPTH);
+
+	kai_engine_destroy(engine);
+}
+
+/**
+	Count the positions depth plies from a board (perft), making every move with both kai_play_move() and
+	kai_sow_move(). mismatches counts the moves where the two disagree.
+*/
+static long long test_sow_perft(const struct kai_board_state_t* board_state, int depth, long long* mismatches)
+{
+	int i;
+	long long count = 0;
+	kai_ambo_index_t first_ambo = board_state->player == 1 ? KAI_SOUTH_START : KAI_NORTH_START;
+	struct kai_board_state_t played;
+	struct kai_board_state_t sown;
+
+	if (depth == 0 || kai_is_game_over(board_state))
+		return 1;
+
+	for (i = 0; i < KAI_AMBO_COUNT; ++i)
+	{
+		if (board_state->seeds[first_ambo + i] == 0)
+			continue;
+
+		memcpy(&played, board_state, sizeof(played));
+		memcpy(&sown, board_state, sizeof(sown));
+		kai_play_move(&played, (kai_ambo_index_t) (first_ambo + i));
+		kai_sow_move(&sown, (kai_ambo_index_t) (first_ambo + i));
+		if (memcmp(played.seeds, sown.seeds, sizeof(played.seeds)) != 0 || played.player != sown.player)
+			++*mismatches;
+
+		count += test_sow_perft(&played, depth - 1, mismatches);
+	}
+
+	return count;
+}
+
+void test_sow()
+{
+	int player;
+	int ambo;
+	int seeds;
+	int pit;
+	int total;
+	int first_ambo;
+	long long mismatches = 0;
+	const struct kai_sow_t* sow;
+	struct kai_board_state_t board_state;
+	struct kai_board_state_t played;
+	struct kai_board_state_t sown;
+
+	// Every entry sows all of its seeds, and never into the ambo sown from or the house of the opponent.
+	for (player = 1; player <= 2; ++player)
+	{
+		first_ambo = player == 1 ? KAI_SOUTH_START : KAI_NORTH_START;
+		for (ambo = 0; ambo < KAI_AMBO_COUNT; ++ambo)
+		{
+			for (seeds = 0; seeds <= KAI_SEED_TOTAL; ++seeds)
+			{
+				sow = kai_sow_lookup((kai_player_id_t) player, ambo, seeds);
+				total = 0;
+				for (pit = 0; pit < 14; ++pit)
+					total += sow->increments[pit];
+
+				if (total != seeds || sow->increments[first_ambo + ambo] != 0 || sow->increments[player == 1 ? KAI_NORTH_HOUSE : KAI_SOUTH_HOUSE] != 0)
+					++mismatches;
+			}
+		}
+	}
+	assert_eq(mismatches, 0);
+
+	// Perft from the start position.
+	kai_parse_board_state(&board_state, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+	assert_eq(test_sow_perft(&board_state, 8, &mismatches), 961846);
+	assert_eq(mismatches, 0);
+
+	// Perft from positions with laps around the board, captures and sides running out of seeds.
+	kai_parse_board_state(&board_state, "0;20;1;0;0;13;2;0;25;0;1;0;0;10;2");
+	test_sow_perft(&board_state, 6, &mismatches);
+	assert_eq(mismatches, 0);
+	kai_parse_board_state(&board_state, "23;2;3;1;0;4;2;28;3;0;2;1;0;3;1");
+	test_sow_perft(&board_state, 8, &mismatches);
+	assert_eq(mismatches, 0);
+
+	// All the seeds of the board in one ambo, for either player.
+	for (player = 1; player <= 2; ++player)
+	{
+		first_ambo = player == 1 ? KAI_SOUTH_START : KAI_NORTH_START;
+		for (ambo = 0; ambo < KAI_AMBO_COUNT; ++ambo)
+		{
+			memset(&board_state, 0, sizeof(board_state));
+			board_state.player = (kai_player_id_t) player;
+			board_state.seeds[first_ambo + ambo] = KAI_SEED_TOTAL;
+			memcpy(&played, &board_state, sizeof(played));
+			memcpy(&sown, &board_state, sizeof(sown));
+			kai_play_move(&played, (kai_ambo_index_t) (first_ambo + ambo));
+			kai_sow_move(&sown, (kai_ambo_index_t) (first_ambo + ambo));
+			if (memcmp(played.seeds, sown.seeds, sizeof(played.seeds)) != 0 || played.player != sown.player)
+				++mismatches;
+		}
+	}
+	assert_eq(mismatches, 0);
+}
+
+void test_tree()
+{
+	size_t index;
+	long search;
+	long long nodes;
+	long long first_nodes;
+	const char* paths[3] = { "kalahai_test_tree_1.bin", "kalahai_test_tree_2.bin", "kalahai_test_tree_3.bin" };
+	int i;
+	int moves[KAI_MINIMAX_MAX_PLY];
+	struct kai_tree_writer_t* writer;
+	struct kai_tree_reader_t readers[3];
+	struct kai_tree_iteration_t iteration;
+	struct kai_parameters_t parameters;
+	struct kai_engine_t* engine;
+	struct kai_engine_limits_t limits;
+	struct kai_search_info_t result;
+
+	// Record the same node-limited search twice, and once with other parameters.
+	writer = (struct kai_tree_writer_t*) malloc(sizeof(*writer));
+	limits.depth = 0;
+	limits.nodes = 100000;
+	limits.time = 0.0;
+	first_nodes = 0;
+	for (i = 0; i < 3; ++i)
+	{
+		engine = kai_engine_create();
+		if (i == 2)
+		{
+			kai_parameters_init(&parameters);
+			parameters.extra_turn_term = 0;
+			kai_engine_set_parameters(engine, &parameters);
+		}
+
+		assert_eq(kai_tree_writer_open(writer, paths[i]), 0);
+		kai_engine_record_tree(engine, writer);
+		kai_engine_search(engine, &limits, NULL, &result);
+		assert_eq(kai_tree_writer_close(writer), 0);
+		kai_engine_destroy(engine);
+
+		if (i == 0)
+			first_nodes = result.nodes;
+		assert_eq(kai_tree_reader_open(&readers[i], paths[i]), 0);
+	}
+	free(writer);
+
+	// The file holds one search, and its iterations add up to the nodes of the search.
+	assert_eq(readers[0].events[0].type, KAI_TREE_EVENT_SEARCH);
+	index = 0;
+	search = -1;
+	nodes = 0;
+	while (kai_tree_reader_iteration(&readers[0], index, &search, &iteration))
+	{
+		assert_eq(iteration.search, 0);
+		nodes += iteration.nodes;
+		index = iteration.last;
+	}
+	assert_eq(nodes, first_nodes);
+	assert_eq(iteration.completed, 0);
+
+	// A search limited by nodes is the same every time.
+	assert_eq(readers[1].event_count, readers[0].event_count);
+	assert_eq(kai_tree_diverge(&readers[0], &readers[1]), readers[0].event_count);
+
+	// Other parameters give another tree, which starts out the same.
+	index = kai_tree_diverge(&readers[0], &readers[2]);
+	assert_eq(index > 0 && index < readers[0].event_count, 1);
+	assert_eq(kai_tree_reader_path(&readers[0], index, moves) > 0, 1);
+
+	for (i = 0; i < 3; ++i)
+	{
+		kai_tree_reader_close(&readers[i]);
+		remove(paths[i]);
+	}
+}
+
+/**
+	Evaluate the children of every board depth plies from a board, together and one by one, for both players and
+	with the given parameters. mismatches counts the children where the two disagree.
+*/
+static void test_evaluate_batch_tree(const struct kai_board_state_t* board_state, int depth, const struct kai_parameters_t* parameters, long long* mismatches)
+{
+	int i;
+	int count = 0;
+	int player;
+	kai_ambo_index_t first_ambo = board_state->player == 1 ? KAI_SOUTH_START : KAI_NORTH_START;
+	kai_evaluation_t evaluations[KAI_AMBO_COUNT];
+	struct kai_board_state_t children[KAI_AMBO_COUNT];
+	struct kai_game_state_t game_state;
+
+	if (depth == 0 || kai_is_game_over(board_state))
+		return;
+
+	for (i = 0; i < KAI_AMBO_COUNT; ++i)
+	{
+		if (board_state->seeds[first_ambo + i] == 0)
+			continue;
+
+		memcpy(&children[count], board_state, sizeof(children[count]));
+		kai_play_move(&children[count], (kai_ambo_index_t) (first_ambo + i));
+		++count;
+	}
+
+	for (player = 1; player <= 2; ++player)
+	{
+		kai_game_state_init(&game_state, (kai_player_id_t) player);
+		kai_minimax_evaluate_batch(&game_state, parameters, children, count, board_state, evaluations);
+		for (i = 0; i < count; ++i)
+		{
+			if (evaluations[i] != kai_minimax_node_evaluation(&game_state, parameters, &children[i], board_state))
+				++*mismatches;
+		}
+
+		kai_minimax_evaluate_batch(&game_state, parameters, children, count, NULL, evaluations);
+		for (i = 0; i < count; ++i)
+		{
+			if (evaluations[i] != kai_minimax_node_evaluation(&game_state, parameters, &children[i], NULL))
+				++*mismatches;
+		}
+	}
+
+	for (i = 0; i < count; ++i)
+		test_evaluate_batch_tree(&children[i], depth - 1, parameters, mismatches);
+}
+
+void test_evaluate_batch()
+{
+	long long mismatches = 0;
+	struct kai_parameters_t parameters;
+	struct kai_board_state_t board_state;
+	struct kai_game_state_t game_state;
+	kai_evaluation_t evaluations[3];
+	struct kai_board_state_t boards[3];
+
+	// The default parameters, and a heavier house with a penalty for extra turns.
+	kai_parameters_init(&parameters);
+	kai_parse_board_state(&board_state, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+	test_evaluate_batch_tree(&board_state, 5, &parameters, &mismatches);
+	kai_parse_board_state(&board_state, "23;2;3;1;0;4;2;28;3;0;2;1;0;3;1");
+	test_evaluate_batch_tree(&board_state, 5, &parameters, &mismatches);
+	assert_eq(mismatches, 0);
+
+	parameters.house_seed_weight = 7;
+	parameters.extra_turn_term = -3;
+	kai_parse_board_state(&board_state, "0;20;1;0;0;13;2;0;25;0;1;0;0;10;2");
+	test_evaluate_batch_tree(&board_state, 5, &parameters, &mismatches);
+	assert_eq(mismatches, 0);
+
+	// Decided games, for and against player 1, and one that is not.
+	kai_parameters_init(&parameters);
+	kai_game_state_init(&game_state, 1);
+	kai_parse_board_state(&boards[0], "10;0;0;0;0;0;0;37;0;0;0;0;0;25;2");
+	kai_parse_board_state(&boards[1], "37;0;0;0;0;0;0;10;0;0;0;0;0;25;1");
+	kai_parse_board_state(&boards[2], "36;0;0;0;0;0;0;36;0;0;0;0;0;0;1");
+	kai_minimax_evaluate_batch(&game_state, &parameters, boards, 3, NULL, evaluations);
+	assert_eq(evaluations[0], KAI_EVALUATION_MAX);
+	assert_eq(evaluations[1], KAI_EVALUATION_MIN);
+	assert_eq(evaluations[2], 0);
+}
+
+void test_log()
+{
+	int i;
+	long long value;
+	long long next;
+	long dropped;
+	long total;
+	char line[KAI_COMMAND_MAX_SIZE];
+	char text[512];
+	const char* path = "kalahai_test_log.txt";
+	FILE* file;
+	struct kai_log_t log;
+	struct kai_log_ring_t* first;
+	struct kai_log_ring_t* second;
+	struct kai_board_state_t board_state;
+	struct kai_search_info_t info;
+
+	// Records from two rings come out in the order they were made, and records above the level are dropped.
+	file = fopen(path, "w");
+	assert_eq(kai_log_start(&log, file, KAI_LOG_INFO), 0);
+	first = kai_log_ring_create(&log);
+	second = kai_log_ring_create(&log);
+	assert_eq(first != NULL && second != NULL, 1);
+
+	memset(&info, 0, sizeof(info));
+	for (i = 0; i < KAI_COUNTER_COUNT; ++i)
+		info.counters[i] = -1;
+	info.depth = 5;
+	info.completed = 1;
+	info.nodes = 100;
+	info.time = 0.5;
+	info.best_move = 3;
+
+	kai_parse_board_state(&board_state, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+	kai_log_values(first, KAI_LOG_INFO, "First %lld %lld %lld.\n", 1, -2, 3000000000LL);
+	kai_log_board(second, KAI_LOG_INFO, "Board %s.\n", &board_state);
+	kai_log_text(first, KAI_LOG_DEBUG, "Not written.\n");
+	kai_log_text(second, KAI_LOG_ERROR, "Second.\n");
+	kai_log_iteration(first, KAI_LOG_INFO, &info);
+	kai_log_stop(&log);
+	fclose(file);
+
+	file = fopen(path, "r");
+	memset(text, 0, sizeof(text));
+	fread(text, 1, sizeof(text) - 1, file);
+	fclose(file);
+	assert_eq(strcmp(text, "First 1 -2 3000000000.\nBoard 0;6;6;6;6;6;6;0;6;6;6;6;6;6;1.\nSecond.\n"
+		"Searched 100 nodes total to depth 5 in 0.500000 seconds. Selected move 3.\n"), 0);
+
+	// A full ring drops records instead of waiting for the writer, and the writer reports how many.
+	file = fopen(path, "w");
+	assert_eq(kai_log_start(&log, file, KAI_LOG_DEBUG), 0);
+	first = kai_log_ring_create(&log);
+	for (i = 0; i < 4 * KAI_LOG_RING_RECORDS; ++i)
+		KAI_LOG_VALUES(first, KAI_LOG_DEBUG, "%lld\n", i, 0, 0);
+	kai_log_stop(&log);
+	fclose(file);
+
+	file = fopen(path, "r");
+	next = 0;
+	total = 0;
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		if (sscanf(line, "Dropped %ld", &dropped) == 1)
+			total += dropped;
+		else if (sscanf(line, "%lld", &value) == 1 && value >= next)
+		{
+			next = value + 1;
+			++total;
+		}
+	}
+	fclose(file);
+	remove(path);
+	assert_eq(total, 4 * KAI_LOG_RING_RECORDS);
+}
+
+void test_suite()
+{
+	const char* path = "kalahai_test_suite.txt";
+	FILE* file;
+	struct kai_suite_t* suite;
+	struct kai_suite_result_t result;
+	struct kai_engine_t* engine;
+	struct kai_engine_limits_t limits;
+
+	suite = (struct kai_suite_t*) malloc(sizeof(*suite));
+
+	// Comments and empty lines are skipped.
+	file = fopen(path, "w");
+	fprintf(file, "# Board Move Score\n\n31;2;2;4;2;1;0;25;1;1;1;1;1;0;1 3 32767 a comment\n23;1;1;0;2;1;0;24;0;6;0;3;2;9;1 2 32767\n");
+	fclose(file);
+	assert_eq(kai_suite_load(suite, path), 0);
+	assert_eq(suite->position_count, 2);
+	assert_eq(suite->positions[0].line, 3);
+	assert_eq(suite->positions[0].move, 3);
+	assert_eq(suite->positions[0].score, KAI_EVALUATION_MAX);
+	assert_eq(suite->positions[1].board_state.seeds[KAI_NORTH_HOUSE], 23);
+
+	// The search finds the winning move, keeps it and sees the win.
+	limits.depth = 0;
+	limits.nodes = 1000000;
+	limits.time = 0.0;
+	engine = kai_engine_create();
+	assert_eq(kai_suite_run(engine, &suite->positions[0], &limits, &result), 0);
+	assert_eq(result.solved, 1);
+	assert_eq(result.proved, 1);
+	assert_eq(result.nodes > 0 && result.nodes <= result.search.nodes, 1);
+	assert_eq(result.depth <= result.search.depth, 1);
+
+	// A wrong move is not solved.
+	suite->positions[0].move = 1;
+	assert_eq(kai_suite_run(engine, &suite->positions[0], &limits, &result), 0);
+	assert_eq(result.solved, 0);
+	kai_engine_destroy(engine);
+
+	// Moves out of range or of empty ambos, and broken boards, are not positions.
+	file = fopen(path, "w");
+	fprintf(file, "31;2;2;4;2;1;0;25;1;1;1;1;1;0;1 7 32767\n");
+	fclose(file);
+	assert_eq(kai_suite_load(suite, path), 1);
+	file = fopen(path, "w");
+	fprintf(file, "31;2;2;4;2;1;0;25;1;1;1;1;1;0;1 6 32767\n");
+	fclose(file);
+	assert_eq(kai_suite_load(suite, path), 1);
+	file = fopen(path, "w");
+	fprintf(file, "31;2;2;4;2;1;0;25;1;1;1;1;1 3 32767\n");
+	fclose(file);
+	assert_eq(kai_suite_load(suite, path), 1);
+
+	remove(path);
+	free(suite);
+}
+
+void test_negamax()
+{
+	long long probes;
+	long long hits;
+	struct kai_engine_t* engine;
+	struct kai_engine_limits_t limits;
+	struct kai_search_info_t cold;
+	struct kai_search_info_t first;
+	struct kai_search_info_t warm;
+
+	limits.depth = 12;
+	limits.nodes = 0;
+	limits.time = 0.0;
+
+	// The mirror on its own.
+	engine = kai_engine_create();
+	kai_engine_set_position_string(engine, "6;2;7;0;8;8;0;3;5;0;8;7;1;9;1");
+	kai_engine_search(engine, &limits, NULL, &cold);
+	kai_engine_destroy(engine);
+
+	// Searching the position with player 2 to move first should leave the mirror little to search.
+	engine = kai_engine_create();
+	assert_eq(kai_engine_reserve_memory(engine, 4 * 1024 * 1024), 0);
+	assert_eq(kai_engine_create_table(engine, 4 * 1024 * 1024), 0);
+	kai_engine_set_position_string(engine, "3;5;0;8;7;1;9;6;2;7;0;8;8;0;2");
+	kai_engine_search(engine, &limits, NULL, &first);
+	assert_eq(first.best_move, cold.best_move);
+	assert_eq(first.score, cold.score);
+
+	kai_engine_set_position_string(engine, "6;2;7;0;8;8;0;3;5;0;8;7;1;9;1");
+	kai_engine_search(engine, &limits, NULL, &warm);
+	assert_eq(warm.best_move, cold.best_move);
+	assert_eq(warm.score, cold.score);
+	assert_eq(warm.nodes * 2 < cold.nodes, 1);
+
+	kai_engine_table_counts(engine, &probes, &hits);
+	assert_eq(hits > 0, 1);
+	kai_engine_destroy(engine);
+}
+
+void test_sched()
+{
+	int i;
+	int j;
+	int distinct;
+	int pin_cpu;
+	struct kai_sched_t sched;
+	struct kai_thread_t thread;
+	const struct kai_cpu_topology_t* topology = &sched.topology;
+
+	// Unpinned, the threads are those of kai_cpu_count(), within the processors of the process.
+	kai_sched_init(&sched, 0, 0);
+	assert_eq(sched.thread_count, kai_cpu_count());
+	assert_eq(sched.thread_count >= 1 && sched.thread_count <= topology->cpu_count, 1);
+	assert_eq(topology->core_count >= 1 && topology->core_count <= topology->cpu_count, 1);
+	assert_eq(kai_sched_cpu(&sched, 0), -1);
+
+	// Pinned, every slot has a processor of its own, on distinct cores as long as there are any, and slots wrap around.
+	kai_sched_init(&sched, 1, 0);
+	assert_eq(sched.cpu_count, sched.thread_count);
+	distinct = 1;
+	for (i = 0; i < sched.cpu_count; ++i)
+	{
+		for (j = 0; j < i; ++j)
+			distinct &= sched.cpus[i] != sched.cpus[j];
+	}
+	assert_eq(distinct, 1);
+	assert_eq(kai_sched_cpu(&sched, sched.cpu_count), sched.cpus[0]);
+
+	// Avoiding SMT siblings, no two slots share a physical core.
+	kai_sched_init(&sched, 1, 1);
+	assert_eq(sched.thread_count <= topology->core_count, 1);
+	distinct = 1;
+	for (i = 0; i < sched.cpu_count; ++i)
+	{
+		for (j = 0; j < i; ++j)
+			distinct &= test_sched_core(&sched, sched.cpus[i]) != test_sched_core(&sched, sched.cpus[j]);
+	}
+	assert_eq(distinct, 1);
+
+#ifdef __linux__
+	// A thread can be pinned to the processor of a slot.
+	pin_cpu = kai_sched_cpu(&sched, 0);
+	assert_eq(kai_thread_create(&thread, test_sched_thread, &pin_cpu), 0);
+	kai_thread_join(&thread);
+	assert_eq(pin_cpu, 0);
+#else
+	(void) pin_cpu;
+	(void) thread;
+#endif
+}
+
+void test_sched_thread(void* argument)
+{
+	int* cpu = (int*) argument;
+
+	*cpu = kai_thread_pin(*cpu);
+}
+
+int test_sched_core(const struct kai_sched_t* sched, int cpu)
+{
+	int i;
+
+	for (i = 0; i < sched->topology.cpu_count && sched->topology.cpus[i] != cpu; ++i);
+	return i < sched->topology.cpu_count ? sched->topology.cores[i] : -1;
+}
+
+void test_patterns()
+{
+	unsigned int i;
+	unsigned int index;
+	long long mismatches = 0;
+	const char* path = "kalahai_test_patterns.bin";
+	const kai_ambo_t capped[KAI_AMBO_COUNT] = { 0, 3, 7, 8, 20, 1 };
+	kai_ambo_t ambos[KAI_AMBO_COUNT];
+	struct kai_pattern_entry_t* entries;
+	struct kai_patterns_t patterns;
+	struct kai_parameters_t parameters;
+	struct kai_parameters_t plain;
+	struct kai_board_state_t board_state;
+	struct kai_game_state_t game_state;
+	kai_evaluation_t evaluation;
+	FILE* file;
+
+	// Indices and ambos are each other's inverse, and ambos over the cap index as the cap.
+	for (i = 0; i < KAI_PATTERN_COUNT; ++i)
+	{
+		kai_pattern_ambos(i, ambos);
+		if (KAI_PATTERN_INDEX(ambos) != i)
+			++mismatches;
+	}
+	assert_eq(mismatches, 0);
+	kai_pattern_ambos(KAI_PATTERN_INDEX(capped), ambos);
+	assert_eq(ambos[2], KAI_PATTERN_SEED_CAP);
+	assert_eq(ambos[3], KAI_PATTERN_SEED_CAP);
+	assert_eq(ambos[4], KAI_PATTERN_SEED_CAP);
+	assert_eq(ambos[5], 1);
+
+	// A written file maps back to the same entries.
+	// The file of another format below takes 5 entries more than a table, to reach the size of a pattern file.
+	entries = (struct kai_pattern_entry_t*) malloc((KAI_PATTERN_COUNT + 5) * sizeof(struct kai_pattern_entry_t));
+	for (i = 0; i < KAI_PATTERN_COUNT; ++i)
+	{
+		entries[i].to_move = (int8_t) ((int) (i % 255) - 127);
+		entries[i].waiting = (int8_t) ((int) (i % 13) - 6);
+	}
+	assert_eq(kai_patterns_save(entries, path), 0);
+	assert_eq(kai_patterns_load(&patterns, path), 0);
+	mismatches = 0;
+	for (i = 0; i < KAI_PATTERN_COUNT; ++i)
+	{
+		if (patterns.entries[i].to_move != entries[i].to_move || patterns.entries[i].waiting != entries[i].waiting)
+			++mismatches;
+	}
+	assert_eq(mismatches, 0);
+
+	// The evaluation of a batch still matches that of single boards.
+	kai_parameters_init(&parameters);
+	parameters.patterns = &patterns;
+	kai_parse_board_state(&board_state, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+	test_evaluate_batch_tree(&board_state, 4, &parameters, &mismatches);
+	kai_parse_board_state(&board_state, "23;2;3;1;0;4;2;28;3;0;2;1;0;3;1");
+	test_evaluate_batch_tree(&board_state, 4, &parameters, &mismatches);
+	assert_eq(mismatches, 0);
+	kai_patterns_unload(&patterns);
+
+	// Our side adds its to move value when we are to move, and the opponent's side subtracts its waiting value.
+	memset(entries, 0, (KAI_PATTERN_COUNT + 5) * sizeof(struct kai_pattern_entry_t));
+	kai_parse_board_state(&board_state, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+	index = KAI_PATTERN_INDEX(&board_state.seeds[KAI_SOUTH_START]);
+	entries[index].to_move = 25;
+	entries[index].waiting = 7;
+	assert_eq(kai_patterns_save(entries, path), 0);
+	assert_eq(kai_patterns_load(&patterns, path), 0);
+	kai_parameters_init(&plain);
+	kai_game_state_init(&game_state, 1);
+	evaluation = kai_minimax_node_evaluation(&game_state, &plain, &board_state, NULL);
+	assert_eq(kai_minimax_node_evaluation(&game_state, &parameters, &board_state, NULL), evaluation + 18 * KAI_PATTERN_UNIT);
+	board_state.player = 2;
+	evaluation = kai_minimax_node_evaluation(&game_state, &plain, &board_state, NULL);
+	assert_eq(kai_minimax_node_evaluation(&game_state, &parameters, &board_state, NULL), evaluation - 18 * KAI_PATTERN_UNIT);
+	kai_patterns_unload(&patterns);
+
+	// Neither a file of another format nor a cut off pattern file maps.
+	file = fopen(path, "wb");
+	fwrite("KAIPAR", 1, 6, file);
+	fwrite(entries, sizeof(struct kai_pattern_entry_t), KAI_PATTERN_COUNT + 5, file);
+	fclose(file);
+	assert_eq(kai_patterns_load(&patterns, path), 1);
+	assert_eq(kai_patterns_save(entries, path), 0);
+	file = fopen(path, "rb");
+	assert_eq(fread(entries, 1, KAI_PATTERN_COUNT, file), KAI_PATTERN_COUNT);
+	fclose(file);
+	file = fopen(path, "wb");
+	fwrite(entries, 1, KAI_PATTERN_COUNT, file);
+	fclose(file);
+	assert_eq(kai_patterns_load(&patterns, path), 1);
+
+	remove(path);
+	free(entries);
+}
@@ -0,0 +1,119 @@
+#include "kalahai_trace.h"
+
+
+// The number of linear buckets per power of two.
+#define KAI_TRACE_HALF_COUNT (1 << (KAI_TRACE_SUB_BUCKET_BITS - 1))
+
+/**
+	Return the bucket of a value. Values below 2 * KAI_TRACE_HALF_COUNT have a bucket each, above that every power of
+	two gets KAI_TRACE_HALF_COUNT buckets.
+*/
+static int kai_trace_bucket(uint64_t value)
+{
+	int shift = 0;
+
+	if (value >> KAI_TRACE_MAX_BITS)
+		value = ((uint64_t) 1 << KAI_TRACE_MAX_BITS) - 1;
+
+	while ((value >> shift) >= 2 * KAI_TRACE_HALF_COUNT)
+		++shift;
+
+	return shift * KAI_TRACE_HALF_COUNT + (int) (value >> shift);
+}
+
+/**
+	Return the lowest value of a bucket.
+*/
+static uint64_t kai_trace_bucket_lowest(int bucket)
+{
+	if (bucket < 2 * KAI_TRACE_HALF_COUNT)
+		return (uint64_t) bucket;
+
+	return (uint64_t) (bucket % KAI_TRACE_HALF_COUNT + KAI_TRACE_HALF_COUNT) << (bucket / KAI_TRACE_HALF_COUNT - 1);
+}
+
+void kai_trace_init(struct kai_trace_t* trace)
+{
+	memset(trace, 0, sizeof(*trace));
+}
+
+void kai_trace_record(struct kai_trace_t* trace, int span, double seconds)
+{
+	if (trace == NULL)
+		return;
+
+	kai_trace_histogram_add(&trace->spans[span], seconds > 0.0 ? (uint64_t) (seconds * 1000000000.0) : 0);
+}
+
+void kai_trace_poll(struct kai_trace_t* trace, FILE* file)
+{
+	if (trace == NULL || !trace->print_requested)
+		return;
+
+	trace->print_requested = 0;
+	kai_trace_print(trace, file);
+}
+
+void kai_trace_print(const struct kai_trace_t* trace, FILE* file)
+{
+	int span;
+	const struct kai_trace_histogram_t* histogram;
+
+	fprintf(file, "%-9s %8s %10s %10s %10s %10s %10s %10s\n", "Span (ms)", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+	for (span = 0; span < KAI_TRACE_SPAN_COUNT; ++span)
+	{
+		histogram = &trace->spans[span];
+		fprintf(file, "%-9s %8lld %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", kai_trace_span_name(span), histogram->count,
+			histogram->count > 0 ? (double) histogram->total / histogram->count / 1000000.0 : 0.0,
+			kai_trace_histogram_percentile(histogram, 50.0) / 1000000.0,
+			kai_trace_histogram_percentile(histogram, 90.0) / 1000000.0,
+			kai_trace_histogram_percentile(histogram, 99.0) / 1000000.0,
+			kai_trace_histogram_percentile(histogram, 99.9) / 1000000.0,
+			histogram->maximum / 1000000.0);
+	}
+}
+
+const char* kai_trace_span_name(int span)
+{
+	static const char* names[KAI_TRACE_SPAN_COUNT] = { "receive", "parse", "search", "send", "turn" };
+
+	return names[span];
+}
+
+void kai_trace_histogram_add(struct kai_trace_histogram_t* histogram, uint64_t nanoseconds)
+{
+	histogram->count++;
+	histogram->total += nanoseconds;
+	if (nanoseconds > histogram->maximum)
+		histogram->maximum = nanoseconds;
+
+	histogram->buckets[kai_trace_bucket(nanoseconds)]++;
+}
+
+uint64_t kai_trace_histogram_percentile(const struct kai_trace_histogram_t* histogram, double percentile)
+{
+	int bucket;
+	long long seen = 0;
+	long long rank;
+	uint64_t highest;
+
+	if (histogram->count == 0)
+		return 0;
+
+	// The rank of the value in the percentile, counting from 1.
+	rank = (long long) (histogram->count * percentile / 100.0 + 0.999999);
+	if (rank < 1)
+		rank = 1;
+	if (rank > histogram->count)
+		rank = histogram->count;
+
+	for (bucket = 0; bucket < KAI_TRACE_BUCKET_COUNT - 1; ++bucket)
+	{
+		seen += histogram->buckets[bucket];
+		if (seen >= rank)
+			break;
+	}
+
+	highest = kai_trace_bucket_lowest(bucket + 1) - 1;
+	return highest < histogram->maximum ? highest : histogram->maximum;
+}
@@ -0,0 +1,95 @@
+#ifndef KALAHAI_TRACE_H
+#define KALAHAI_TRACE_H
+
+#include "kalahai.h"
+#include <stdint.h>
+#include <signal.h>
+
+
+/**
+	DEFINES
+*/
+
+// The spans of a turn that are traced. KAI_TRACE_TURN is the time from receiving the board to sending our move.
+#define KAI_TRACE_RECEIVE 0
+#define KAI_TRACE_PARSE 1
+#define KAI_TRACE_SEARCH 2
+#define KAI_TRACE_SEND 3
+#define KAI_TRACE_TURN 4
+#define KAI_TRACE_SPAN_COUNT 5
+
+// Every power of two is split into 2^(KAI_TRACE_SUB_BUCKET_BITS - 1) linear buckets, so a bucket is never wider than
+// 1/32 of the values in it. Values up to 2^KAI_TRACE_MAX_BITS nanoseconds (about 18 minutes) are kept apart.
+#define KAI_TRACE_SUB_BUCKET_BITS 6
+#define KAI_TRACE_MAX_BITS 40
+#define KAI_TRACE_BUCKET_COUNT ((KAI_TRACE_MAX_BITS + 2 - KAI_TRACE_SUB_BUCKET_BITS) << (KAI_TRACE_SUB_BUCKET_BITS - 1))
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	A log-linear latency histogram in nanoseconds, in the manner of HdrHistogram.
+*/
+struct kai_trace_histogram_t
+{
+	long long count;
+	uint64_t total;
+	uint64_t maximum;
+	long long buckets[KAI_TRACE_BUCKET_COUNT];
+};
+
+/**
+	The latency histograms of every span.
+*/
+struct kai_trace_t
+{
+	struct kai_trace_histogram_t spans[KAI_TRACE_SPAN_COUNT];
+
+	// Set to 1 (from a signal handler, for example) to have kai_trace_poll() print the histograms.
+	volatile sig_atomic_t print_requested;
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Clear every histogram of a trace.
+*/
+void kai_trace_init(struct kai_trace_t* trace);
+
+/**
+	Add the duration (in seconds) of a KAI_TRACE_* span to a trace. Does nothing if trace is NULL.
+*/
+void kai_trace_record(struct kai_trace_t* trace, int span, double seconds);
+
+/**
+	Print the histograms of a trace if print_requested is set, and clear the request. Does nothing if trace is NULL.
+*/
+void kai_trace_poll(struct kai_trace_t* trace, FILE* file);
+
+/**
+	Print the count, mean, percentiles and maximum of every span of a trace in milliseconds.
+*/
+void kai_trace_print(const struct kai_trace_t* trace, FILE* file);
+
+/**
+	Return the name of a KAI_TRACE_* span.
+*/
+const char* kai_trace_span_name(int span);
+
+/**
+	Add one value (in nanoseconds) to a histogram.
+*/
+void kai_trace_histogram_add(struct kai_trace_histogram_t* histogram, uint64_t nanoseconds);
+
+/**
+	Return the given percentile (0 - 100) of a histogram in nanoseconds. The value is the highest value of its bucket,
+	so it is at most 1/32 above the true percentile, and never above the maximum.
+*/
+uint64_t kai_trace_histogram_percentile(const struct kai_trace_histogram_t* histogram, double percentile);
+
+#endif
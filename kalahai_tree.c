@@ -0,0 +1,196 @@
+#include "kalahai_tree.h"
+#include "kalahai_table.h"
+
+// The on-disk layout depends on these sizes.
+typedef char kai_tree_event_size_check[sizeof(struct kai_tree_event_t) == KAI_TREE_EVENT_SIZE ? 1 : -1];
+typedef char kai_tree_header_size_check[sizeof(struct kai_tree_file_header_t) == 16 ? 1 : -1];
+
+
+/**
+	Write the collected events.
+*/
+static void kai_tree_writer_flush(struct kai_tree_writer_t* writer)
+{
+	if (!writer->failed && writer->event_count > 0 && fwrite(writer->events, sizeof(writer->events[0]), writer->event_count, writer->file) != writer->event_count)
+	{
+		fprintf(stderr, "Failed to write search tree events\n");
+		writer->failed = 1;
+	}
+
+	writer->event_count = 0;
+}
+
+int kai_tree_writer_open(struct kai_tree_writer_t* writer, const char* path)
+{
+	struct kai_tree_file_header_t header;
+
+	writer->event_count = 0;
+	writer->failed = 0;
+	writer->file = fopen(path, "wb");
+	if (writer->file == NULL)
+	{
+		fprintf(stderr, "Failed to open tree file %s\n", path);
+		return 1;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, KAI_TREE_MAGIC, sizeof(header.magic));
+	header.version = KAI_TREE_VERSION;
+	header.event_size = KAI_TREE_EVENT_SIZE;
+	if (fwrite(&header, sizeof(header), 1, writer->file) != 1)
+	{
+		fprintf(stderr, "Failed to write tree file header to %s\n", path);
+		fclose(writer->file);
+		return 1;
+	}
+
+	return 0;
+}
+
+int kai_tree_writer_close(struct kai_tree_writer_t* writer)
+{
+	kai_tree_writer_flush(writer);
+	if (fclose(writer->file) != 0)
+		writer->failed = 1;
+
+	return writer->failed;
+}
+
+void kai_tree_writer_add(struct kai_tree_writer_t* writer, int type, unsigned int ply, int move, unsigned int depth, int32_t value)
+{
+	struct kai_tree_event_t* event = &writer->events[writer->event_count];
+
+	event->type = (uint8_t) type;
+	event->ply = (uint8_t) (ply < 255 ? ply : 255);
+	event->move = (uint8_t) move;
+	event->depth = (uint8_t) (depth < 255 ? depth : 255);
+	event->value = value;
+
+	if (++writer->event_count == KAI_TREE_BUFFER_EVENTS)
+		kai_tree_writer_flush(writer);
+}
+
+int kai_tree_reader_open(struct kai_tree_reader_t* reader, const char* path)
+{
+	const struct kai_tree_file_header_t* header;
+
+	if (kai_file_map(&reader->mapping, path) != 0)
+	{
+		fprintf(stderr, "Failed to map tree file %s\n", path);
+		return 1;
+	}
+
+	header = (const struct kai_tree_file_header_t*) reader->mapping.data;
+	if (reader->mapping.size < sizeof(*header) ||
+		memcmp(header->magic, KAI_TREE_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != KAI_TREE_VERSION ||
+		header->event_size != KAI_TREE_EVENT_SIZE)
+	{
+		fprintf(stderr, "%s is not a version %d tree file\n", path, KAI_TREE_VERSION);
+		kai_file_unmap(&reader->mapping);
+		return 1;
+	}
+
+	reader->events = (const struct kai_tree_event_t*) (header + 1);
+	reader->event_count = (reader->mapping.size - sizeof(*header)) / KAI_TREE_EVENT_SIZE;
+
+	return 0;
+}
+
+void kai_tree_reader_close(struct kai_tree_reader_t* reader)
+{
+	kai_file_unmap(&reader->mapping);
+}
+
+int kai_tree_reader_iteration(const struct kai_tree_reader_t* reader, size_t index, long* search, struct kai_tree_iteration_t* iteration)
+{
+	const struct kai_tree_event_t* event;
+
+	for (; index < reader->event_count && reader->events[index].type != KAI_TREE_EVENT_ITERATION; ++index)
+	{
+		if (reader->events[index].type == KAI_TREE_EVENT_SEARCH)
+			++*search;
+	}
+
+	if (index == reader->event_count)
+		return 0;
+
+	memset(iteration, 0, sizeof(*iteration));
+	iteration->search = *search;
+	iteration->depth = reader->events[index].depth;
+	iteration->first = index;
+	iteration->nodes = 1;
+
+	for (++index; index < reader->event_count; ++index)
+	{
+		event = &reader->events[index];
+		if (event->type == KAI_TREE_EVENT_NODE)
+			++iteration->nodes;
+		else if (event->type == KAI_TREE_EVENT_CUTOFF)
+			++iteration->cutoffs;
+		else if (event->type == KAI_TREE_EVENT_TABLE)
+			++iteration->table_cutoffs;
+		else if (event->type == KAI_TREE_EVENT_END)
+		{
+			iteration->completed = event->ply;
+			iteration->move = event->move;
+			iteration->score = event->value;
+			++index;
+			break;
+		}
+		else
+			break;
+	}
+
+	iteration->last = index;
+	return 1;
+}
+
+size_t kai_tree_diverge(const struct kai_tree_reader_t* first, const struct kai_tree_reader_t* second)
+{
+	size_t index;
+	size_t count = first->event_count < second->event_count ? first->event_count : second->event_count;
+
+	for (index = 0; index < count; ++index)
+	{
+		if (memcmp(&first->events[index], &second->events[index], KAI_TREE_EVENT_SIZE) != 0)
+			break;
+	}
+
+	return index;
+}
+
+int kai_tree_reader_path(const struct kai_tree_reader_t* reader, size_t index, int* moves)
+{
+	size_t start = index;
+	size_t i;
+	const struct kai_tree_event_t* event;
+
+	if (index >= reader->event_count)
+		return 0;
+
+	// Replay the nodes from the start of the iteration. A node at some ply replaces the move at that ply.
+	while (start > 0 && reader->events[start].type != KAI_TREE_EVENT_ITERATION && reader->events[start].type != KAI_TREE_EVENT_SEARCH)
+		--start;
+
+	for (i = start; i <= index; ++i)
+	{
+		event = &reader->events[i];
+		if (event->type == KAI_TREE_EVENT_NODE && event->ply >= 1 && event->ply <= KAI_MINIMAX_MAX_PLY)
+			moves[event->ply - 1] = event->move;
+	}
+
+	event = &reader->events[index];
+	if (event->type != KAI_TREE_EVENT_NODE && event->type != KAI_TREE_EVENT_CUTOFF && event->type != KAI_TREE_EVENT_TABLE)
+		return 0;
+
+	return event->ply < KAI_MINIMAX_MAX_PLY ? event->ply : KAI_MINIMAX_MAX_PLY;
+}
+
+int32_t kai_tree_board_hash(const struct kai_board_state_t* board_state)
+{
+	uint64_t key[2];
+
+	kai_table_key(board_state, board_state->player, key);
+	return (int32_t) (uint32_t) (key[0] ^ (key[0] >> 32));
+}
@@ -0,0 +1,196 @@
+#ifndef KALAHAI_TREE_H
+#define KALAHAI_TREE_H
+
+#include "kalahai.h"
+#include <stdint.h>
+
+
+/**
+	DEFINES
+*/
+
+/*
+	Search tree files.
+
+	A tree file records what searches did, node by node, so two builds of the engine can be compared on the same
+	searches. It starts with a kai_tree_file_header_t, followed by kai_tree_event_t of KAI_TREE_EVENT_SIZE bytes.
+	Events are written as they are in memory, so a tree file must be compared on a machine with the byte order of the
+	machine that wrote it. A search is only repeatable if it is limited by nodes rather than time.
+
+	Every search starts with a KAI_TREE_EVENT_SEARCH, and every iteration of it is a KAI_TREE_EVENT_ITERATION, the
+	nodes of the iteration in the order they were searched, and a KAI_TREE_EVENT_END.
+*/
+
+// The magic bytes at the start of a tree file.
+#define KAI_TREE_MAGIC "KAITRE"
+
+// The version of the format.
+#define KAI_TREE_VERSION 1
+
+// The size of every event in the file.
+#define KAI_TREE_EVENT_SIZE 8
+
+// Event types. The fields of kai_tree_event_t are described for every type there.
+#define KAI_TREE_EVENT_SEARCH 1
+#define KAI_TREE_EVENT_ITERATION 2
+#define KAI_TREE_EVENT_NODE 3
+#define KAI_TREE_EVENT_CUTOFF 4
+#define KAI_TREE_EVENT_TABLE 5
+#define KAI_TREE_EVENT_END 6
+
+// The number of events the writer collects before writing them.
+#define KAI_TREE_BUFFER_EVENTS 8192
+
+
+/**
+	STRUCTURES & TYPEDEFS
+*/
+
+/**
+	The start of a tree file.
+*/
+struct kai_tree_file_header_t
+{
+	char magic[6];
+	uint16_t version;
+	uint16_t event_size;
+	uint8_t reserved[6];
+};
+
+/**
+	One event of a search.
+
+	KAI_TREE_EVENT_SEARCH: a search starts. value is a hash of the root board and player to move.
+	KAI_TREE_EVENT_ITERATION: an iteration starts. depth is the depth it searches to.
+	KAI_TREE_EVENT_NODE: a node is searched. ply is its distance from the root, move (1 - 6) the move leading to it
+		and depth the depth left below it.
+	KAI_TREE_EVENT_CUTOFF: the rest of the moves of the node at ply are skipped after move, with value as its score.
+	KAI_TREE_EVENT_TABLE: the node at ply is cut off by the transposition table, with move (0 for none) and value as
+		its move and score.
+	KAI_TREE_EVENT_END: an iteration ends. ply is 1 if it completed, move its best move and value its score.
+*/
+struct kai_tree_event_t
+{
+	uint8_t type;
+	uint8_t ply;
+	uint8_t move;
+	uint8_t depth;
+	int32_t value;
+};
+
+/**
+	Writes the events of searches to a tree file.
+*/
+struct kai_tree_writer_t
+{
+	FILE* file;
+
+	// The events not written yet.
+	struct kai_tree_event_t events[KAI_TREE_BUFFER_EVENTS];
+	size_t event_count;
+
+	// 1 once a write has failed. Nothing more is written after that.
+	int failed;
+};
+
+/**
+	Reads a tree file through a memory mapping.
+*/
+struct kai_tree_reader_t
+{
+	struct kai_file_mapping_t mapping;
+
+	// The events after the file header.
+	const struct kai_tree_event_t* events;
+	size_t event_count;
+};
+
+/**
+	The totals of one iteration of a tree file, as found by kai_tree_reader_iteration().
+*/
+struct kai_tree_iteration_t
+{
+	// The index of the search in the file (counting from 0), and the depth of the iteration.
+	long search;
+	int depth;
+
+	// The event index of the KAI_TREE_EVENT_ITERATION, and the index after the KAI_TREE_EVENT_END (or the end of the
+	// file if the iteration was cut short).
+	size_t first;
+	size_t last;
+
+	// The nodes searched (including the root), the cutoffs and the transposition table cutoffs.
+	long long nodes;
+	long long cutoffs;
+	long long table_cutoffs;
+
+	// From the KAI_TREE_EVENT_END: 1 if the iteration completed, its best move and score.
+	int completed;
+	int move;
+	int score;
+};
+
+
+/**
+	PROTOTYPES
+*/
+
+/**
+	Create (or truncate) a tree file and write its header.
+
+	Returns 0 on success, 1 on failure.
+*/
+int kai_tree_writer_open(struct kai_tree_writer_t* writer, const char* path);
+
+/**
+	Write the remaining events and close the tree file.
+
+	Returns 0 if every event was written, 1 otherwise.
+*/
+int kai_tree_writer_close(struct kai_tree_writer_t* writer);
+
+/**
+	Add one event. The events are written in blocks of KAI_TREE_BUFFER_EVENTS.
+*/
+void kai_tree_writer_add(struct kai_tree_writer_t* writer, int type, unsigned int ply, int move, unsigned int depth, int32_t value);
+
+/**
+	Map a tree file.
+
+	Returns 0 on success, 1 if the file cannot be read or is not a tree file.
+*/
+int kai_tree_reader_open(struct kai_tree_reader_t* reader, const char* path);
+
+/**
+	Unmap the tree file.
+*/
+void kai_tree_reader_close(struct kai_tree_reader_t* reader);
+
+/**
+	Find the first iteration that starts at or after the event with the given index, and add up its events.
+	search counts the KAI_TREE_EVENT_SEARCH events before it, and is carried from one call to the next (start at -1).
+
+	Returns 1 if an iteration was found, 0 at the end of the file.
+*/
+int kai_tree_reader_iteration(const struct kai_tree_reader_t* reader, size_t index, long* search, struct kai_tree_iteration_t* iteration);
+
+/**
+	Return the index of the first event where two tree files differ. If one file is the start of the other, this is the
+	number of events of the shorter one, and if they are the same, it is the number of events of both.
+*/
+size_t kai_tree_diverge(const struct kai_tree_reader_t* first, const struct kai_tree_reader_t* second);
+
+/**
+	Find the moves from the root of the search to the node of the event with the given index. moves receives up to
+	KAI_MINIMAX_MAX_PLY moves (1 - 6).
+
+	Returns the number of moves.
+*/
+int kai_tree_reader_path(const struct kai_tree_reader_t* reader, size_t index, int* moves);
+
+/**
+	Return the hash that KAI_TREE_EVENT_SEARCH events keep of a board.
+*/
+int32_t kai_tree_board_hash(const struct kai_board_state_t* board_state);
+
+#endif
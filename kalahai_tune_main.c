@@ -0,0 +1,475 @@
+#include "kalahai_engine.h"
+#include "kalahai_parameters.h"
+#include "kalahai_sched.h"
+#include "kalahai_record.h"
+#include <math.h>
+
+// The number of random moves played from the start position to get varied games.
+#define KAI_TUNE_OPENING_PLIES 4
+
+// Games longer than this are scored as draws.
+#define KAI_TUNE_MAX_PLIES 400
+
+// The SPSA gain sequences: a_k = a / (k + 1 + A)^alpha and c_k = c / (k + 1)^gamma.
+#define KAI_TUNE_ALPHA 0.602
+#define KAI_TUNE_GAMMA 0.101
+
+/**
+	The games of one SPSA iteration, shared by all game threads.
+*/
+struct kai_tune_batch_t
+{
+	// The two perturbed sets of parameters playing each other.
+	struct kai_parameters_t plus;
+	struct kai_parameters_t minus;
+
+	// The node limit of every search.
+	long long nodes;
+
+	// The number of game pairs, and the index of the next pair to play.
+	int pair_count;
+	kai_atomic_t next_pair;
+
+	// Seeds the opening of each pair.
+	unsigned long long seed;
+
+	// The record file every game is appended to, or NULL.
+	const char* record_path;
+
+	// Points scored by the plus parameters in each pair (0 to 2, a win is 1 and a draw 0.5).
+	double* points;
+};
+
+/**
+	One game thread of a batch.
+*/
+struct kai_tune_thread_t
+{
+	struct kai_tune_batch_t* batch;
+	struct kai_thread_t thread;
+	int started;
+
+	// The processor the thread pins itself to, or -1.
+	int cpu;
+};
+
+
+/**
+	Thread entry point. Plays game pairs of the kai_tune_batch_t of the kai_tune_thread_t passed as argument until none are left.
+*/
+void kai_tune_thread(void* argument);
+
+/**
+	Play one game in-process between two engines, from the given position. engines[0] plays player 1. The game is
+	appended to record, unless it is NULL.
+
+	Returns the winner (0 for a draw).
+*/
+int kai_tune_play_game(struct kai_engine_t* engines[2], const struct kai_board_state_t* opening, long long nodes, struct kai_record_writer_t* record);
+
+/**
+	Build an opening by playing random moves from the start position.
+*/
+void kai_tune_opening(struct kai_board_state_t* board_state, unsigned long long seed);
+
+/**
+	Return the next number of a xorshift sequence.
+*/
+unsigned long long kai_tune_random(unsigned long long* state);
+
+/**
+	Round the tuned values to parameters.
+*/
+void kai_tune_round(const double* theta, struct kai_parameters_t* parameters);
+
+
+/**
+	Program entry point.
+
+	Usage: kalahai_tune [--iterations <n>] [--pairs <n>] [--nodes <n>] [--threads <n>] [--seed <n>] [--rate <r>]
+	                    [--start <file>] [--output <file>] [--header <file>] [--pin] [--no-smt] [--record <file>]
+
+	Tunes the parameters of kai_parameters_t with SPSA. Every iteration moves all parameters a random step up or down
+	(+c or -c), plays the two resulting engines against each other in pairs of games with fixed node limits and
+	swapped sides, and moves the parameters towards the side that scored better. The parameters are written to the
+	output parameter file (for 'kalahai --parameters') after every iteration, and as defines to the header when done.
+	The games are played on as many threads as the CPU quota and affinity mask of the process allow (see
+	kalahai_sched.h), unless --threads is given. --pin pins every game thread to a processor of its own, on distinct
+	physical cores first, and --no-smt also keeps to one processor per physical core. --record appends every game,
+	with the search of every move, to the given game record file (for kalahai_records).
+*/
+int main(int argc, char* argv[])
+{
+	int iterations = 200;
+	int pair_count = 32;
+	int thread_count = 0;
+	int pin = 0;
+	int avoid_smt = 0;
+	long long nodes = 50000;
+	unsigned long long seed = 1;
+	double rate = 1.0;
+	const char* start_path = NULL;
+	const char* output_path = "kalahai_tuned.txt";
+	const char* header_path = NULL;
+	const char* record_path = NULL;
+
+	int i;
+	int j;
+	int k;
+	int started;
+	double a;
+	double a_k;
+	double c_k[KAI_PARAMETER_COUNT];
+	double theta[KAI_PARAMETER_COUNT];
+	double perturbed[KAI_PARAMETER_COUNT];
+	int delta[KAI_PARAMETER_COUNT];
+	double score;
+	unsigned long long random_state;
+	struct kai_parameters_t parameters;
+	struct kai_tune_batch_t batch;
+	struct kai_tune_thread_t* threads;
+	const struct kai_parameter_info_t* info;
+	struct kai_sched_t sched;
+	struct kai_record_writer_t* record;
+
+	for (i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+			iterations = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--pairs") == 0 && i + 1 < argc)
+			pair_count = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc)
+			nodes = atoll(argv[++i]);
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			thread_count = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+			rate = atof(argv[++i]);
+		else if (strcmp(argv[i], "--start") == 0 && i + 1 < argc)
+			start_path = argv[++i];
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			output_path = argv[++i];
+		else if (strcmp(argv[i], "--header") == 0 && i + 1 < argc)
+			header_path = argv[++i];
+		else if (strcmp(argv[i], "--pin") == 0)
+			pin = 1;
+		else if (strcmp(argv[i], "--no-smt") == 0)
+			avoid_smt = 1;
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			record_path = argv[++i];
+		else
+		{
+			fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	kai_sched_init(&sched, pin, avoid_smt);
+	kai_sched_log(&sched, NULL);
+	if (thread_count == 0)
+		thread_count = sched.thread_count;
+
+	if (iterations < 1 || pair_count < 1 || nodes < 1 || thread_count < 1)
+	{
+		fprintf(stderr, "The iteration, pair, node and thread counts must be positive.\n");
+		return 1;
+	}
+
+	// There is no point in more threads than game pairs.
+	if (thread_count > pair_count)
+		thread_count = pair_count;
+
+	kai_parameters_init(&parameters);
+	if (start_path != NULL && kai_parameters_load(&parameters, start_path) != 0)
+		return 1;
+
+	for (j = 0; j < KAI_PARAMETER_COUNT; ++j)
+		theta[j] = *kai_parameters_value(&parameters, &kai_parameter_infos[j]);
+
+	// Every game thread appends to the record file through a writer of its own. Open it once first, so that a file
+	// that cannot be written fails here rather than in every thread.
+	if (record_path != NULL)
+	{
+		record = (struct kai_record_writer_t*) malloc(sizeof(*record));
+		if (record == NULL || kai_record_writer_open(record, record_path) != 0)
+		{
+			free(record);
+			return 1;
+		}
+		kai_record_writer_close(record);
+		free(record);
+	}
+
+	// kai_tune_round() only writes the tuned parameters, so the others come from the start parameters.
+	memcpy(&batch.plus, &parameters, sizeof(parameters));
+	memcpy(&batch.minus, &parameters, sizeof(parameters));
+	batch.nodes = nodes;
+	batch.pair_count = pair_count;
+	batch.record_path = record_path;
+	batch.points = (double*) malloc(pair_count * sizeof(double));
+	threads = (struct kai_tune_thread_t*) malloc(thread_count * sizeof(struct kai_tune_thread_t));
+	if (batch.points == NULL || threads == NULL)
+	{
+		free(batch.points);
+		free(threads);
+		return 1;
+	}
+
+	// Scale the learning rate so that the first step of a parameter is at most its perturbation when one side wins every game.
+	a = rate * pow(iterations / 10.0 + 1.0, KAI_TUNE_ALPHA);
+	random_state = seed * 0x9E3779B97F4A7C15ULL + 1;
+
+	for (k = 0; k < iterations; ++k)
+	{
+		a_k = a / pow(k + 1.0 + iterations / 10.0, KAI_TUNE_ALPHA);
+
+		for (j = 0; j < KAI_PARAMETER_COUNT; ++j)
+		{
+			info = &kai_parameter_infos[j];
+			c_k[j] = info->step / pow(k + 1.0, KAI_TUNE_GAMMA);
+			delta[j] = (kai_tune_random(&random_state) & 1) ? 1 : -1;
+
+			perturbed[j] = theta[j] + c_k[j] * delta[j];
+		}
+		kai_tune_round(perturbed, &batch.plus);
+
+		for (j = 0; j < KAI_PARAMETER_COUNT; ++j)
+			perturbed[j] = theta[j] - c_k[j] * delta[j];
+		kai_tune_round(perturbed, &batch.minus);
+
+		// A pair that is never played, because no thread could create its engines, counts as two draws.
+		for (i = 0; i < pair_count; ++i)
+			batch.points[i] = 1.0;
+
+		// Play the batch on all threads. Falls back on the calling thread, unpinned, if no thread could be started.
+		batch.next_pair = 0;
+		batch.seed = kai_tune_random(&random_state);
+		started = 0;
+		for (i = 0; i < thread_count; ++i)
+		{
+			threads[i].batch = &batch;
+			threads[i].cpu = kai_sched_cpu(&sched, i);
+			threads[i].started = kai_thread_create(&threads[i].thread, kai_tune_thread, &threads[i]) == 0;
+			started += threads[i].started;
+		}
+		for (i = 0; i < thread_count; ++i)
+		{
+			if (threads[i].started)
+				kai_thread_join(&threads[i].thread);
+		}
+		if (started == 0)
+		{
+			threads[0].cpu = -1;
+			kai_tune_thread(&threads[0]);
+		}
+
+		// The score of the plus side, from -1 (lost every game) to 1 (won every game).
+		score = 0.0;
+		for (i = 0; i < pair_count; ++i)
+			score += batch.points[i] - 1.0;
+		score /= pair_count;
+
+		// Moving along delta scored 'score' better than moving against it, so step that way in proportion.
+		for (j = 0; j < KAI_PARAMETER_COUNT; ++j)
+		{
+			info = &kai_parameter_infos[j];
+			theta[j] += a_k * c_k[j] * score * delta[j];
+			if (theta[j] < info->minimum)
+				theta[j] = info->minimum;
+			if (theta[j] > info->maximum)
+				theta[j] = info->maximum;
+		}
+
+		fprintf(stdout, "Iteration %d: score %+.3f.", k + 1, score);
+		for (j = 0; j < KAI_PARAMETER_COUNT; ++j)
+			fprintf(stdout, " %s %.2f", kai_parameter_infos[j].name, theta[j]);
+		fprintf(stdout, "\n");
+		fflush(stdout);
+
+		kai_tune_round(theta, &parameters);
+		if (kai_parameters_save(&parameters, output_path) != 0)
+			break;
+	}
+
+	free(batch.points);
+	free(threads);
+
+	if (k < iterations)
+		return 1;
+
+	if (header_path != NULL && kai_parameters_save_header(&parameters, header_path) != 0)
+		return 1;
+
+	return 0;
+}
+
+void kai_tune_thread(void* argument)
+{
+	struct kai_tune_thread_t* thread = (struct kai_tune_thread_t*) argument;
+	struct kai_tune_batch_t* batch = thread->batch;
+	struct kai_engine_t* engines[2];
+	struct kai_engine_t* plus;
+	struct kai_engine_t* minus;
+	struct kai_record_writer_t* record = NULL;
+	struct kai_board_state_t opening;
+	int pair;
+	int winner;
+	double points;
+
+	if (thread->cpu >= 0)
+		kai_thread_pin(thread->cpu);
+
+	plus = kai_engine_create();
+	minus = kai_engine_create();
+	if (plus == NULL || minus == NULL)
+	{
+		if (plus != NULL)
+			kai_engine_destroy(plus);
+		if (minus != NULL)
+			kai_engine_destroy(minus);
+		return;
+	}
+
+	kai_engine_set_parameters(plus, &batch->plus);
+	kai_engine_set_parameters(minus, &batch->minus);
+
+	// The writer holds a whole game, so keep it off the stack. Games are played without it if it cannot be opened.
+	if (batch->record_path != NULL)
+	{
+		record = (struct kai_record_writer_t*) malloc(sizeof(*record));
+		if (record != NULL && kai_record_writer_open(record, batch->record_path) != 0)
+		{
+			free(record);
+			record = NULL;
+		}
+	}
+
+	while ((pair = (int) kai_atomic_add(&batch->next_pair, 1) - 1) < batch->pair_count)
+	{
+		kai_tune_opening(&opening, batch->seed + (unsigned long long) pair * 0x9E3779B97F4A7C15ULL);
+
+		// Play the opening from both sides, so neither side gains from the position.
+		engines[0] = plus;
+		engines[1] = minus;
+		winner = kai_tune_play_game(engines, &opening, batch->nodes, record);
+		points = winner == 1 ? 1.0 : (winner == 0 ? 0.5 : 0.0);
+
+		engines[0] = minus;
+		engines[1] = plus;
+		winner = kai_tune_play_game(engines, &opening, batch->nodes, record);
+		points += winner == 2 ? 1.0 : (winner == 0 ? 0.5 : 0.0);
+
+		batch->points[pair] = points;
+	}
+
+	if (record != NULL)
+	{
+		kai_record_writer_close(record);
+		free(record);
+	}
+
+	kai_engine_destroy(plus);
+	kai_engine_destroy(minus);
+}
+
+int kai_tune_play_game(struct kai_engine_t* engines[2], const struct kai_board_state_t* opening, long long nodes, struct kai_record_writer_t* record)
+{
+	int ply;
+	int move;
+	int winner = 0;
+	struct kai_board_state_t board_state;
+	struct kai_engine_limits_t limits;
+	struct kai_search_info_t info;
+
+	limits.depth = 0;
+	limits.nodes = nodes;
+	limits.time = 0.0;
+
+	memcpy(&board_state, opening, sizeof(board_state));
+	if (record != NULL)
+		kai_record_writer_begin_game(record, KAI_PLAYER_NONE);
+
+	for (ply = 0; ply < KAI_TUNE_MAX_PLIES; ++ply)
+	{
+		if (kai_is_game_over(&board_state) ||
+			board_state.seeds[KAI_SOUTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD ||
+			board_state.seeds[KAI_NORTH_HOUSE] >= KAI_SEED_WIN_THRESHOLD)
+			break;
+
+		kai_engine_set_position(engines[board_state.player - 1], &board_state);
+		move = kai_engine_search(engines[board_state.player - 1], &limits, NULL, &info);
+		if (move == -1)
+			break;
+
+		if (record != NULL)
+			kai_record_writer_add_ply(record, &board_state, move, &info);
+
+		kai_play_move(&board_state, (kai_ambo_index_t) (move - 1 + (board_state.player == 1 ? KAI_SOUTH_START : KAI_NORTH_START)));
+	}
+
+	if (board_state.seeds[KAI_SOUTH_HOUSE] > board_state.seeds[KAI_NORTH_HOUSE])
+		winner = 1;
+	if (board_state.seeds[KAI_NORTH_HOUSE] > board_state.seeds[KAI_SOUTH_HOUSE])
+		winner = 2;
+
+	if (record != NULL)
+		kai_record_writer_end_game(record, (kai_player_id_t) winner);
+
+	return winner;
+}
+
+void kai_tune_opening(struct kai_board_state_t* board_state, unsigned long long seed)
+{
+	int ply;
+	int count;
+	kai_ambo_index_t first;
+	kai_ambo_index_t ambo;
+	kai_ambo_index_t moves[KAI_AMBO_COUNT];
+	unsigned long long random_state = seed | 1;
+
+	kai_parse_board_state(board_state, "0;6;6;6;6;6;6;0;6;6;6;6;6;6;1");
+	for (ply = 0; ply < KAI_TUNE_OPENING_PLIES && !kai_is_game_over(board_state); ++ply)
+	{
+		first = board_state->player == 1 ? KAI_SOUTH_START : KAI_NORTH_START;
+		count = 0;
+		for (ambo = first; ambo < first + KAI_AMBO_COUNT; ++ambo)
+		{
+			if (board_state->seeds[ambo] != 0)
+				moves[count++] = ambo;
+		}
+
+		if (count == 0)
+			break;
+
+		kai_play_move(board_state, moves[kai_tune_random(&random_state) % count]);
+	}
+}
+
+unsigned long long kai_tune_random(unsigned long long* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+
+	return *state;
+}
+
+void kai_tune_round(const double* theta, struct kai_parameters_t* parameters)
+{
+	int j;
+	int value;
+	const struct kai_parameter_info_t* info;
+
+	for (j = 0; j < KAI_PARAMETER_COUNT; ++j)
+	{
+		info = &kai_parameter_infos[j];
+		value = (int) floor(theta[j] + 0.5);
+		if (value < info->minimum)
+			value = info->minimum;
+		if (value > info->maximum)
+			value = info->maximum;
+
+		*kai_parameters_value(parameters, info) = value;
+	}
+}
@@ -14,15 +14,100 @@ solution "kalahai"
 		flags "Optimize"
 	configuration {}
 	
+	project "libkalahai"
+		kind "StaticLib"
+		language "C"
+		targetname "kalahai"
+		files { "kalahai.h", "kalahai.c", "kalahai_engine.h", "kalahai_engine.c", "kalahai_arena.h", "kalahai_arena.c", "kalahai_record.h", "kalahai_record.c", "kalahai_table.h", "kalahai_table.c", "kalahai_parameters.h", "kalahai_parameters.c", "kalahai_server.h", "kalahai_server.c", "kalahai_trace.h", "kalahai_trace.c", "kalahai_solver.h", "kalahai_solver.c", "kalahai_sow.h", "kalahai_sow.c", "kalahai_tree.h", "kalahai_tree.c", "kalahai_log.h", "kalahai_log.c", "kalahai_suite.h", "kalahai_suite.c", "kalahai_sched.h", "kalahai_sched.c", "kalahai_pattern.h", "kalahai_pattern.c", "kalahai_platform.h" }
+		
+		configuration "windows"
+			files { "kalahai_platform_win32.c" }
+		configuration "not windows"
+			files { "kalahai_platform_posix.c" }
+		configuration {}
 	project "kalahai"
 		kind "ConsoleApp"
 		language "C"
-		files { "kalahai.h", "kalahai.c", "kalahai_main.c" }
+		files { "kalahai_main.c" }
+		
+		links { "libkalahai" }
+		configuration "windows"
+			links { "Ws2_32", "Psapi" }
+		configuration "not windows"
+			links { "pthread", "rt" }
+		configuration {}
+	project "kalahai_records"
+		kind "ConsoleApp"
+		language "C"
+		files { "kalahai_records_main.c" }
+		
+		links { "libkalahai" }
+		configuration "windows"
+			links { "Ws2_32", "Psapi" }
+		configuration "not windows"
+			links { "pthread", "rt" }
+		configuration {}
+	project "kalahai_replay"
+		kind "ConsoleApp"
+		language "C"
+		files { "kalahai_replay_main.c" }
+		
+		links { "libkalahai" }
+		configuration "windows"
+			links { "Ws2_32", "Psapi" }
+		configuration "not windows"
+			links { "pthread", "rt" }
+		configuration {}
+	project "kalahai_tune"
+		kind "ConsoleApp"
+		language "C"
+		files { "kalahai_tune_main.c" }
+		
+		links { "libkalahai" }
+		configuration "windows"
+			links { "Ws2_32", "Psapi" }
+		configuration "not windows"
+			links { "pthread", "rt", "m" }
+		configuration {}
+	project "kalahai_suite"
+		kind "ConsoleApp"
+		language "C"
+		files { "kalahai_suite_main.c" }
+		
+		links { "libkalahai" }
+		configuration "windows"
+			links { "Ws2_32", "Psapi" }
+		configuration "not windows"
+			links { "pthread", "rt", "m" }
+		configuration {}
+	project "kalahai_patterns"
+		kind "ConsoleApp"
+		language "C"
+		files { "kalahai_patterns_main.c" }
 		
-		links { "Ws2_32" }
+		links { "libkalahai" }
+		configuration "windows"
+			links { "Ws2_32", "Psapi" }
+		configuration "not windows"
+			links { "pthread", "rt", "m" }
+		configuration {}
+	-- The server is built on epoll, so it is only available on Linux.
+	if os.get() == "linux" then
+		project "kalahai_server"
+			kind "ConsoleApp"
+			language "C"
+			files { "kalahai_server_main.c" }
+			
+			links { "libkalahai", "pthread", "rt" }
+	end
 	project "kalahai_tests"
 		kind "ConsoleApp"
 		language "C"
-		files { "kalahai.h", "kalahai.c", "kalahai_test_main.c" }
+		files { "kalahai_test_main.c" }
 		
-		links { "Ws2_32" }
\ No newline at end of file
+		links { "libkalahai" }
+		configuration "windows"
+			links { "Ws2_32", "Psapi" }
+		configuration "not windows"
+			links { "pthread", "rt" }
+		configuration {}
\ No newline at end of file